@@ -0,0 +1,69 @@
+/**
+ * @file bench_aging.c
+ * @brief Benchmark of the per-command aging tick.
+ *
+ * Compares calling pte_mkold() on every page, as the REPL loop used to, against one
+ * pagetable_age() pass over the whole page table and over resident pages only.  Build and run
+ * from the repository root with:
+ *
+ *     cc -O2 -I. -o bench_aging bench/bench_aging.c mmu.c mmu_frameheap.c \
+ *         mmu_image.c mmu_pagefile.c mmu_pagemap.c mmu_policy.c mmu_readahead.c mmu_tlb.c \
+ *         mmu_zcache.c
+ *     ./bench_aging [ticks]
+ *
+ * @author ckurdelak20@georgefox.edu
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "mmu.h"
+
+/**
+ * Returns the current monotonic time in seconds.
+ * @return the current time in seconds
+ */
+static double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char* argv[]) {
+    long ticks = argc > 1 ? strtol(argv[1], NULL, 10) : 1000000;
+    char* pagefile = "bench_aging.sys";
+    const char* names[] = {"mkold", "simd-all", "resident"};
+
+    mm_mem_init();
+    mm_vmem_init(pagefile);
+    pagetable_t* tbl = pagetable_alloc();
+    // fill every frame
+    for (pagenum_t p = 0; p < PAGE_FRAMES; p++) {
+        pte_page(pagefile, tbl, p * 3);
+    }
+
+    printf("%-10s %12s\n", "tick", "ns/tick");
+    for (int mode = 0; mode < 3; mode++) {
+        double start = now();
+        for (long t = 0; t < ticks; t++) {
+            if (mode == 0) {
+                for (size_t i = 0; i < PAGETABLE_SIZE; i++) {
+                    pte_mkold(tbl, i);
+                }
+            }
+            else {
+                pagetable_age(tbl, mode == 2);
+            }
+            // one reference per command keeps the counters moving
+            pte_mkyoung(tbl, (t % PAGE_FRAMES) * 3);
+        }
+        double elapsed = now() - start;
+        printf("%-10s %12.2f\n", names[mode], elapsed * 1e9 / ticks);
+    }
+
+    pagetable_free(tbl);
+    mm_vmem_destroy();
+    mm_mem_destroy();
+    remove(pagefile);
+    return 0;
+}
@@ -0,0 +1,154 @@
+/**
+ * @file bench_checkpoint.c
+ * @brief Benchmark of resuming a simulation from a checkpoint image instead of starting cold.
+ *
+ * A warm-up pass writes pages beyond a working set of three quarters of memory and evicts them,
+ * so that only the page file holds them, then touches the working set at random.  The machine is
+ * then imaged, either as it is or after every page has been written back, which leaves an image
+ * of a cold machine over the same page file.  Each image is restored on a fresh machine and the
+ * same accesses are run over the working set.  It reports the time to take the image and its
+ * size, the time to restore it, the faults and the time of the run after it, and the pages that
+ * do not read back as last written.  Build and run from the repository root with:
+ *
+ *     cc -O2 -pthread -I. -o bench_checkpoint bench/bench_checkpoint.c mmu.c mmu_frameheap.c \
+ *         mmu_image.c mmu_pagefile.c mmu_pagemap.c mmu_policy.c mmu_readahead.c mmu_tlb.c \
+ *         mmu_zcache.c
+ *     ./bench_checkpoint [accesses]
+ *
+ * @author ckurdelak20@georgefox.edu
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include "mmu.h"
+
+#define FRAMES   4096              /* page frames */
+#define WSET     (FRAMES / 4 * 3)  /* pages of the working set */
+#define EXTRA    (FRAMES / 2)      /* pages written once beyond it */
+
+static char* pagefile = "bench_checkpoint.sys";
+static char* image = "bench_checkpoint.img";
+
+/**
+ * Returns the current monotonic time in seconds.
+ * @return the current time in seconds
+ */
+static double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * Touches pages of the working set at random, writing one access in four.
+ * @param tbl the page table
+ * @param last the byte last written to the start of each page
+ * @param seed the state of the generator
+ * @param n the number of accesses
+ */
+static void touch(pagetable_t* tbl, uint8_t* last, uint64_t* seed, long n) {
+    for (long i = 0; i < n; i++) {
+        *seed ^= *seed << 13;
+        *seed ^= *seed >> 7;
+        *seed ^= *seed << 17;
+        pagenum_t p = *seed % WSET;
+        uint8_t byte;
+        if (*seed / WSET % 4 == 0) {
+            byte = (uint8_t)(i | 1);
+            mmu_write_span(pagefile, tbl, mk_vaddr(p * PAGE_SIZE), &byte, 1);
+            last[p] = byte;
+        }
+        else {
+            mmu_read_span(pagefile, tbl, mk_vaddr(p * PAGE_SIZE), &byte, 1);
+        }
+        if (i % 64 == 0) {
+            pagetable_age(tbl, true);
+        }
+    }
+}
+
+/**
+ * Warms up a machine, images it and resumes from the image, and prints the row.
+ * @param cold true to write every page back before taking the image
+ * @param n the number of accesses of each pass
+ */
+static void run(bool cold, long n) {
+    uint8_t* last = calloc(WSET + EXTRA, sizeof(uint8_t));
+    uint64_t seed = 460;
+    mm_mem_init();
+    mm_vmem_init(pagefile);
+    pagetable_t* tbl = pagetable_alloc();
+    // pages beyond the working set are written once, and left to the page file
+    for (pagenum_t p = WSET; p < WSET + EXTRA; p++) {
+        uint8_t byte = (uint8_t)p | 1;
+        mmu_write_span(pagefile, tbl, mk_vaddr(p * PAGE_SIZE), &byte, 1);
+        mm_page_evict(pagefile, tbl, p);
+        last[p] = byte;
+    }
+    touch(tbl, last, &seed, n);
+    if (cold) {
+        mm_page_evict_all(pagefile, tbl);
+    }
+    double start = now();
+    mm_checkpoint(image);
+    double saved = now() - start;
+    struct stat st;
+    stat(image, &st);
+    pagetable_free(tbl);
+    mm_vmem_destroy();
+    mm_mem_destroy();
+    mm_stats_reset();
+
+    mm_mem_init();
+    start = now();
+    bool restored = mm_vmem_restore(pagefile, &(pagefile_opts_t){.mode = PAGEFILE_PIO}, image);
+    double resumed = now() - start;
+    tbl = mm_space(0);
+    unsigned long bad = !restored;
+    if (restored) {
+        mm_stats_reset();
+        start = now();
+        touch(tbl, last, &seed, n);
+        double elapsed = now() - start;
+        mmu_stats_t stats;
+        mm_stats(&stats);
+
+        mm_page_evict_all(pagefile, tbl);
+        for (pagenum_t p = 0; p < WSET + EXTRA; p++) {
+            uint8_t byte;
+            mmu_read_span(pagefile, tbl, mk_vaddr(p * PAGE_SIZE), &byte, 1);
+            bad += byte != last[p];
+        }
+        printf("%-5s %10.2f %10lld %10.2f %8lu %10.2f %6lu\n", cold ? "cold" : "warm",
+               saved * 1e3, (long long)st.st_size / 1024, resumed * 1e3, stats.faults,
+               elapsed * 1e3, bad);
+        mm_page_evict_all(pagefile, tbl);
+        pagetable_free(tbl);
+    }
+    else {
+        printf("%-5s could not resume from %s\n", cold ? "cold" : "warm", image);
+    }
+    free(last);
+    mm_vmem_destroy();
+    mm_mem_destroy();
+    mm_stats_reset();
+}
+
+int main(int argc, char* argv[]) {
+    long n = argc > 1 ? strtol(argv[1], NULL, 10) : 200000;
+    if (n <= 0 || !mm_geometry_init(32, 12, FRAMES)) {
+        fprintf(stderr, "usage: %s [accesses]\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    printf("%-5s %10s %10s %10s %8s %10s %6s\n", "image", "save_ms", "image_kb", "restore_ms",
+           "faults", "run_ms", "bad");
+    run(true, n);
+    run(false, n);
+    remove(pagefile);
+    remove(image);
+    return 0;
+}
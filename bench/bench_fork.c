@@ -0,0 +1,153 @@
+/**
+ * @file bench_fork.c
+ * @brief Benchmark of forking address spaces copy-on-write instead of copying them.
+ *
+ * A parent writes a working set of half of memory, plus pages beyond it that are evicted to the
+ * page file, and then forks three children.  Each child writes a share of its working set and
+ * reads the rest; a fork that copies eagerly, by reading each of the parent's pages and writing it
+ * to a fresh address space, is run for comparison.  Passes run with children writing none, a
+ * tenth, half and all of their pages, and report the time to fork, the time the children take,
+ * the pages copied on write, the faults and evictions, and the pages of the parent or a child that
+ * do not read back as last written.  Build and run from the repository root with:
+ *
+ *     cc -O2 -pthread -I. -o bench_fork bench/bench_fork.c mmu.c mmu_frameheap.c mmu_image.c \
+ *         mmu_pagefile.c mmu_pagemap.c mmu_policy.c mmu_readahead.c mmu_tlb.c mmu_zcache.c
+ *     ./bench_fork [rounds]
+ *
+ * @author ckurdelak20@georgefox.edu
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "mmu.h"
+
+#define FRAMES     4096            /* page frames */
+#define WSET       (FRAMES / 2)    /* pages of the parent's working set */
+#define EXTRA      (FRAMES / 16)   /* pages written once beyond it and evicted */
+#define CHILDREN   3               /* processes forked from the parent */
+
+static char* pagefile = "bench_fork.sys";
+
+/**
+ * Returns the current monotonic time in seconds.
+ * @return the current time in seconds
+ */
+static double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * Copies an address space the way a fork without copy-on-write does: every page of the parent is
+ * read and written to a new address space.
+ * @param parent the page table of the address space to copy
+ * @return the page table of the copy
+ */
+static pagetable_t* fork_eager(pagetable_t* parent) {
+    pagetable_t* child = pagetable_alloc();
+    uint8_t* page = malloc(PAGE_SIZE);
+    for (pagenum_t p = 0; child != NULL && p < WSET + EXTRA; p++) {
+        mmu_read_span(pagefile, parent, mk_vaddr(p * PAGE_SIZE), page, PAGE_SIZE);
+        mmu_write_span(pagefile, child, mk_vaddr(p * PAGE_SIZE), page, PAGE_SIZE);
+    }
+    free(page);
+    return child;
+}
+
+/**
+ * Forks a warm parent, runs the children over a fresh machine and prints the row.
+ * @param cow true to fork copy-on-write, else copy eagerly
+ * @param pct the percentage of its working set each child writes
+ * @param rounds the number of times each child goes over its working set
+ */
+static void run(bool cow, int pct, long rounds) {
+    mm_spaces_init(CHILDREN + 1, SCOPE_GLOBAL);
+    mm_mem_init();
+    mm_vmem_init(pagefile);
+    pagetable_t* parent = pagetable_alloc();
+    for (pagenum_t p = 0; p < WSET + EXTRA; p++) {
+        uint8_t byte = (uint8_t)p | 1;
+        mmu_write_span(pagefile, parent, mk_vaddr(p * PAGE_SIZE), &byte, 1);
+        if (p >= WSET) {
+            mm_page_evict(pagefile, parent, p);
+        }
+    }
+    mm_stats_reset();
+
+    pagetable_t* children[CHILDREN];
+    double start = now();
+    for (int c = 0; c < CHILDREN; c++) {
+        children[c] = cow ? pagetable_fork(parent) : fork_eager(parent);
+    }
+    double forked = now() - start;
+
+    // each child writes the first pages of its working set and reads the others
+    size_t written = (size_t)WSET * pct / 100;
+    unsigned long sum = 0;
+    start = now();
+    for (long r = 0; r < rounds; r++) {
+        for (int c = 0; c < CHILDREN; c++) {
+            for (pagenum_t p = 0; p < WSET; p++) {
+                uint8_t byte = (uint8_t)(c + 2) << 1;
+                if (p < written) {
+                    mmu_write_span(pagefile, children[c], mk_vaddr(p * PAGE_SIZE), &byte, 1);
+                }
+                else {
+                    mmu_read_span(pagefile, children[c], mk_vaddr(p * PAGE_SIZE), &byte, 1);
+                    sum += byte;
+                }
+            }
+        }
+        pagetable_age(parent, true);
+    }
+    double elapsed = now() - start;
+    mmu_stats_t stats;
+    mm_stats(&stats);
+
+    unsigned long bad = 0;
+    for (pagenum_t p = 0; p < WSET + EXTRA; p++) {
+        uint8_t byte;
+        mmu_read_span(pagefile, parent, mk_vaddr(p * PAGE_SIZE), &byte, 1);
+        bad += byte != ((uint8_t)p | 1);
+        for (int c = 0; c < CHILDREN; c++) {
+            mmu_read_span(pagefile, children[c], mk_vaddr(p * PAGE_SIZE), &byte, 1);
+            bad += byte != (p < written ? (uint8_t)(c + 2) << 1 : (uint8_t)p | 1);
+        }
+    }
+    printf("%-5s %5d %10.3f %10.2f %10lu %8lu %10lu %6lu\n", cow ? "cow" : "eager", pct,
+           forked * 1e3, elapsed * 1e3, stats.cow_copies, stats.faults, stats.evictions, bad);
+
+    for (int c = 0; c < CHILDREN; c++) {
+        mm_page_evict_all(pagefile, children[c]);
+        pagetable_free(children[c]);
+    }
+    mm_page_evict_all(pagefile, parent);
+    pagetable_free(parent);
+    mm_vmem_destroy();
+    mm_mem_destroy();
+    mm_stats_reset();
+    if (sum == 1) {
+        printf("\n");
+    }
+}
+
+int main(int argc, char* argv[]) {
+    long rounds = argc > 1 ? strtol(argv[1], NULL, 10) : 20;
+    if (rounds <= 0 || !mm_geometry_init(32, 12, FRAMES)) {
+        fprintf(stderr, "usage: %s [rounds]\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    printf("%-5s %5s %10s %10s %10s %8s %10s %6s\n", "fork", "write", "fork_ms", "run_ms",
+           "cow_copies", "faults", "evictions", "bad");
+    int pcts[] = {0, 10, 50, 100};
+    for (int i = 0; i < 4; i++) {
+        run(true, pcts[i], rounds);
+        run(false, pcts[i], rounds);
+    }
+    remove(pagefile);
+    return 0;
+}
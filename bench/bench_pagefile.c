@@ -0,0 +1,94 @@
+/**
+ * @file bench_pagefile.c
+ * @brief Benchmark of page fault throughput for each page file mode.
+ *
+ * Every fault evicts a dirty page and loads a page that is not resident, so each one costs a
+ * write-back and a load from the page file.  Build and run from the repository root with:
+ *
+ *     cc -O2 -I. -o bench_pagefile bench/bench_pagefile.c mmu.c mmu_frameheap.c \
+ *         mmu_image.c mmu_pagefile.c mmu_pagemap.c mmu_policy.c mmu_readahead.c mmu_tlb.c \
+ *         mmu_zcache.c
+ *     ./bench_pagefile [faults]
+ *
+ * @author ckurdelak20@georgefox.edu
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "mmu.h"
+
+/**
+ * Returns the current monotonic time in seconds.
+ * @return the current time in seconds
+ */
+static double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * Runs the given number of faults against a fresh page file opened with the given options.  The
+ * time to close the page file is included, so that a flush at close is counted.
+ * @param pagefile the filename of the page file
+ * @param opts the page file options
+ * @param nfaults the number of faults to run
+ * @return the elapsed time in seconds, or a negative value if the page file could not be opened
+ */
+static double run(char* pagefile, const pagefile_opts_t* opts, long nfaults) {
+    if (!mm_vmem_init_opts(pagefile, opts)) {
+        return -1;
+    }
+    pagetable_t* tbl = pagetable_alloc();
+
+    double start = now();
+    for (long f = 0; f < nfaults; f++) {
+        pagenum_t pagenum = f % PAGETABLE_SIZE;
+        framenum_t framenum = f % PAGE_FRAMES;
+        // evict the page that last used this frame, writing it back
+        if (f >= (long)PAGE_FRAMES) {
+            mm_page_evict(pagefile, tbl, (pagenum_t)((f - PAGE_FRAMES) % PAGETABLE_SIZE));
+        }
+        // map the faulting page to the frame and load it
+        set_pte(tbl, pagenum, mk_pte(framenum));
+        mm_page_load(pagefile, tbl, pagenum);
+        // dirty it so its eviction is a write-back
+        frame_t* frame = pte_page(pagefile, tbl, pagenum);
+        frame->bytes[f % PAGE_SIZE] = (uint8_t)f;
+        pte_mkdirty(tbl, pagenum);
+    }
+    mm_vmem_destroy();
+    double elapsed = now() - start;
+
+    pagetable_free(tbl);
+    return elapsed;
+}
+
+int main(int argc, char* argv[]) {
+    long nfaults = argc > 1 ? strtol(argv[1], NULL, 10) : 20000;
+    char* pagefile = "bench_pagefile.sys";
+    const char* names[] = {"stdio", "pio", "mmap", "mmap-halt", "mmap-64"};
+    pagefile_opts_t modes[] = {
+        {.mode = PAGEFILE_STDIO},
+        {.mode = PAGEFILE_PIO},
+        {.mode = PAGEFILE_MMAP, .msync = MSYNC_NEVER},
+        {.mode = PAGEFILE_MMAP, .msync = MSYNC_HALT},
+        {.mode = PAGEFILE_MMAP, .msync = MSYNC_EVERY, .msync_every = 64},
+    };
+
+    mm_mem_init();
+    printf("%-10s %10s %10s %14s\n", "mode", "faults", "seconds", "faults/sec");
+    for (size_t i = 0; i < sizeof(modes) / sizeof(modes[0]); i++) {
+        double elapsed = run(pagefile, &modes[i], nfaults);
+        if (elapsed < 0) {
+            fprintf(stderr, "%s: could not open %s\n", names[i], pagefile);
+        }
+        else {
+            printf("%-10s %10ld %10.3f %14.0f\n", names[i], nfaults, elapsed, nfaults / elapsed);
+        }
+    }
+    mm_mem_destroy();
+    remove(pagefile);
+    return 0;
+}
@@ -0,0 +1,146 @@
+/**
+ * @file bench_parse.c
+ * @brief Benchmark of text command parsing, in commands per second.
+ *
+ * Writes a script of random commands to a file, then parses it twice without running anything:
+ * once the way the REPL used to (fgets, strtok, a chain of strcmps and strtoul), and once with
+ * the block reader and opcode table.  Build and run from the repository root with:
+ *
+ *     cc -O2 -I. -o bench_parse bench/bench_parse.c mmu_sim_parse.c
+ *     ./bench_parse [commands]
+ *
+ * @author ckurdelak20@georgefox.edu
+ */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "mmu_sim_parse.h"
+
+/**
+ * Returns the current monotonic time in seconds.
+ * @return the current time in seconds
+ */
+static double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * Writes a 20-digit binary literal.
+ * @param out the file to write to
+ * @param value the value
+ */
+static void put_bin(FILE* out, unsigned value) {
+    for (int i = 19; i >= 0; i--) {
+        fputc('0' + (value >> i & 1), out);
+    }
+}
+
+/**
+ * Parses the script the way the REPL used to.
+ * @param path the filename of the script
+ * @return a checksum of the parsed arguments
+ */
+static unsigned long parse_legacy(const char* path) {
+    FILE* in = fopen(path, "r");
+    unsigned long sum = 0;
+    char cmd[255];
+    while (fgets(cmd, 255, in) != NULL) {
+        char* args[255];
+        memset(args, 0, sizeof(args));
+        char* token = strtok(cmd, " \n");
+        for (int i = 0; token != NULL; i++) {
+            args[i] = token;
+            token = strtok(NULL, " \n\t");
+        }
+        if (strcmp(args[0], "READ") == 0) {
+            sum += strtoul(args[1], NULL, 2);
+        }
+        else if (strcmp(args[0], "READN") == 0) {
+            sum += strtoul(args[1], NULL, 2) + strtol(args[2], NULL, 10);
+        }
+        else if (strcmp(args[0], "WRITE") == 0) {
+            sum += strtoul(args[1], NULL, 2) + strtoul(args[2], NULL, 2);
+        }
+        else if (strcmp(args[0], "WRITEDW") == 0) {
+            sum += strtoul(args[1], NULL, 2);
+            for (int i = 2; i < 6; i++) {
+                sum += strtoul(args[i], NULL, 2);
+            }
+        }
+    }
+    fclose(in);
+    return sum;
+}
+
+/**
+ * Parses the script with the block reader and opcode table.
+ * @param path the filename of the script
+ * @return a checksum of the parsed arguments
+ */
+static unsigned long parse_table(const char* path) {
+    int fd = open(path, O_RDONLY);
+    cmd_reader_t* reader = cmd_reader_alloc(fd);
+    unsigned long sum = 0;
+    const char* line;
+    size_t len;
+    cmd_t cmd;
+    while (cmd_reader_next(reader, &line, &len) != PARSE_EOF) {
+        if (cmd_parse(line, len, &cmd) == PARSE_OK) {
+            int nargs = cmd.op == CMD_READ ? 1 : cmd.op == CMD_WRITEDW ? 5 : 2;
+            for (int i = 0; i < nargs; i++) {
+                sum += cmd.args[i];
+            }
+        }
+    }
+    cmd_reader_free(reader);
+    close(fd);
+    return sum;
+}
+
+int main(int argc, char* argv[]) {
+    long n = argc > 1 ? strtol(argv[1], NULL, 10) : 1000000;
+    const char* path = "bench_parse.txt";
+
+    // a mix of the commands the REPL sees most
+    FILE* out = fopen(path, "w");
+    srand(460);
+    for (long i = 0; i < n; i++) {
+        int kind = rand() % 4;
+        const char* names[] = {"READ", "READN", "WRITE", "WRITEDW"};
+        fputs(names[kind], out);
+        fputc(' ', out);
+        put_bin(out, rand() & 0xfffff);
+        if (kind == 1) {
+            fprintf(out, " %d", rand() % 8192);
+        }
+        else if (kind == 2) {
+            fprintf(out, " %d%d%d%d%d%d%d%d", rand() & 1, rand() & 1, rand() & 1, rand() & 1,
+                    rand() & 1, rand() & 1, rand() & 1, rand() & 1);
+        }
+        else if (kind == 3) {
+            fputs(" 1 10 11 100", out);
+        }
+        fputc('\n', out);
+    }
+    fclose(out);
+
+    printf("%-8s %10s %14s %20s\n", "parser", "commands", "commands/sec", "checksum");
+    double start = now();
+    unsigned long sum = parse_legacy(path);
+    double elapsed = now() - start;
+    printf("%-8s %10ld %14.0f %20lu\n", "legacy", n, n / elapsed, sum);
+
+    start = now();
+    sum = parse_table(path);
+    elapsed = now() - start;
+    printf("%-8s %10ld %14.0f %20lu\n", "table", n, n / elapsed, sum);
+
+    remove(path);
+    return 0;
+}
@@ -0,0 +1,135 @@
+/**
+ * @file bench_readahead.c
+ * @brief Benchmark of sequential readahead, on the faulting thread and on a background I/O thread.
+ *
+ * Each pass first writes a pattern into every page of a region four times the size of memory and
+ * evicts it all, then reads whole pages back from a PIO page file in one of three orders: one
+ * page after the next, every third page, and uniformly random pages.  Every byte read is checked
+ * against the pattern.  Passes run without readahead, with readahead on the faulting thread, and
+ * with readahead on the I/O thread, and report ns per page read, faults per 1000 pages, and the
+ * pages read ahead, used and wasted.  Build and run from the repository root with:
+ *
+ *     cc -O2 -pthread -I. -o bench_readahead bench/bench_readahead.c mmu.c mmu_frameheap.c \
+ *         mmu_image.c mmu_pagefile.c mmu_pagemap.c mmu_policy.c mmu_readahead.c mmu_tlb.c \
+ *         mmu_zcache.c
+ *     ./bench_readahead [pages read per pass] [readahead window]
+ *
+ * @author ckurdelak20@georgefox.edu
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "mmu.h"
+
+#define FRAMES   256             /* page frames */
+#define REGION   (4 * FRAMES)    /* pages written and read back */
+
+static char* pagefile = "bench_readahead.sys";
+
+/**
+ * Returns the current monotonic time in seconds.
+ * @return the current time in seconds
+ */
+static double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * Returns the byte stored at an address of the region.
+ * @param addr the virtual address
+ * @return the byte expected at the address
+ */
+static uint8_t pattern(uint64_t addr) {
+    return (uint8_t)(addr / PAGE_SIZE * 7 + addr % 253);
+}
+
+/**
+ * Runs one pass over a fresh machine and prints its row.
+ * @param mode the name of the readahead mode
+ * @param order 0 for sequential, 1 for every third page, 2 for random pages
+ * @param n the number of pages to read
+ */
+static void run(const char* mode, int order, long n) {
+    const char* orders[] = {"seq", "stride", "random"};
+    pagefile_opts_t opts = {.mode = PAGEFILE_PIO};
+    mm_mem_init();
+    mm_vmem_init_opts(pagefile, &opts);
+    pagetable_t* tbl = pagetable_alloc();
+    uint8_t* page = malloc(PAGE_SIZE);
+
+    // write the region, then push it all out to the page file
+    for (pagenum_t p = 0; p < REGION; p++) {
+        for (size_t b = 0; b < PAGE_SIZE; b++) {
+            page[b] = pattern(p * PAGE_SIZE + b);
+        }
+        mmu_write_span(pagefile, tbl, mk_vaddr(p * PAGE_SIZE), page, PAGE_SIZE);
+    }
+    mm_page_evict_all(pagefile, tbl);
+    mm_stats_reset();
+
+    unsigned long bad = 0;
+    uint64_t seed = 460;
+    double start = now();
+    for (long i = 0; i < n; i++) {
+        pagenum_t p = i % REGION;
+        if (order == 1) {
+            p = i * 3 % REGION;
+        }
+        else if (order == 2) {
+            seed ^= seed << 13;
+            seed ^= seed >> 7;
+            seed ^= seed << 17;
+            p = seed % REGION;
+        }
+        mmu_read_span(pagefile, tbl, mk_vaddr(p * PAGE_SIZE), page, PAGE_SIZE);
+        for (size_t b = 0; b < PAGE_SIZE; b++) {
+            bad += page[b] != pattern(p * PAGE_SIZE + b);
+        }
+        if (i % 16 == 0) {
+            pagetable_age(tbl, true);
+        }
+    }
+    double elapsed = now() - start;
+
+    mmu_stats_t stats;
+    mm_stats(&stats);
+    printf("%-8s %-7s %10.0f %10.2f %11lu %9lu %8lu %6lu\n", orders[order], mode,
+           elapsed * 1e9 / n, stats.faults * 1e3 / n, stats.prefetches, stats.prefetch_hits,
+           stats.prefetch_wasted, bad);
+
+    free(page);
+    mm_page_evict_all(pagefile, tbl);
+    pagetable_free(tbl);
+    mm_vmem_destroy();
+    mm_mem_destroy();
+    mm_stats_reset();
+}
+
+int main(int argc, char* argv[]) {
+    long n = argc > 1 ? strtol(argv[1], NULL, 10) : 20000;
+    size_t window = argc > 2 ? strtoul(argv[2], NULL, 10) : 32;
+    if (!mm_geometry_init(24, 12, FRAMES)) {
+        fprintf(stderr, "usage: %s [pages read per pass] [readahead window]\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    printf("%-8s %-7s %10s %10s %11s %9s %8s %6s\n", "order", "mode", "ns/page", "faults/1k",
+           "prefetches", "hits", "wasted", "bad");
+    for (int order = 0; order <= 2; order++) {
+        mm_readahead_init(0, false);
+        run("off", order, n);
+        mm_readahead_init(window, false);
+        run("sync", order, n);
+    }
+    // threads cannot be turned off again, so the background passes come last
+    mm_threads_init();
+    for (int order = 0; order <= 2; order++) {
+        mm_readahead_init(window, true);
+        run("async", order, n);
+    }
+    remove(pagefile);
+    return 0;
+}
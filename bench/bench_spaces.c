@@ -0,0 +1,117 @@
+/**
+ * @file bench_spaces.c
+ * @brief Benchmark of multi-tenant contention for a shared frame pool.
+ *
+ * For 1 to 16 processes, each with its own address space, runs every process in turn for a time
+ * slice of accesses, 80% of them to a small hot set of its pages and the rest spread over a larger
+ * cold set, under global and then local replacement.  Reports faults per thousand accesses over
+ * all processes and for the luckiest and unluckiest process, and the number of pages evicted.
+ * Build and run from the repository root with:
+ *
+ *     cc -O2 -I. -o bench_spaces bench/bench_spaces.c mmu.c mmu_frameheap.c \
+ *         mmu_image.c mmu_pagefile.c mmu_pagemap.c mmu_policy.c mmu_readahead.c mmu_tlb.c \
+ *         mmu_zcache.c
+ *     ./bench_spaces [accesses per process] [aging|clock|lru|wsclock|arc|2q]
+ *
+ * @author ckurdelak20@georgefox.edu
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "mmu.h"
+
+#define FRAMES      64     /* frames shared by every process */
+#define HOT_PAGES   12     /* pages of each process's hot set */
+#define COLD_PAGES  48     /* pages of each process's cold set, after the hot set */
+#define SLICE       200    /* accesses a process makes before the next one runs */
+#define TICK        8      /* accesses per aging tick */
+
+/**
+ * Returns the next number of a 64-bit xorshift generator.
+ * @param state the generator state, which must not be zero
+ * @return the next pseudo-random number
+ */
+static uint64_t next_rand(uint64_t* state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+int main(int argc, char* argv[]) {
+    long n = argc > 1 ? strtol(argv[1], NULL, 10) : 200000;
+    policy_kind_t kind = POLICY_AGING;
+    while (argc > 2 && kind < POLICY_COUNT && strcmp(argv[2], mm_policy_name(kind)) != 0) {
+        kind++;
+    }
+    if (kind == POLICY_COUNT || !mm_geometry_init(20, 12, FRAMES)) {
+        fprintf(stderr, "usage: %s [accesses per process] [aging|clock|lru|wsclock|arc|2q]\n",
+                argv[0]);
+        exit(EXIT_FAILURE);
+    }
+    char* pagefile = "bench_spaces.sys";
+    pagefile_opts_t opts = {.mode = PAGEFILE_MMAP};
+    const char* scopes[] = {"global", "local"};
+
+    printf("%-6s %-7s %12s %12s %12s %12s\n", "procs", "scope", "faults/1k", "best/1k",
+           "worst/1k", "evicted");
+    for (size_t procs = 1; procs <= 16; procs <<= 1) {
+        for (int scope = SCOPE_GLOBAL; scope <= SCOPE_LOCAL; scope++) {
+            // a fresh machine for each run
+            mm_spaces_init(procs, (replace_scope_t)scope);
+            mm_mem_init();
+            mm_policy_init(kind);
+            mm_vmem_init_opts(pagefile, &opts);
+            pagetable_t* tbls[16];
+            for (size_t p = 0; p < procs; p++) {
+                tbls[p] = pagetable_alloc();
+            }
+
+            // the same accesses for every scope
+            uint64_t seed = 460;
+            long total = n * (long)procs;
+            for (long i = 0; i < total; i++) {
+                pagetable_t* tbl = tbls[i / SLICE % procs];
+                uint64_t r = next_rand(&seed);
+                pagenum_t pagenum = r % 5 != 0 ? r / 5 % HOT_PAGES
+                                               : HOT_PAGES + r / 5 % COLD_PAGES;
+                pte_page(pagefile, tbl, pagenum);
+                if (r % 3 == 0) {
+                    pte_mkdirty(tbl, pagenum);
+                }
+                if (i % TICK == 0) {
+                    pagetable_age(tbl, true);
+                }
+            }
+
+            // how the faults were shared out
+            mmu_stats_t stats;
+            mm_stats(&stats);
+            double all = stats.faults * 1e3 / total;
+            double best = 1e3;
+            double worst = 0;
+            unsigned long evicted = 0;
+            for (size_t p = 0; p < procs; p++) {
+                mmu_stats_t own;
+                mm_space_stats(p, &own);
+                double rate = own.accesses > 0 ? own.faults * 1e3 / own.accesses : 0;
+                best = rate < best ? rate : best;
+                worst = rate > worst ? rate : worst;
+                evicted += own.evictions;
+            }
+            printf("%-6zu %-7s %12.2f %12.2f %12.2f %12lu\n", procs, scopes[scope], all, best,
+                   worst, evicted);
+
+            for (size_t p = 0; p < procs; p++) {
+                mm_page_evict_all(pagefile, tbls[p]);
+                pagetable_free(tbls[p]);
+            }
+            mm_vmem_destroy();
+            mm_mem_destroy();
+            mm_stats_reset();
+        }
+    }
+    remove(pagefile);
+    return 0;
+}
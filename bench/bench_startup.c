@@ -0,0 +1,88 @@
+/**
+ * @file bench_startup.c
+ * @brief Benchmark of page file creation time for each way of zeroing it.
+ *
+ * Each run times mm_vmem_init_opts() from an existing, dirty page file to a fresh all-zero one,
+ * then checks that a page read back from the new file really is all zeros.  Build and run from
+ * the repository root with:
+ *
+ *     cc -O2 -I. -o bench_startup bench/bench_startup.c mmu.c mmu_frameheap.c \
+ *         mmu_image.c mmu_pagefile.c mmu_pagemap.c mmu_policy.c mmu_readahead.c mmu_tlb.c \
+ *         mmu_zcache.c
+ *     ./bench_startup [runs]
+ *
+ * @author ckurdelak20@georgefox.edu
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "mmu.h"
+
+/**
+ * Returns the current monotonic time in seconds.
+ * @return the current time in seconds
+ */
+static double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * Dirties the last page of the page file, so that the next init has to discard it.
+ * @param pagefile the filename of the page file
+ * @param tbl the page table
+ * @return true if the last page reads back as all zeros before it is dirtied
+ */
+static bool dirty_last_page(char* pagefile, pagetable_t* tbl) {
+    pagenum_t pagenum = PAGETABLE_SIZE - 1;
+    set_pte(tbl, pagenum, mk_pte(0));
+    mm_page_load(pagefile, tbl, pagenum);
+    frame_t* frame = pte_page(pagefile, tbl, pagenum);
+    bool zero = true;
+    for (size_t i = 0; i < PAGE_SIZE; i++) {
+        zero = zero && frame->bytes[i] == 0;
+    }
+    frame->bytes[0] = 0xff;
+    pte_mkdirty(tbl, pagenum);
+    mm_page_evict(pagefile, tbl, pagenum);
+    return zero;
+}
+
+int main(int argc, char* argv[]) {
+    int runs = argc > 1 ? atoi(argv[1]) : 20;
+    char* pagefile = "bench_startup.sys";
+    const char* names[] = {"fill", "sparse", "fallocate"};
+    pagefile_create_t creates[] = {PAGEFILE_ZERO_FILL, PAGEFILE_SPARSE, PAGEFILE_FALLOCATE};
+
+    mm_mem_init();
+    pagetable_t* tbl = pagetable_alloc();
+    printf("%-10s %6s %14s %6s\n", "create", "runs", "ms/init", "zero");
+    for (size_t i = 0; i < sizeof(creates) / sizeof(creates[0]); i++) {
+        pagefile_opts_t opts = {.mode = PAGEFILE_PIO, .create = creates[i]};
+        double elapsed = 0;
+        bool zero = true;
+        bool success = true;
+        for (int r = 0; success && r < runs; r++) {
+            double start = now();
+            success = mm_vmem_init_opts(pagefile, &opts);
+            elapsed += now() - start;
+            if (success) {
+                zero = dirty_last_page(pagefile, tbl) && zero;
+                mm_vmem_destroy();
+            }
+        }
+        if (!success) {
+            fprintf(stderr, "%s: could not create %s\n", names[i], pagefile);
+        }
+        else {
+            printf("%-10s %6d %14.3f %6s\n", names[i], runs, elapsed * 1e3 / runs,
+                   zero ? "yes" : "NO");
+        }
+    }
+    pagetable_free(tbl);
+    mm_mem_destroy();
+    remove(pagefile);
+    return 0;
+}
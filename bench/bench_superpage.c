@@ -0,0 +1,121 @@
+/**
+ * @file bench_superpage.c
+ * @brief Benchmark of mapping aligned runs of pages as superpages.
+ *
+ * Each pass sweeps a buffer a byte per page, writing every eighth page, through a 16-entry TLB.
+ * A buffer of half the size of memory stays resident, so its cost is in TLB misses; a buffer of
+ * twice the size of memory is evicted and faulted back in every sweep.  Passes run without
+ * superpages and with superpages of 16 and 64 pages, and report the time per access, the TLB hit
+ * rate and the hits on superpage entries, the faults and the ones that brought in a whole
+ * superpage, and the superpages promoted and demoted.  At the end every page touched is read back
+ * and checked.  Build and run from the repository root with:
+ *
+ *     cc -O2 -pthread -I. -o bench_superpage bench/bench_superpage.c mmu.c mmu_frameheap.c \
+ *         mmu_image.c mmu_pagefile.c mmu_pagemap.c mmu_policy.c mmu_readahead.c mmu_tlb.c \
+ *         mmu_zcache.c
+ *     ./bench_superpage [sweeps]
+ *
+ * @author ckurdelak20@georgefox.edu
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "mmu.h"
+#include "mmu_tlb.h"
+
+#define FRAMES   256    /* page frames */
+#define TLB      16     /* TLB entries */
+
+static char* pagefile = "bench_superpage.sys";
+
+/**
+ * Returns the current monotonic time in seconds.
+ * @return the current time in seconds
+ */
+static double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * Runs one pass over a fresh machine and prints its row.
+ * @param order log2 of the pages in a superpage, or 0 for none
+ * @param pages the pages in the buffer
+ * @param sweeps the number of sweeps over the buffer
+ */
+static void run(unsigned order, size_t pages, long sweeps) {
+    mm_superpages_init(order);
+    mm_mem_init();
+    mm_vmem_init(pagefile);
+    pagetable_t* tbl = pagetable_alloc();
+    tbl->tlb = tlb_alloc(TLB, 0, TLB_LRU);
+    // the byte last written to the start of each page, to check against at the end
+    uint8_t* last = calloc(pages, sizeof(uint8_t));
+
+    unsigned long sum = 0;
+    double start = now();
+    for (long s = 0; s < sweeps; s++) {
+        for (pagenum_t p = 0; p < pages; p++) {
+            uint8_t byte = (uint8_t)(s + p) | 1;
+            if (p % 8 == 0) {
+                mmu_write_span(pagefile, tbl, mk_vaddr(p * PAGE_SIZE), &byte, 1);
+                last[p] = byte;
+            }
+            else {
+                mmu_read_span(pagefile, tbl, mk_vaddr(p * PAGE_SIZE), &byte, 1);
+                sum += byte;
+            }
+        }
+        pagetable_age(tbl, true);
+    }
+    double elapsed = now() - start;
+    mmu_stats_t stats;
+    mm_stats(&stats);
+    unsigned long lookups = tbl->tlb->hits + tbl->tlb->misses;
+    double hit_rate = lookups > 0 ? (double)tbl->tlb->hits / lookups : 0.0;
+    unsigned long huge_hits = tbl->tlb->huge_hits;
+
+    mm_page_evict_all(pagefile, tbl);
+    unsigned long bad = 0;
+    for (pagenum_t p = 0; p < pages; p++) {
+        uint8_t byte;
+        mmu_read_span(pagefile, tbl, mk_vaddr(p * PAGE_SIZE), &byte, 1);
+        bad += byte != last[p];
+    }
+    printf("%6u %6zu %10.1f %8.4f %10lu %8lu %10lu %10lu %9lu %6lu\n", order, pages,
+           stats.accesses > 0 ? elapsed * 1e9 / stats.accesses : 0.0, hit_rate, huge_hits,
+           stats.faults, stats.superpage_faults, stats.promotions, stats.demotions, bad);
+
+    free(last);
+    mm_page_evict_all(pagefile, tbl);
+    pagetable_free(tbl);
+    mm_vmem_destroy();
+    mm_mem_destroy();
+    mm_stats_reset();
+    if (sum == 1) {
+        printf("\n");
+    }
+}
+
+int main(int argc, char* argv[]) {
+    long sweeps = argc > 1 ? strtol(argv[1], NULL, 10) : 200;
+    if (sweeps <= 0 || !mm_geometry_init(24, 12, FRAMES)) {
+        fprintf(stderr, "usage: %s [sweeps]\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    printf("%6s %6s %10s %8s %10s %8s %10s %10s %9s %6s\n", "order", "pages", "ns/access",
+           "tlb_hit", "huge_hits", "faults", "sp_faults", "promotions", "demotions", "bad");
+    size_t sizes[] = {FRAMES / 2, FRAMES * 2};
+    unsigned orders[] = {0, 4, 6};
+    for (int s = 0; s < 2; s++) {
+        for (int o = 0; o < 3; o++) {
+            run(orders[o], sizes[s], sweeps);
+        }
+    }
+    remove(pagefile);
+    return 0;
+}
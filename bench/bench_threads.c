@@ -0,0 +1,213 @@
+/**
+ * @file bench_threads.c
+ * @brief Benchmark of concurrent memory access from 1 to 8 threads.
+ *
+ * The pages of one shared address space are split evenly among the threads, and each thread first
+ * writes a pattern of its own into every byte of its pages, then runs one of three workloads:
+ * single-byte reads of pages that stay resident, page-sized copies in and out of pages that stay
+ * resident, and page-sized reads of twice as many pages as there are frames, so that about half
+ * of them fault against a PIO page file.  Every byte read is checked against the pattern.  Reports
+ * operations per second, the speedup over one thread, and the faults and mismatched bytes.  Under
+ * aging, accesses to resident pages take no MMU lock, so only they can scale with the threads; the
+ * other policies take the lock on every access, and faults take it under any policy.  Build and
+ * run from the repository root with:
+ *
+ *     cc -O2 -pthread -I. -o bench_threads bench/bench_threads.c mmu.c mmu_frameheap.c \
+ *         mmu_image.c mmu_pagefile.c mmu_pagemap.c mmu_policy.c mmu_readahead.c mmu_tlb.c \
+ *         mmu_zcache.c
+ *     ./bench_threads [operations] [aging|clock|lru|wsclock|arc|2q]
+ *
+ * @author ckurdelak20@georgefox.edu
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "mmu.h"
+
+#define FRAMES       256    /* frames shared by every thread */
+#define MAX_THREADS  8      /* most threads run at once */
+#define HOT_PAGES    128    /* pages shared out among the threads for the resident workloads */
+#define COLD_PAGES   512    /* pages shared out among the threads for the faulting workload */
+#define TICK         64     /* operations per aging tick of each thread */
+
+/**
+ * @struct worker_t
+ * @brief The work of one thread.
+ */
+typedef struct {
+    pagetable_t* tbl;     /**< the shared page table */
+    int workload;         /**< 0 for byte reads, 1 for page copies, 2 for faulting reads */
+    size_t id;            /**< the thread number, which picks its pages and its pattern */
+    size_t pages;         /**< pages the thread owns */
+    long ops;             /**< operations to run */
+    unsigned long bad;    /**< bytes read back wrong */
+} worker_t;
+
+static char* pagefile = "bench_threads.sys";
+
+/**
+ * Returns the current monotonic time in seconds.
+ * @return the current time in seconds
+ */
+static double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * Returns the next number of a 64-bit xorshift generator.
+ * @param state the generator state, which must not be zero
+ * @return the next pseudo-random number
+ */
+static uint64_t next_rand(uint64_t* state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+/**
+ * Returns the byte a thread stores at an address it owns.
+ * @param id the thread number
+ * @param addr the virtual address
+ * @return the byte expected at the address
+ */
+static uint8_t pattern(size_t id, uint64_t addr) {
+    return (uint8_t)(id * 37 + addr / PAGE_SIZE * 11 + addr % 251);
+}
+
+/**
+ * Fills the pages of one thread with its pattern.
+ * @param arg the worker_t of the thread
+ * @return NULL
+ */
+static void* fill(void* arg) {
+    worker_t* w = arg;
+    uint8_t* page = malloc(PAGE_SIZE);
+    for (size_t p = 0; p < w->pages; p++) {
+        uint64_t base = (w->id * w->pages + p) * PAGE_SIZE;
+        for (size_t b = 0; b < PAGE_SIZE; b++) {
+            page[b] = pattern(w->id, base + b);
+        }
+        mmu_write_span(pagefile, w->tbl, mk_vaddr(base), page, PAGE_SIZE);
+    }
+    free(page);
+    return NULL;
+}
+
+/**
+ * Runs the workload of one thread over its pages, checking every byte read.
+ * @param arg the worker_t of the thread
+ * @return NULL
+ */
+static void* work(void* arg) {
+    worker_t* w = arg;
+    uint8_t* page = malloc(PAGE_SIZE);
+    uint64_t seed = 460 + w->id;
+    for (long i = 0; i < w->ops; i++) {
+        uint64_t r = next_rand(&seed);
+        uint64_t base = (w->id * w->pages + r % w->pages) * PAGE_SIZE;
+        if (w->workload == 0) {
+            // a small read that hits
+            uint64_t addr = base + r / w->pages % PAGE_SIZE;
+            uint8_t byte;
+            mmu_read_span(pagefile, w->tbl, mk_vaddr(addr), &byte, 1);
+            w->bad += byte != pattern(w->id, addr);
+        }
+        else {
+            // a whole page read, or written back unchanged every other time
+            mmu_read_span(pagefile, w->tbl, mk_vaddr(base), page, PAGE_SIZE);
+            for (size_t b = 0; b < PAGE_SIZE; b++) {
+                w->bad += page[b] != pattern(w->id, base + b);
+            }
+            if (w->workload == 1 && r % 2 == 0) {
+                mmu_write_span(pagefile, w->tbl, mk_vaddr(base), page, PAGE_SIZE);
+            }
+        }
+        if (i % TICK == 0) {
+            pagetable_age(w->tbl, true);
+        }
+    }
+    free(page);
+    return NULL;
+}
+
+/**
+ * Runs one function on every worker, each in its own thread, and waits for them all.
+ * @param fn the function to run
+ * @param workers the workers
+ * @param threads the number of workers
+ */
+static void run(void* (*fn)(void*), worker_t* workers, size_t threads) {
+    pthread_t ids[MAX_THREADS];
+    for (size_t t = 0; t < threads; t++) {
+        pthread_create(&ids[t], NULL, fn, &workers[t]);
+    }
+    for (size_t t = 0; t < threads; t++) {
+        pthread_join(ids[t], NULL);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    long n = argc > 1 ? strtol(argv[1], NULL, 10) : 400000;
+    policy_kind_t kind = POLICY_AGING;
+    while (argc > 2 && kind < POLICY_COUNT && strcmp(argv[2], mm_policy_name(kind)) != 0) {
+        kind++;
+    }
+    if (kind == POLICY_COUNT || !mm_geometry_init(24, 12, FRAMES) || !mm_threads_init()) {
+        fprintf(stderr, "usage: %s [operations] [aging|clock|lru|wsclock|arc|2q]\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+    pagefile_opts_t opts = {.mode = PAGEFILE_PIO};
+    const char* workloads[] = {"read", "copy", "fault"};
+
+    printf("%-6s %-8s %14s %9s %10s %8s\n", "work", "threads", "ops/s", "speedup", "faults/1k",
+           "bad");
+    for (int workload = 0; workload <= 2; workload++) {
+        // the copies run a page at a time, so fewer of them
+        long ops = workload == 0 ? n * 10 : n;
+        double base = 0;
+        for (size_t threads = 1; threads <= MAX_THREADS; threads <<= 1) {
+            // a fresh machine for each run
+            mm_mem_init();
+            mm_policy_init(kind);
+            mm_vmem_init_opts(pagefile, &opts);
+            pagetable_t* tbl = pagetable_alloc();
+            size_t pages = (workload == 2 ? COLD_PAGES : HOT_PAGES) / threads;
+            worker_t workers[MAX_THREADS];
+            for (size_t t = 0; t < threads; t++) {
+                workers[t] = (worker_t){.tbl = tbl, .workload = workload, .id = t,
+                                        .pages = pages, .ops = ops / threads, .bad = 0};
+            }
+            run(fill, workers, threads);
+            mm_stats_reset();
+
+            double start = now();
+            run(work, workers, threads);
+            double elapsed = now() - start;
+
+            mmu_stats_t stats;
+            mm_stats(&stats);
+            unsigned long bad = 0;
+            for (size_t t = 0; t < threads; t++) {
+                bad += workers[t].bad;
+            }
+            double rate = ops / elapsed;
+            base = threads == 1 ? rate : base;
+            printf("%-6s %-8zu %14.0f %8.2fx %10.2f %8lu\n", workloads[workload], threads, rate,
+                   rate / base, stats.faults * 1e3 / stats.accesses, bad);
+
+            mm_page_evict_all(pagefile, tbl);
+            pagetable_free(tbl);
+            mm_vmem_destroy();
+            mm_mem_destroy();
+            mm_stats_reset();
+        }
+    }
+    remove(pagefile);
+    return 0;
+}
@@ -0,0 +1,113 @@
+/**
+ * @file bench_tlb.c
+ * @brief Benchmark of TLB hit rates and of the TLB fast path.
+ *
+ * The first table replays a page trace through TLBs of different shapes and policies on their
+ * own, to size a TLB against a workload.  The second times pte_page() on resident pages with and
+ * without a TLB in front of it.  Build and run from the repository root with:
+ *
+ *     cc -O2 -I. -o bench_tlb bench/bench_tlb.c mmu.c mmu_frameheap.c \
+ *         mmu_image.c mmu_pagefile.c mmu_pagemap.c mmu_policy.c mmu_readahead.c mmu_tlb.c \
+ *         mmu_zcache.c
+ *     ./bench_tlb [accesses]
+ *
+ * @author ckurdelak20@georgefox.edu
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "mmu.h"
+#include "mmu_tlb.h"
+
+/**
+ * Returns the current monotonic time in seconds.
+ * @return the current time in seconds
+ */
+static double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * Fills the trace with a loop over a working set of pages, with one access in eight going to a
+ * uniformly random page instead.
+ * @param trace the trace to be filled
+ * @param n the length of the trace
+ * @param wset the size of the working set
+ * @param npages the number of pages random accesses are drawn from
+ */
+static void make_trace(pagenum_t* trace, long n, int wset, int npages) {
+    srand(460);
+    for (long i = 0; i < n; i++) {
+        trace[i] = (rand() % 8 == 0) ? rand() % npages : i % wset;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    long n = argc > 1 ? strtol(argv[1], NULL, 10) : 1000000;
+    pagenum_t* trace = malloc(n * sizeof(pagenum_t));
+    const char* policies[] = {"lru", "fifo", "random"};
+    size_t sizes[] = {4, 8, 16, 32};
+    size_t ways[] = {1, 2, 4, 0};
+
+    // hit rates of the TLB on its own
+    make_trace(trace, n, 12, PAGETABLE_SIZE);
+    printf("%-8s %8s %6s %10s %12s\n", "policy", "entries", "ways", "hit rate", "ns/lookup");
+    for (int p = 0; p < 3; p++) {
+        for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+            for (size_t w = 0; w < sizeof(ways) / sizeof(ways[0]); w++) {
+                tlb_t* tlb = tlb_alloc(sizes[s], ways[w], (tlb_policy_t)p);
+                framenum_t framenum;
+                double start = now();
+                for (long i = 0; i < n; i++) {
+                    if (!tlb_lookup(tlb, trace[i], &framenum)) {
+                        tlb_insert(tlb, trace[i], trace[i] % PAGE_FRAMES);
+                    }
+                }
+                double elapsed = now() - start;
+                printf("%-8s %8zu %6zu %10.4f %12.2f\n", policies[p], sizes[s], tlb->ways,
+                       (double)tlb->hits / n, elapsed * 1e9 / n);
+                tlb_free(tlb);
+            }
+        }
+    }
+
+    // pte_page on resident pages, with and without a TLB
+    char* pagefile = "bench_tlb.sys";
+    mm_mem_init();
+    mm_vmem_init(pagefile);
+    make_trace(trace, n, PAGE_FRAMES, PAGE_FRAMES);
+    printf("\n%-8s %12s %10s\n", "tlb", "ns/access", "hit rate");
+    for (int with_tlb = 0; with_tlb <= 1; with_tlb++) {
+        pagetable_t* tbl = pagetable_alloc();
+        if (with_tlb) {
+            tbl->tlb = tlb_alloc(PAGE_FRAMES, 0, TLB_LRU);
+        }
+        // fault every page in before timing
+        for (pagenum_t p = 0; p < PAGE_FRAMES; p++) {
+            pte_page(pagefile, tbl, p);
+        }
+        unsigned long sum = 0;
+        double start = now();
+        for (long i = 0; i < n; i++) {
+            sum += pte_page(pagefile, tbl, trace[i])->bytes[i % PAGE_SIZE];
+        }
+        double elapsed = now() - start;
+        printf("%-8s %12.2f %10.4f\n", with_tlb ? "16-full" : "none", elapsed * 1e9 / n,
+               with_tlb ? (double)tbl->tlb->hits / (tbl->tlb->hits + tbl->tlb->misses) : 0.0);
+        for (int p = 0; p < (int)PAGE_FRAMES; p++) {
+            mm_page_evict(pagefile, tbl, (pagenum_t)p);
+        }
+        pagetable_free(tbl);
+        if (sum == 1) {
+            printf("\n");
+        }
+    }
+    mm_vmem_destroy();
+    mm_mem_destroy();
+    remove(pagefile);
+    free(trace);
+    return 0;
+}
@@ -0,0 +1,115 @@
+/**
+ * @file bench_victim.c
+ * @brief Benchmark of page replacement victim selection.
+ *
+ * The first table compares, for growing page table sizes, the old linear scan over every page
+ * table entry against the frame heap, which only ever holds the PAGE_FRAMES resident frames.  The
+ * second runs replacement faults end to end through pte_page().  Build and run from the
+ * repository root with:
+ *
+ *     cc -O2 -I. -o bench_victim bench/bench_victim.c mmu.c mmu_frameheap.c \
+ *         mmu_image.c mmu_pagefile.c mmu_pagemap.c mmu_policy.c mmu_readahead.c mmu_tlb.c \
+ *         mmu_zcache.c
+ *     ./bench_victim [replacements]
+ *
+ * @author ckurdelak20@georgefox.edu
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "mmu.h"
+#include "mmu_frameheap.h"
+
+/**
+ * Returns the current monotonic time in seconds.
+ * @return the current time in seconds
+ */
+static double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * Finds the page with the smallest aging counter by scanning every entry, as aging_alg() did.
+ * @param entries the page table entries
+ * @param size the number of page table entries
+ * @return the index of the oldest entry
+ */
+static size_t scan_oldest(const pte_t* entries, size_t size) {
+    size_t oldest = 0;
+    uint8_t oldest_age = 0b11111111;
+    for (size_t i = 0; i < size; i++) {
+        if (entries[i].age < oldest_age) {
+            oldest_age = entries[i].age;
+            oldest = i;
+        }
+    }
+    return oldest;
+}
+
+int main(int argc, char* argv[]) {
+    long n = argc > 1 ? strtol(argv[1], NULL, 10) : 100000;
+    volatile size_t sink = 0;
+
+    // victim selection alone, as the page table grows
+    printf("%-10s %14s %14s\n", "ptes", "scan ns/op", "heap ns/op");
+    for (size_t size = PAGETABLE_SIZE; size <= (1UL << 20); size <<= 2) {
+        pte_t* entries = calloc(size, sizeof(pte_t));
+        frameheap_t* heap = frameheap_alloc(PAGE_FRAMES);
+        srand(460);
+        for (size_t i = 0; i < size; i++) {
+            entries[i].age = 1 + rand() % 255;
+        }
+        for (framenum_t f = 0; f < PAGE_FRAMES; f++) {
+            frameheap_push(heap, f, entries[f].age);
+        }
+
+        long reps = n / (long)(size / PAGETABLE_SIZE) + 1;
+        double start = now();
+        for (long r = 0; r < reps; r++) {
+            sink += scan_oldest(entries, size);
+        }
+        double scan = (now() - start) * 1e9 / reps;
+
+        start = now();
+        for (long r = 0; r < n; r++) {
+            // evict the oldest frame and bring a new page into it
+            framenum_t victim;
+            frameheap_min(heap, &victim);
+            frameheap_remove(heap, victim);
+            frameheap_push(heap, victim, (uint8_t)(r * 37));
+            sink += victim;
+        }
+        double fheap = (now() - start) * 1e9 / n;
+
+        printf("%-10zu %14.2f %14.2f\n", size, scan, fheap);
+        frameheap_free(heap);
+        free(entries);
+    }
+
+    // replacement faults through pte_page, cycling over more pages than there are frames
+    char* pagefile = "bench_victim.sys";
+    pagefile_opts_t opts = {.mode = PAGEFILE_MMAP};
+    mm_mem_init();
+    mm_vmem_init_opts(pagefile, &opts);
+    pagetable_t* tbl = pagetable_alloc();
+    double start = now();
+    for (long r = 0; r < n; r++) {
+        pagenum_t pagenum = r % PAGETABLE_SIZE;
+        for (size_t i = 0; i < PAGETABLE_SIZE; i++) {
+            pte_mkold(tbl, i);
+        }
+        sink += pte_page(pagefile, tbl, pagenum)->bytes[0];
+    }
+    double elapsed = now() - start;
+    printf("\n%-10s %14s\n", "faults", "ns/fault");
+    printf("%-10ld %14.2f\n", n, elapsed * 1e9 / n);
+
+    pagetable_free(tbl);
+    mm_vmem_destroy();
+    mm_mem_destroy();
+    remove(pagefile);
+    return 0;
+}
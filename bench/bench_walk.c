@@ -0,0 +1,91 @@
+/**
+ * @file bench_walk.c
+ * @brief Benchmark of page table walks and page table memory for each page table layout.
+ *
+ * For a 24-bit, a 32-bit and a 48-bit address space, maps one page per frame either densely from
+ * page 0 or scattered across the whole space, then times pte_val() lookups of the mapped pages in
+ * random order and reports pagetable_bytes().  A flat table of a 48-bit space would need 2^36
+ * entries, so it is skipped.  Build and run from the repository root with:
+ *
+ *     cc -O2 -I. -o bench_walk bench/bench_walk.c mmu.c mmu_frameheap.c \
+ *         mmu_image.c mmu_pagefile.c mmu_pagemap.c mmu_policy.c mmu_readahead.c mmu_tlb.c \
+ *         mmu_zcache.c
+ *     ./bench_walk [lookups]
+ *
+ * @author ckurdelak20@georgefox.edu
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "mmu.h"
+
+/**
+ * Returns the current monotonic time in seconds.
+ * @return the current time in seconds
+ */
+static double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * Returns the next number of a 64-bit xorshift generator.
+ * @param state the generator state, which must not be zero
+ * @return the next pseudo-random number
+ */
+static uint64_t next_rand(uint64_t* state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+int main(int argc, char* argv[]) {
+    long n = argc > 1 ? strtol(argv[1], NULL, 10) : 10000000;
+    unsigned widths[] = {24, 32, 48};
+    const char* layouts[] = {"flat", "radix", "hashed"};
+    size_t frames = 4096;
+    pagenum_t* mapped = malloc(frames * sizeof(pagenum_t));
+
+    printf("%-6s %-7s %-7s %12s %14s\n", "vbits", "layout", "pages", "ns/walk", "table bytes");
+    for (size_t w = 0; w < sizeof(widths) / sizeof(widths[0]); w++) {
+        if (!mm_geometry_init(widths[w], 12, frames)) {
+            fprintf(stderr, "unsupported geometry: %u-bit addresses\n", widths[w]);
+            exit(EXIT_FAILURE);
+        }
+        for (int sparse = 0; sparse <= 1; sparse++) {
+            // the same pages for every layout
+            uint64_t seed = 460;
+            for (size_t f = 0; f < frames; f++) {
+                mapped[f] = sparse ? next_rand(&seed) % PAGETABLE_SIZE : f;
+            }
+            for (int kind = PAGETABLE_FLAT; kind <= PAGETABLE_HASHED; kind++) {
+                pagetable_t* tbl = NULL;
+                if (kind != PAGETABLE_FLAT || PAGETABLE_SIZE <= PAGETABLE_FLAT_MAX) {
+                    tbl = pagetable_alloc_kind((pagetable_kind_t)kind);
+                }
+                if (tbl != NULL) {
+                    for (size_t f = 0; f < frames; f++) {
+                        set_pte(tbl, mapped[f], mk_pte(f));
+                    }
+                    unsigned long sum = 0;
+                    double start = now();
+                    for (long i = 0; i < n; i++) {
+                        sum += pte_val(tbl, mapped[next_rand(&seed) % frames]).framenum;
+                    }
+                    double elapsed = now() - start;
+                    printf("%-6u %-7s %-7s %12.2f %14zu\n", widths[w], layouts[kind],
+                           sparse ? "sparse" : "dense", elapsed * 1e9 / n, pagetable_bytes(tbl));
+                    pagetable_free(tbl);
+                    if (sum == 1) {
+                        printf("\n");
+                    }
+                }
+            }
+        }
+    }
+    free(mapped);
+    return 0;
+}
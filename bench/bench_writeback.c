@@ -0,0 +1,131 @@
+/**
+ * @file bench_writeback.c
+ * @brief Benchmark of writing dirty pages back ahead of their eviction.
+ *
+ * Each pass writes a few bytes into pages drawn from a working set of twice as many pages as
+ * there are frames, with one access in four a read, so that most faults evict a dirty page.  The
+ * pages stay resident for a while between writes, so a flusher has time to clean them.  Passes
+ * run with no flusher, with a flusher sweeping on each aging tick, and with a background flusher
+ * thread, and report the time per fault, the write-backs left on the fault path, the pages written
+ * back ahead of time and the total bytes written.  At the end every page is read back and checked.
+ * Build and run from the repository root with:
+ *
+ *     cc -O2 -pthread -I. -o bench_writeback bench/bench_writeback.c mmu.c mmu_frameheap.c \
+ *         mmu_image.c mmu_pagefile.c mmu_pagemap.c mmu_policy.c mmu_readahead.c mmu_tlb.c \
+ *         mmu_zcache.c
+ *     ./bench_writeback [accesses] [dirty pct] [age cutoff]
+ *
+ * @author ckurdelak20@georgefox.edu
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "mmu.h"
+
+#define FRAMES   256             /* page frames */
+#define WSET     (2 * FRAMES)    /* pages written */
+#define BURST    32              /* accesses in a row to the same small group of pages */
+#define TICK     8               /* accesses per aging tick */
+
+static char* pagefile = "bench_writeback.sys";
+
+/**
+ * Returns the current monotonic time in seconds.
+ * @return the current time in seconds
+ */
+static double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * Runs one pass over a fresh machine and prints its row.
+ * @param mode the name of the write-back mode
+ * @param n the number of accesses
+ */
+static void run(const char* mode, long n) {
+    pagefile_opts_t opts = {.mode = PAGEFILE_PIO};
+    mm_mem_init();
+    mm_vmem_init_opts(pagefile, &opts);
+    pagetable_t* tbl = pagetable_alloc();
+    // the last byte written to each page, to check against at the end
+    uint8_t* last = calloc(WSET, sizeof(uint8_t));
+
+    uint64_t seed = 460;
+    pagenum_t group = 0;
+    double start = now();
+    for (long i = 0; i < n; i++) {
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        // move to another group of pages every so often
+        if (i % BURST == 0) {
+            group = seed % (WSET / 4) * 4;
+        }
+        pagenum_t p = group + seed / WSET % 4;
+        if (seed % 4 == 0) {
+            uint8_t byte;
+            mmu_read_span(pagefile, tbl, mk_vaddr(p * PAGE_SIZE), &byte, 1);
+        }
+        else {
+            uint8_t byte = (uint8_t)(i | 1);
+            mmu_write_span(pagefile, tbl, mk_vaddr(p * PAGE_SIZE), &byte, 1);
+            last[p] = byte;
+        }
+        if (i % TICK == 0) {
+            pagetable_age(tbl, true);
+        }
+    }
+    double elapsed = now() - start;
+    mmu_stats_t stats;
+    mm_stats(&stats);
+
+    // every page must read back as last written, whichever way it reached the page file
+    mm_page_evict_all(pagefile, tbl);
+    unsigned long bad = 0;
+    for (pagenum_t p = 0; p < WSET; p++) {
+        uint8_t byte;
+        mmu_read_span(pagefile, tbl, mk_vaddr(p * PAGE_SIZE), &byte, 1);
+        bad += byte != last[p];
+    }
+    printf("%-7s %10.0f %8lu %11lu %9lu %12lu %6lu\n", mode,
+           stats.faults > 0 ? elapsed * 1e9 / stats.faults : 0.0, stats.faults, stats.writebacks,
+           stats.flushes, stats.bytes_written, bad);
+
+    free(last);
+    mm_page_evict_all(pagefile, tbl);
+    pagetable_free(tbl);
+    mm_vmem_destroy();
+    mm_mem_destroy();
+    mm_stats_reset();
+}
+
+int main(int argc, char* argv[]) {
+    long n = argc > 1 ? strtol(argv[1], NULL, 10) : 400000;
+    writeback_opts_t wb = {
+        .background_ratio = argc > 2 ? strtoul(argv[2], NULL, 10) : 10,
+        .ratio = 0,
+        .age_cutoff = argc > 3 ? strtoul(argv[3], NULL, 10) : 0
+    };
+    if (!mm_geometry_init(24, 12, FRAMES) || !mm_writeback_init(&wb)) {
+        fprintf(stderr, "usage: %s [accesses] [dirty pct] [age cutoff]\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    printf("%-7s %10s %8s %11s %9s %12s %6s\n", "mode", "ns/fault", "faults", "writebacks",
+           "flushes", "bytes_written", "bad");
+    mm_writeback_init(NULL);
+    run("off", n);
+    mm_writeback_init(&wb);
+    run("sync", n);
+    // threads cannot be turned off again, so the background pass comes last
+    mm_threads_init();
+    wb.async = true;
+    mm_writeback_init(&wb);
+    run("async", n);
+    remove(pagefile);
+    return 0;
+}
@@ -0,0 +1,126 @@
+/**
+ * @file bench_zcache.c
+ * @brief Benchmark of a compressed page cache in front of the page file.
+ *
+ * Each pass writes and reads pages drawn from a working set four times the size of memory.  Most
+ * of each page stays zero: a write sets one 64-bit word of the page to a value of its own, and
+ * one page in eight is filled with a repeated byte instead.  Passes run without a cache and with
+ * caches of 1/16, 1/4 and 1 times the size of memory, and report the time per fault, the faults
+ * served from the cache, the bytes read from and written to the page file, the pages the cache
+ * spilled and the compression ratio it reached.  At the end every byte of every page is read back
+ * and checked.  Build and run from the repository root with:
+ *
+ *     cc -O2 -pthread -I. -o bench_zcache bench/bench_zcache.c mmu.c mmu_frameheap.c \
+ *         mmu_image.c mmu_pagefile.c mmu_pagemap.c mmu_policy.c mmu_readahead.c mmu_tlb.c \
+ *         mmu_zcache.c
+ *     ./bench_zcache [accesses]
+ *
+ * @author ckurdelak20@georgefox.edu
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "mmu.h"
+
+#define FRAMES   256             /* page frames */
+#define WSET     (4 * FRAMES)    /* pages touched */
+#define WORDS    64              /* words of a page that may be set */
+
+static char* pagefile = "bench_zcache.sys";
+
+/**
+ * Returns the current monotonic time in seconds.
+ * @return the current time in seconds
+ */
+static double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * Runs one pass over a fresh machine and prints its row.
+ * @param budget the budget of the cache in bytes, or 0 for none
+ * @param n the number of accesses
+ */
+static void run(size_t budget, long n) {
+    pagefile_opts_t opts = {.mode = PAGEFILE_PIO};
+    mm_zcache_init(budget);
+    mm_mem_init();
+    mm_vmem_init_opts(pagefile, &opts);
+    pagetable_t* tbl = pagetable_alloc();
+    // the expected bytes of every page
+    uint8_t* model = calloc(WSET, PAGE_SIZE);
+    uint8_t* page = malloc(PAGE_SIZE);
+
+    uint64_t seed = 460;
+    double start = now();
+    for (long i = 0; i < n; i++) {
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        pagenum_t p = seed % WSET;
+        uint8_t* expected = model + p * PAGE_SIZE;
+        if (seed / WSET % 2 == 0) {
+            mmu_read_span(pagefile, tbl, mk_vaddr(p * PAGE_SIZE), page, 1);
+        }
+        else if (p % 8 == 0) {
+            memset(expected, (int)(seed >> 32) | 1, PAGE_SIZE);
+            mmu_write_span(pagefile, tbl, mk_vaddr(p * PAGE_SIZE), expected, PAGE_SIZE);
+        }
+        else {
+            uint64_t word = seed | 1;
+            size_t offset = seed / WSET / 2 % WORDS * PAGE_SIZE / WORDS;
+            memcpy(expected + offset, &word, sizeof(word));
+            mmu_write_span(pagefile, tbl, mk_vaddr(p * PAGE_SIZE + offset), (uint8_t*)&word,
+                           sizeof(word));
+        }
+        if (i % 16 == 0) {
+            pagetable_age(tbl, true);
+        }
+    }
+    double elapsed = now() - start;
+    mmu_stats_t stats;
+    mm_stats(&stats);
+
+    // every page must read back as last written, from whichever tier holds it
+    mm_page_evict_all(pagefile, tbl);
+    unsigned long bad = 0;
+    for (pagenum_t p = 0; p < WSET; p++) {
+        mmu_read_span(pagefile, tbl, mk_vaddr(p * PAGE_SIZE), page, PAGE_SIZE);
+        bad += memcmp(page, model + p * PAGE_SIZE, PAGE_SIZE) != 0;
+    }
+    printf("%8zu %10.0f %8lu %9lu %12lu %13lu %8lu %7.2f %6lu\n", budget / 1024,
+           stats.faults > 0 ? elapsed * 1e9 / stats.faults : 0.0, stats.faults,
+           stats.zcache_hits, stats.bytes_read, stats.bytes_written, stats.zcache_spills,
+           stats.zcache_bytes > 0 ? (double)stats.zcache_pages * PAGE_SIZE / stats.zcache_bytes
+                                  : 0.0, bad);
+
+    free(model);
+    free(page);
+    mm_page_evict_all(pagefile, tbl);
+    pagetable_free(tbl);
+    mm_vmem_destroy();
+    mm_mem_destroy();
+    mm_stats_reset();
+}
+
+int main(int argc, char* argv[]) {
+    long n = argc > 1 ? strtol(argv[1], NULL, 10) : 200000;
+    if (n <= 0 || !mm_geometry_init(24, 12, FRAMES)) {
+        fprintf(stderr, "usage: %s [accesses]\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    printf("%8s %10s %8s %9s %12s %13s %8s %7s %6s\n", "cache_kb", "ns/fault", "faults",
+           "hits", "bytes_read", "bytes_written", "spills", "ratio", "bad");
+    size_t memory = (size_t)FRAMES * PAGE_SIZE;
+    run(0, n);
+    run(memory / 16, n);
+    run(memory / 4, n);
+    run(memory, n);
+    remove(pagefile);
+    return 0;
+}
@@ -0,0 +1,115 @@
+/**
+ * @file bench_zeropage.c
+ * @brief Benchmark of loading never-written pages by zeroing their frames instead of reading.
+ *
+ * Each pass touches pages spread sparsely over a region sixteen times the size of memory, as a
+ * program with a large, mostly empty heap would: only one page in sixteen is ever written, half
+ * of the accesses to it write a byte, and one write in four puts zero back over the page's only
+ * nonzero byte.  Every other access only reads.  It reports the time per fault, the loads that
+ * zeroed the frame and the ones that read the page file, the dirty pages not written back because
+ * they were all zeros, and the bytes read and written.  At the end every page touched is read back
+ * and checked.  Build and run from the repository root with:
+ *
+ *     cc -O2 -pthread -I. -o bench_zeropage bench/bench_zeropage.c mmu.c mmu_frameheap.c \
+ *         mmu_image.c mmu_pagefile.c mmu_pagemap.c mmu_policy.c mmu_readahead.c mmu_tlb.c \
+ *         mmu_zcache.c
+ *     ./bench_zeropage [accesses]
+ *
+ * @author ckurdelak20@georgefox.edu
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "mmu.h"
+
+#define FRAMES   256              /* page frames */
+#define REGION   (16 * FRAMES)    /* pages touched */
+
+static char* pagefile = "bench_zeropage.sys";
+
+/**
+ * Returns the current monotonic time in seconds.
+ * @return the current time in seconds
+ */
+static double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * Runs one pass over a fresh machine and prints its row.
+ * @param mode the name of the page file mode
+ * @param opts the page file options
+ * @param n the number of accesses
+ */
+static void run(const char* mode, const pagefile_opts_t* opts, long n) {
+    mm_mem_init();
+    mm_vmem_init_opts(pagefile, opts);
+    pagetable_t* tbl = pagetable_alloc();
+    // the byte last written to the start of each page, to check against at the end
+    uint8_t* last = calloc(REGION, sizeof(uint8_t));
+
+    uint64_t seed = 460;
+    double start = now();
+    for (long i = 0; i < n; i++) {
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        pagenum_t p = seed % REGION;
+        uint8_t byte;
+        if (p % 16 == 0 && seed / REGION % 2 == 0) {
+            byte = seed / REGION / 8 % 4 == 0 ? 0 : (uint8_t)(i | 1);
+            mmu_write_span(pagefile, tbl, mk_vaddr(p * PAGE_SIZE), &byte, 1);
+            last[p] = byte;
+        }
+        else {
+            mmu_read_span(pagefile, tbl, mk_vaddr(p * PAGE_SIZE), &byte, 1);
+        }
+        if (i % 16 == 0) {
+            pagetable_age(tbl, true);
+        }
+    }
+    double elapsed = now() - start;
+    mmu_stats_t stats;
+    mm_stats(&stats);
+
+    mm_page_evict_all(pagefile, tbl);
+    unsigned long bad = 0;
+    for (pagenum_t p = 0; p < REGION; p++) {
+        uint8_t byte;
+        mmu_read_span(pagefile, tbl, mk_vaddr(p * PAGE_SIZE), &byte, 1);
+        bad += byte != last[p];
+    }
+    printf("%-6s %10.0f %8lu %10lu %10lu %9lu %12lu %13lu %6lu\n", mode,
+           stats.faults > 0 ? elapsed * 1e9 / stats.faults : 0.0, stats.faults, stats.zero_fills,
+           stats.faults - stats.zero_fills, stats.zero_discards, stats.bytes_read,
+           stats.bytes_written, bad);
+
+    free(last);
+    mm_page_evict_all(pagefile, tbl);
+    pagetable_free(tbl);
+    mm_vmem_destroy();
+    mm_mem_destroy();
+    mm_stats_reset();
+}
+
+int main(int argc, char* argv[]) {
+    long n = argc > 1 ? strtol(argv[1], NULL, 10) : 200000;
+    if (n <= 0 || !mm_geometry_init(24, 12, FRAMES)) {
+        fprintf(stderr, "usage: %s [accesses]\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    printf("%-6s %10s %8s %10s %10s %9s %12s %13s %6s\n", "mode", "ns/fault", "faults",
+           "zero_fills", "reads", "discards", "bytes_read", "bytes_written", "bad");
+    const char* modes[] = {"stdio", "pio", "mmap"};
+    for (int mode = PAGEFILE_STDIO; mode <= PAGEFILE_MMAP; mode++) {
+        pagefile_opts_t opts = {.mode = mode};
+        run(modes[mode], &opts, n);
+    }
+    remove(pagefile);
+    return 0;
+}
@@ -0,0 +1,366 @@
+/**
+ * @file mmu_bench.c
+ * @brief Workload benchmark suite for the MMU, driven by synthetic access generators.
+ *
+ * Each workload issues accesses through pte_page() and pagetable_translate(), with one aging tick
+ * every few accesses as the REPL does per command, and reports ns/access, faults/sec, dirty
+ * write-backs and peak RSS as CSV (default) or JSON lines, one row per workload, for regression
+ * tracking.  Each workload runs in a child process of its own, so that its peak RSS is its own
+ * rather than the high-water mark of every workload before it.  Build and run from the repository
+ * root with:
+ *
+ *     cc -O2 -I. -o mmu_bench bench/mmu_bench.c mmu.c mmu_frameheap.c mmu_image.c \
+ *         mmu_pagefile.c mmu_pagemap.c mmu_policy.c mmu_readahead.c mmu_tlb.c mmu_zcache.c -lm
+ *     ./mmu_bench [-n accesses] [-w working set pages] [-s stride bytes] [-z zipf theta]
+ *                 [-r write ratio] [-k accesses per tick] [-m stdio|pio|mmap]
+ *                 [-e aging|clock|lru|wsclock|arc|2q] [-v vaddr bits] [-K page KB]
+ *                 [-f frames] [-j] [workload ...]
+ *
+ * Workloads are seq, stride, uniform, zipf, loop and mixed; all of them run by default.  Run once
+ * per -e policy to compare the replacement policies on the same accesses.
+ *
+ * @author ckurdelak20@georgefox.edu
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include "mmu.h"
+
+/**
+ * @struct bench_opts_t
+ * @brief Benchmark parameters.
+ */
+typedef struct {
+    long accesses;          /**< accesses per workload */
+    size_t wset;            /**< working set size in pages (loop) */
+    size_t stride;          /**< stride in bytes (stride) */
+    double theta;           /**< Zipf skew (zipf) */
+    double write_ratio;     /**< fraction of accesses that are writes */
+    long tick_every;        /**< accesses per aging tick */
+    pagefile_mode_t mode;   /**< page file access mode */
+    policy_kind_t policy;   /**< page replacement policy */
+    bool json;              /**< true for JSON lines, false for CSV */
+} bench_opts_t;
+
+/**
+ * @struct gen_t
+ * @brief State shared by the access generators.
+ */
+typedef struct {
+    uint64_t rng;           /**< xorshift64 state */
+    uint64_t next;          /**< next sequential or strided address */
+    double* zipf_cdf;       /**< cumulative Zipf probability of each page */
+    const bench_opts_t* opts;
+} gen_t;
+
+/**
+ * @struct result_t
+ * @brief The measurements of one workload, handed back by the process that ran it.
+ */
+typedef struct {
+    double ns;                  /**< nanoseconds per access */
+    double fps;                 /**< faults per second */
+    unsigned long faults;       /**< page faults */
+    unsigned long writebacks;   /**< dirty pages written back */
+    bool done;                  /**< true once the workload has run to the end */
+} result_t;
+
+/** An access generator, returning the next virtual address. */
+typedef uint64_t (*gen_fn_t)(gen_t* gen, long i);
+
+/**
+ * Returns the current monotonic time in seconds.
+ * @return the current time in seconds
+ */
+static double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * Returns the next pseudo-random number.
+ * @param gen the generator state
+ * @return a pseudo-random 64-bit number
+ */
+static uint64_t next_rand(gen_t* gen) {
+    gen->rng ^= gen->rng << 13;
+    gen->rng ^= gen->rng >> 7;
+    gen->rng ^= gen->rng << 17;
+    return gen->rng;
+}
+
+/**
+ * Returns a uniformly random offset within a page.
+ * @param gen the generator state
+ * @return a page offset
+ */
+static uint32_t rand_offset(gen_t* gen) {
+    return next_rand(gen) % PAGE_SIZE;
+}
+
+static uint64_t gen_seq(gen_t* gen, long i) {
+    // one cache line at a time through the whole address space
+    (void)i;
+    uint64_t vaddr = gen->next;
+    gen->next = (gen->next + 64) % (PAGETABLE_SIZE * PAGE_SIZE);
+    return vaddr;
+}
+
+static uint64_t gen_stride(gen_t* gen, long i) {
+    (void)i;
+    uint64_t vaddr = gen->next;
+    gen->next = (gen->next + gen->opts->stride) % (PAGETABLE_SIZE * PAGE_SIZE);
+    return vaddr;
+}
+
+static uint64_t gen_uniform(gen_t* gen, long i) {
+    (void)i;
+    return next_rand(gen) % (PAGETABLE_SIZE * PAGE_SIZE);
+}
+
+static uint64_t gen_zipf(gen_t* gen, long i) {
+    (void)i;
+    // binary search the cumulative distribution for a uniform draw
+    double u = (next_rand(gen) >> 11) * (1.0 / 9007199254740992.0);
+    size_t lo = 0;
+    size_t hi = PAGETABLE_SIZE - 1;
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (gen->zipf_cdf[mid] < u) {
+            lo = mid + 1;
+        }
+        else {
+            hi = mid;
+        }
+    }
+    return lo * PAGE_SIZE + rand_offset(gen);
+}
+
+static uint64_t gen_loop(gen_t* gen, long i) {
+    return (i % gen->opts->wset) * PAGE_SIZE + rand_offset(gen);
+}
+
+static uint64_t gen_mixed(gen_t* gen, long i) {
+    // half skewed, a quarter streaming, a quarter scattered
+    uint64_t pick = next_rand(gen) % 4;
+    return pick < 2 ? gen_zipf(gen, i) : pick == 2 ? gen_seq(gen, i) : gen_uniform(gen, i);
+}
+
+/* the workloads, by name */
+static const struct {
+    const char* name;
+    gen_fn_t fn;
+} workloads[] = {
+    {"seq", gen_seq},
+    {"stride", gen_stride},
+    {"uniform", gen_uniform},
+    {"zipf", gen_zipf},
+    {"loop", gen_loop},
+    {"mixed", gen_mixed},
+};
+
+/**
+ * Runs one workload against a fresh page file and page table.
+ * @param fn the access generator
+ * @param opts the benchmark parameters
+ * @param zipf_cdf the cumulative Zipf distribution
+ * @param result where to store the measurements
+ */
+static void measure(gen_fn_t fn, const bench_opts_t* opts, double* zipf_cdf, result_t* result) {
+    char* pagefile = "mmu_bench.sys";
+    pagefile_opts_t pf_opts = {.mode = opts->mode};
+    gen_t gen = {.rng = 0x9e3779b97f4a7c15ULL, .next = 0, .zipf_cdf = zipf_cdf, .opts = opts};
+    uint64_t write_cut = (uint64_t)(opts->write_ratio * 1e6);
+
+    mm_mem_init();
+    mm_policy_init(opts->policy);
+    mm_vmem_init_opts(pagefile, &pf_opts);
+    pagetable_t* tbl = pagetable_alloc();
+
+    unsigned long sum = 0;
+    mm_stats_reset();
+
+    double start = now();
+    for (long i = 0; i < opts->accesses; i++) {
+        if (i % opts->tick_every == 0) {
+            pagetable_age(tbl, false);
+        }
+        vaddr_t vaddr = mk_vaddr(fn(&gen, i));
+        frame_t* frame = pte_page(pagefile, tbl, vaddr.pagenum);
+        addr_t paddr = pagetable_translate(tbl, vaddr);
+        if (next_rand(&gen) % 1000000 < write_cut) {
+            frame->bytes[paddr.offset] = (uint8_t)i;
+            pte_mkdirty(tbl, vaddr.pagenum);
+        }
+        else {
+            sum += frame->bytes[paddr.offset];
+        }
+    }
+    double elapsed = now() - start;
+
+    mmu_stats_t stats;
+    mm_stats(&stats);
+    result->faults = stats.faults;
+    result->writebacks = stats.writebacks;
+    result->ns = elapsed * 1e9 / opts->accesses;
+    result->fps = elapsed > 0 ? stats.faults / elapsed : 0;
+
+    pagetable_free(tbl);
+    mm_vmem_destroy();
+    mm_mem_destroy();
+    remove(pagefile);
+    if (sum == 1) {
+        fprintf(stderr, "\n");
+    }
+    result->done = true;
+}
+
+/**
+ * Runs one workload in a child process and prints its row, with the peak RSS of that process.
+ * @param name the workload name
+ * @param fn the access generator
+ * @param opts the benchmark parameters
+ * @param zipf_cdf the cumulative Zipf distribution
+ * @return true if the workload ran to the end, else returns false
+ */
+static bool run(const char* name, gen_fn_t fn, const bench_opts_t* opts, double* zipf_cdf) {
+    result_t* result = mmap(NULL, sizeof(result_t), PROT_READ | PROT_WRITE,
+                            MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    bool success = result != MAP_FAILED;
+    // the child must not print what the parent has buffered
+    fflush(stdout);
+    pid_t pid = success ? fork() : -1;
+    if (pid == 0) {
+        measure(fn, opts, zipf_cdf, result);
+        _exit(EXIT_SUCCESS);
+    }
+    int status;
+    struct rusage usage;
+    success = pid > 0 && wait4(pid, &status, 0, &usage) == pid && result->done;
+    if (success && opts->json) {
+        printf("{\"workload\":\"%s\",\"policy\":\"%s\",\"accesses\":%ld,\"ns_per_access\":%.2f,"
+               "\"faults\":%lu,\"faults_per_sec\":%.0f,\"writebacks\":%lu,\"peak_rss_kb\":%ld}\n",
+               name, mm_policy_name(opts->policy), opts->accesses, result->ns, result->faults,
+               result->fps, result->writebacks, usage.ru_maxrss);
+    }
+    else if (success) {
+        printf("%s,%s,%ld,%.2f,%lu,%.0f,%lu,%ld\n", name, mm_policy_name(opts->policy),
+               opts->accesses, result->ns, result->faults, result->fps, result->writebacks,
+               usage.ru_maxrss);
+    }
+    else {
+        fprintf(stderr, "%s: workload did not complete\n", name);
+    }
+    if (result != MAP_FAILED) {
+        munmap(result, sizeof(result_t));
+    }
+    return success;
+}
+
+int main(int argc, char* argv[]) {
+    bench_opts_t opts = {
+        .accesses = 1000000,
+        .wset = 0,
+        .stride = 3 * PAGE_SIZE + 256,
+        .theta = 0.99,
+        .write_ratio = 0.3,
+        .tick_every = 1,
+        .mode = PAGEFILE_PIO,
+        .policy = POLICY_AGING,
+        .json = false
+    };
+    unsigned vaddr_bits = mmu_geom.vaddr_bits;
+    unsigned page_shift = mmu_geom.page_shift;
+    size_t frames = mmu_geom.frames;
+    unsigned long page_kb;
+    char* end;
+    int opt;
+    bool valid = true;
+    while (valid && (opt = getopt(argc, argv, "n:w:s:z:r:k:m:e:v:K:f:j")) != -1) {
+        switch (opt) {
+            case 'n': opts.accesses = strtol(optarg, NULL, 10); break;
+            case 'w': opts.wset = strtoul(optarg, NULL, 10); break;
+            case 's': opts.stride = strtoul(optarg, NULL, 10); break;
+            case 'z': opts.theta = strtod(optarg, NULL); break;
+            case 'r': opts.write_ratio = strtod(optarg, NULL); break;
+            case 'k': opts.tick_every = strtol(optarg, NULL, 10); break;
+            case 'm':
+                opts.mode = strcmp(optarg, "stdio") == 0 ? PAGEFILE_STDIO
+                          : strcmp(optarg, "mmap") == 0 ? PAGEFILE_MMAP : PAGEFILE_PIO;
+                // a mistyped mode would be measured as PIO
+                valid = opts.mode != PAGEFILE_PIO || strcmp(optarg, "pio") == 0;
+                break;
+            case 'e':
+                opts.policy = POLICY_AGING;
+                while (opts.policy < POLICY_COUNT
+                       && strcmp(optarg, mm_policy_name(opts.policy)) != 0) {
+                    opts.policy++;
+                }
+                valid = opts.policy < POLICY_COUNT;
+                break;
+            case 'v':
+                vaddr_bits = strtoul(optarg, &end, 10);
+                valid = *end == '\0';
+                break;
+            case 'K':
+                // a power of two number of kilobytes
+                page_kb = strtoul(optarg, &end, 10);
+                valid = *end == '\0' && page_kb > 0 && (page_kb & (page_kb - 1)) == 0;
+                page_shift = valid ? 10 + __builtin_ctzl(page_kb) : 0;
+                break;
+            case 'f':
+                frames = strtoul(optarg, &end, 10);
+                valid = *end == '\0';
+                break;
+            case 'j': opts.json = true; break;
+            default: valid = false;
+        }
+    }
+    valid = valid && mm_geometry_init(vaddr_bits, page_shift, frames);
+    if (opts.wset == 0) {
+        // half again as many pages as fit in memory
+        opts.wset = PAGE_FRAMES + PAGE_FRAMES / 2;
+    }
+    if (!valid || opts.accesses <= 0 || opts.tick_every <= 0) {
+        fprintf(stderr, "usage: %s [-n accesses] [-w pages] [-s stride] [-z theta] [-r ratio] "
+                "[-k accesses per tick] [-m stdio|pio|mmap] [-e policy] [-v vaddr bits] "
+                "[-K page KB] [-f frames] [-j] [workload ...]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    // cumulative Zipf distribution over pages, hottest page first
+    double* zipf_cdf = malloc(PAGETABLE_SIZE * sizeof(double));
+    double total = 0;
+    for (size_t p = 0; p < PAGETABLE_SIZE; p++) {
+        total += 1.0 / pow(p + 1, opts.theta);
+        zipf_cdf[p] = total;
+    }
+    for (size_t p = 0; p < PAGETABLE_SIZE; p++) {
+        zipf_cdf[p] /= total;
+    }
+
+    if (!opts.json) {
+        printf("workload,policy,accesses,ns_per_access,faults,faults_per_sec,writebacks,peak_rss_kb\n");
+    }
+    size_t nworkloads = sizeof(workloads) / sizeof(workloads[0]);
+    bool success = true;
+    for (size_t w = 0; w < nworkloads; w++) {
+        bool selected = optind == argc;
+        for (int a = optind; a < argc; a++) {
+            selected = selected || strcmp(argv[a], workloads[w].name) == 0;
+        }
+        if (selected) {
+            success = run(workloads[w].name, workloads[w].fn, &opts, zipf_cdf) && success;
+        }
+    }
+    free(zipf_cdf);
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -5,36 +5,197 @@
  * @author ckurdelak20@georgefox.edu
  */
 
+#include <pthread.h>
+#include <sched.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 #include "mmu.h"
+#include "mmu_frameheap.h"
+#include "mmu_image.h"
+#include "mmu_pagefile.h"
+#include "mmu_policy.h"
+#include "mmu_readahead.h"
+#include "mmu_tlb.h"
+#include "mmu_zcache.h"
+
+#define PREFETCH_AGE     0x40    /* aging counter of a page read ahead, as if used a tick ago */
+#define WRITEBACK_BATCH  64      /* frames swept per aging tick without a background flusher */
+#define HINT_SLOTS       256     /* frames each thread remembers pages in, to skip the MMU lock */
+#define HIT_ROWS         64      /* rows of counters of accesses made without the MMU lock */
 
 /**
  * @struct fte_t
- * @brief A 16-bit frame table entry type.
+ * @brief A frame table entry type, mapping a frame back to the page it holds.
  */
 typedef struct {
-    uint16_t occupied    : 1;  /**< occupied/unoccupied bit (1 if frame is occupied) */
-    uint16_t pagenum     : 4;  /**< virtual page number */
+    pagetable_t* owner;    /**< page table of the page in the frame */
+    pagenum_t pagenum;     /**< virtual page number of the page in the frame */
+    uint32_t refs;         /**< page table entries mapping the frame; over 1 if it is shared */
+    bool occupied;         /**< true if the frame is occupied */
+    bool prefetched;       /**< true if the page was read ahead and has not been used yet */
+    bool prefetching;      /**< true while the I/O thread reads the page ahead */
 } fte_t;
 
 /**
  * @struct frametable_t
  * @brief A frame table type, consisting of many frame table entries.
+ *
+ * Free frames are tracked in a two-level bitmap: bit i of free_map is set if frame i is free, and
+ * bit i of free_summary is set if word i of free_map has any free frame.  Finding the lowest free
+ * frame is then two count-trailing-zeros operations for up to 4096 frames.
  * @see frametable_alloc(), frametable_free().
  */
 typedef struct {
-    fte_t* entries;    /**< frame table entries */
-    size_t size;       /**< number of frame table entries */
+    fte_t* entries;            /**< frame table entries, indexed by frame number */
+    size_t size;               /**< number of frame table entries */
+    uint64_t* free_map;        /**< one bit per frame, set if the frame is free */
+    uint64_t* free_summary;    /**< one bit per free_map word, set if it has a free frame */
+    size_t summary_words;      /**< number of words in free_summary */
+    size_t free;               /**< number of free frames */
+    frameheap_t* resident;     /**< occupied frames, oldest page first */
+    pthread_rwlock_t* locks;   /**< lock of each frame, held while its bytes move (threaded) */
+    uint64_t* tags;            /**< the page each frame may be used for without the MMU lock, by
+                                    frame_tag(), or 0 (threaded) */
+    uint8_t* young;            /**< set by each use of a frame without the MMU lock (threaded) */
 } frametable_t;
 
-/* the pseudo-physical memory frames; globally accessible to the MMU */
-frame_t* mem_frames;
+/**
+ * @enum pin_t
+ * @brief How a frame is held while its bytes are copied, when threaded.
+ */
+typedef enum {
+    PIN_NONE,     /**< not held; another fault may reuse the frame */
+    PIN_READ,     /**< held shared, for reading */
+    PIN_WRITE     /**< held exclusively, for writing */
+} pin_t;
+
+/* the geometry of the simulated machine */
+#ifdef MMU_FIXED_GEOMETRY
+mmu_geometry_t mmu_geom = {MMU_VADDR_BITS, MMU_PAGE_SHIFT, MMU_FRAMES,
+                           1UL << (MMU_VADDR_BITS - MMU_PAGE_SHIFT)};
+#else
+mmu_geometry_t mmu_geom = {20, 12, 16, 1UL << 8};
+#endif
+
+/**
+ * @enum tier_t
+ * @brief Where a page's bytes came from when it was loaded, or went when it was written back.
+ */
+typedef enum {
+    TIER_ZERO,        /**< nowhere; the page is all zeros */
+    TIER_ZCACHE,      /**< the compressed page cache */
+    TIER_PAGEFILE     /**< the page file */
+} tier_t;
+
+/* the pseudo-physical memory frames, PAGE_SIZE bytes apart; globally accessible to the MMU */
+uint8_t* mem_frames;
 
 /* the frame table */
 frametable_t* frametable;
 
+/* the backing page file; opened by mm_vmem_init() and held for the whole run */
+pagefile_t* vmem;
+
+/* the compressed page cache in front of the page file, or NULL; sized by mm_zcache_init() */
+zcache_t* zcache;
+size_t zcache_budget = 0;
+
+/* the MMU activity counters; hits are derived when read */
+mmu_stats_t vmstats;
+
+/* the number of faults on each virtual page that has faulted */
+pagemap_t* fault_counts;
+
+/* true once mm_threads_init() has made memory safe for several threads */
+bool threaded = false;
+
+/* held while the MMU's state is read or changed, when threaded */
+pthread_mutex_t mmu_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* the frame of each page being loaded or written back outside mmu_mutex, when threaded */
+pagemap_t* in_transit;
+
+/* the frame this thread last pinned each page in, by page key; checked against its tag */
+__thread framenum_t frame_hints[HINT_SLOTS];
+
+/* accesses made without the MMU lock, by row and ASID, until folded into the counters; each
+ * thread adds to its own row, handed out in turn */
+uint64_t fast_accesses[HIT_ROWS][ASID_MAX];
+size_t fast_rows = 0;
+__thread size_t fast_row = HIT_ROWS;
+
+/* the most pages read ahead of a stream, or 0 for no readahead; set by mm_readahead_init() */
+size_t readahead_window = 0;
+bool readahead_async = false;
+
+/**
+ * @struct prefetch_t
+ * @brief A page waiting to be read ahead by the I/O thread into the frame reserved for it.
+ */
+typedef struct {
+    pagetable_t* tbl;       /**< page table of the page */
+    pagenum_t pagenum;      /**< virtual page number */
+    framenum_t framenum;    /**< frame reserved for the page */
+} prefetch_t;
+
+/* the pages waiting for the I/O thread, a ring of PAGE_FRAMES since each holds its own frame */
+prefetch_t* prefetch_queue;
+size_t prefetch_head;
+size_t prefetch_count;
+/* pages queued or being read; guarded, like the queue, by mmu_mutex */
+size_t prefetch_pending;
+pthread_t prefetch_thread;
+bool prefetch_running = false;
+bool prefetch_stop = false;
+/* signalled when a page is queued, and when one has been read */
+pthread_cond_t prefetch_ready = PTHREAD_COND_INITIALIZER;
+pthread_cond_t prefetch_done = PTHREAD_COND_INITIALIZER;
+
+/* log2 of the pages in a superpage, or 0 for no superpages; set by mm_superpages_init() */
+unsigned superpage_order = 0;
+
+/* write-back ahead of eviction; set by mm_writeback_init() */
+bool writeback_on = false;
+writeback_opts_t writeback_opts;
+/* the number of present pages with their M bit set */
+size_t dirty_frames;
+/* the next frame the flusher looks at */
+size_t writeback_hand;
+pthread_t writeback_thread;
+bool writeback_running = false;
+bool writeback_stop = false;
+/* true once the flusher has been asked for a sweep, and while it sweeps */
+bool writeback_wanted = false;
+bool writeback_active = false;
+/* signalled to ask for a sweep, and when one is over */
+pthread_cond_t writeback_wake = PTHREAD_COND_INITIALIZER;
+pthread_cond_t writeback_idle = PTHREAD_COND_INITIALIZER;
+
+/* the page replacement policy and its state; NULL hooks are skipped */
+const policy_ops_t* policy;
+void* policy_state;
+
+/**
+ * @struct space_t
+ * @brief An address space sharing the frames.
+ */
+typedef struct {
+    pagetable_t* tbl;         /**< page table of the address space, or NULL if the ASID is free */
+    frameheap_t* resident;    /**< its occupied frames, oldest page first (SCOPE_LOCAL only) */
+    void* policy_state;       /**< its instance of the policy (SCOPE_LOCAL only) */
+    mmu_stats_t stats;        /**< its activity counters */
+    readahead_t ra;           /**< its readahead detector */
+} space_t;
+
+/* the address spaces, indexed by ASID; set by mm_spaces_init() */
+space_t spaces[ASID_MAX];
+size_t nspaces = 1;
+replace_scope_t replace_scope = SCOPE_GLOBAL;
+
 /**
  * @brief Dynamically allocates a new frame table.
  * @return a pointer to the new frame table
@@ -42,11 +203,37 @@ frametable_t* frametable;
 frametable_t* frametable_alloc(){
     frametable_t* tbl = malloc(sizeof(frametable_t));
     if (tbl != NULL) {
+        size_t map_words = (PAGE_FRAMES + 63) / 64;
+        tbl->summary_words = (map_words + 63) / 64;
         tbl->entries = calloc(PAGE_FRAMES, sizeof(fte_t));
-        if (tbl->entries != NULL) {
+        tbl->free_map = calloc(map_words, sizeof(uint64_t));
+        tbl->free_summary = calloc(tbl->summary_words, sizeof(uint64_t));
+        tbl->resident = frameheap_alloc(PAGE_FRAMES);
+        tbl->locks = threaded ? malloc(PAGE_FRAMES * sizeof(pthread_rwlock_t)) : NULL;
+        tbl->tags = threaded ? calloc(PAGE_FRAMES, sizeof(uint64_t)) : NULL;
+        tbl->young = threaded ? calloc(PAGE_FRAMES, sizeof(uint8_t)) : NULL;
+        if (tbl->entries != NULL && tbl->free_map != NULL && tbl->free_summary != NULL
+            && tbl->resident != NULL
+            && (!threaded || (tbl->locks != NULL && tbl->tags != NULL && tbl->young != NULL))) {
             tbl->size = PAGE_FRAMES;
+            for (size_t i = 0; threaded && i < PAGE_FRAMES; i++) {
+                pthread_rwlock_init(&tbl->locks[i], NULL);
+            }
+            // every frame starts out free
+            for (size_t i = 0; i < PAGE_FRAMES; i++) {
+                tbl->free_map[i / 64] |= 1ULL << (i % 64);
+                tbl->free_summary[i / 4096] |= 1ULL << (i / 64 % 64);
+            }
+            tbl->free = PAGE_FRAMES;
         }
         else {
+            free(tbl->entries);
+            free(tbl->free_map);
+            free(tbl->free_summary);
+            frameheap_free(tbl->resident);
+            free(tbl->locks);
+            free(tbl->tags);
+            free(tbl->young);
             free(tbl);
             tbl = NULL;
         }
@@ -54,320 +241,2794 @@ frametable_t* frametable_alloc(){
     return tbl;
 }
 
-
-frame_t* mm_mem_init() {
-    if (mem_frames != NULL) {
-        fprintf(stderr, "simulation aborted\n");
-        abort();
+/**
+ * Finds the lowest-numbered free frame, without taking it.
+ * @param framenum where to store the frame number
+ * @return true if a frame is free, else returns false
+ */
+bool frame_find_free(framenum_t* framenum) {
+    bool found = false;
+    for (size_t i = 0; !found && i < frametable->summary_words; i++) {
+        if (frametable->free_summary[i] != 0) {
+            size_t word = i * 64 + __builtin_ctzll(frametable->free_summary[i]);
+            *framenum = word * 64 + __builtin_ctzll(frametable->free_map[word]);
+            found = true;
+        }
     }
-    mem_frames = calloc(PAGE_FRAMES, PAGE_SIZE);
-
-    // initialize frame table
-    frametable = frametable_alloc();
-
-    return mem_frames;
+    return found;
 }
 
-
 /**
- * @brief Frees the specified frame table from memory.
- * @param tbl the frame table to be freed from memory
+ * A helper function that finds the lowest naturally aligned run of free frames.
+ * @param frames the number of frames in the run, a power of two
+ * @param first where to store the first frame number of the run
+ * @return true if a run is free, else returns false
  */
-void frametable_free(frametable_t* tbl){
-    if (tbl != NULL) {
-        free(tbl->entries);
-        free(tbl);
+bool frame_find_run(size_t frames, framenum_t* first) {
+    bool found = false;
+    size_t end = frametable->free >= frames ? frametable->size : 0;
+    for (size_t start = 0; !found && start + frames <= end; start += frames) {
+        if (frames < 64) {
+            // the run is part of one word of the bitmap
+            uint64_t mask = ((1ULL << frames) - 1) << (start % 64);
+            found = (frametable->free_map[start / 64] & mask) == mask;
+        }
+        else {
+            // the run is whole words of the bitmap
+            found = true;
+            for (size_t word = start / 64; found && word < (start + frames) / 64; word++) {
+                found = frametable->free_map[word] == ~0ULL;
+            }
+        }
+        if (found) {
+            *first = start;
+        }
     }
+    return found;
 }
 
+/**
+ * A helper function that returns the tag a frame carries while the page in it may be used
+ * without the MMU lock.
+ * @param key the page key of the page
+ * @param writable true if the page may be written without the lock, else false
+ * @return the tag, which is never 0
+ */
+uint64_t frame_tag(uint64_t key, bool writable) {
+    return key << 2 | 2 | writable;
+}
 
-void mm_mem_destroy() {
-    if (mem_frames != NULL) {
-        free(mem_frames);
+/**
+ * A helper function that stops the page in a frame from being used without the MMU lock, when
+ * threaded.  Called with the MMU lock held, before the page leaves the frame or changes how it may
+ * be used; an access that pinned the frame before the tag was cleared is waited out by whatever
+ * waits for the frame's pins.
+ * @param framenum the frame number
+ */
+void frame_untag(framenum_t framenum) {
+    if (frametable != NULL && frametable->tags != NULL
+        && __atomic_load_n(&frametable->tags[framenum], __ATOMIC_RELAXED) != 0) {
+        __atomic_store_n(&frametable->tags[framenum], 0, __ATOMIC_SEQ_CST);
     }
+}
 
-    // free frame table
-    if (frametable != NULL) {
-        frametable_free(frametable);
+/**
+ * Marks a frame as holding the given page.
+ * @param framenum the frame number
+ * @param tbl the page table of the page now in the frame
+ * @param pagenum the virtual page number of the page now in the frame
+ */
+void frame_take(framenum_t framenum, pagetable_t* tbl, pagenum_t pagenum) {
+    fte_t* entry = &frametable->entries[framenum];
+    frame_untag(framenum);
+    if (!entry->occupied) {
+        size_t word = framenum / 64;
+        frametable->free_map[word] &= ~(1ULL << (framenum % 64));
+        if (frametable->free_map[word] == 0) {
+            frametable->free_summary[word / 64] &= ~(1ULL << (word % 64));
+        }
+        frametable->free--;
     }
+    entry->occupied = true;
+    entry->owner = tbl;
+    entry->pagenum = pagenum;
+    entry->refs = 1;
 }
 
-bool mm_vmem_init(char* pagefile) {
-    /*
-     * This function will be used to initialize a 256 page × 4KB/page = 1024KB = 1MB page file.
-     * Note: these pages should not actually appear in memory (yet), only on disk.  The contents
-     * of each page should initially be all zeroes.  Each time the simulation program is run, the
-     * page file should be overwritten, to simulate a cold start of actual hardware without
-     * hibernation.
-     */
+/**
+ * Marks a frame as free.
+ * @param framenum the frame number
+ */
+void frame_release(framenum_t framenum) {
+    fte_t* entry = &frametable->entries[framenum];
+    frame_untag(framenum);
+    if (entry->occupied) {
+        size_t word = framenum / 64;
+        frametable->free_map[word] |= 1ULL << (framenum % 64);
+        frametable->free_summary[word / 64] |= 1ULL << (word % 64);
+        frametable->free++;
+    }
+    entry->occupied = false;
+    entry->refs = 0;
+    entry->prefetched = false;
+    entry->prefetching = false;
+}
 
-    bool success = false;
-    int filesize = PAGETABLE_SIZE * PAGE_SIZE;
-    // open new pagefile in binary mode
-    FILE *pg_file = fopen(pagefile, "wb");
-    if (pg_file != NULL) {
-        success = true;
-        // make contents of pages all zeros
-        for (int i = 0; i < filesize; i++) {
-            // write to the file
-            fputc(0, pg_file);
-        }
+/**
+ * A helper function that takes the MMU lock, when threaded.
+ */
+void mmu_lock() {
+    if (threaded) {
+        pthread_mutex_lock(&mmu_mutex);
     }
+}
 
-    return success;
+/**
+ * A helper function that releases the MMU lock, when threaded.
+ */
+void mmu_unlock() {
+    if (threaded) {
+        pthread_mutex_unlock(&mmu_mutex);
+    }
 }
 
-pagetable_t* pagetable_alloc() {
-    pagetable_t* tbl = malloc(sizeof(pagetable_t));
-    if (tbl != NULL) {
-        tbl->entries = calloc(PAGETABLE_SIZE, sizeof(pte_t));
-        if (tbl->entries != NULL) {
-            tbl->size = PAGETABLE_SIZE;
-        }
-        else {
-            free(tbl);
-            tbl = NULL;
-        }
+/**
+ * A helper function that holds a frame for a copy, when threaded, so that no fault reuses it
+ * until it is unpinned.  It is called with the MMU lock held, so it never waits.
+ * @param framenum the frame number
+ * @param pin how the frame is to be held
+ * @return true if the frame is held as asked, else returns false if another thread holds it
+ */
+bool frame_trypin(framenum_t framenum, pin_t pin) {
+    bool success = true;
+    if (threaded && pin == PIN_READ) {
+        success = pthread_rwlock_tryrdlock(&frametable->locks[framenum]) == 0;
     }
-    return tbl;
+    else if (threaded && pin == PIN_WRITE) {
+        success = pthread_rwlock_trywrlock(&frametable->locks[framenum]) == 0;
+    }
+    return success;
 }
 
-void pagetable_free(pagetable_t* tbl) {
-    if (tbl != NULL) {
-        free(tbl->entries);
-        free(tbl);
+/**
+ * A helper function that lets go of a frame pinned by page_access().
+ * @param frame the frame
+ */
+void frame_unpin(const frame_t* frame) {
+    if (threaded) {
+        size_t framenum = ((const uint8_t*)frame - mem_frames) >> PAGE_SHIFT;
+        pthread_rwlock_unlock(&frametable->locks[framenum]);
     }
 }
 
+/**
+ * A helper function that waits, with the MMU lock released, until no thread is transferring or
+ * writing to a frame.
+ * @param framenum the frame number
+ */
+void frame_wait(framenum_t framenum) {
+    mmu_unlock();
+    pthread_rwlock_rdlock(&frametable->locks[framenum]);
+    pthread_rwlock_unlock(&frametable->locks[framenum]);
+    mmu_lock();
+}
 
-pte_t mk_pte(framenum_t framenum) {
-    pte_t result;
-    result.age = 0;
-    result.R = 0;       // has not been referenced yet
-    result.M = 0;
-    result.set = 0;
-    // the page is not yet in a frame
-    result.present = 0;
-    result.framenum = framenum;
-    return result;
+/**
+ * A helper function that sets the R bit and aging counter of the page in a frame as
+ * pte_mkyoung() does, if the frame has been used without the MMU lock since this was last done.
+ * @param framenum the frame number
+ * @return true if the frame had been used without the lock, else returns false
+ */
+bool frame_fold_young(framenum_t framenum) {
+    bool young = frametable->young != NULL
+                 && __atomic_load_n(&frametable->young[framenum], __ATOMIC_RELAXED)
+                 && __atomic_exchange_n(&frametable->young[framenum], 0, __ATOMIC_RELAXED);
+    const fte_t* entry = &frametable->entries[framenum];
+    if (young && entry->occupied) {
+        pte_mkyoung(entry->owner, entry->pagenum);
+    }
+    return young;
 }
 
-void set_pte(pagetable_t *tbl, pagenum_t pagenum, pte_t pte) {
-    pte.set = 1;            // entry has been set
-    tbl->entries[pagenum] = pte;
+/**
+ * A helper function that sets the R bit and aging counter of every page used without the MMU lock
+ * since this was last done, when threaded.
+ */
+void frames_fold_young() {
+    for (size_t i = 0; frametable != NULL && frametable->young != NULL && i < frametable->size;
+         i++) {
+        frame_fold_young(i);
+    }
 }
 
-pte_t pte_clear(pagetable_t *tbl, pagenum_t pagenum) {
-    pte_t old_page = tbl->entries[pagenum]; // copy of page
-    pte_t* result;
-    result = &tbl->entries[pagenum];     // get pointer to the entry
-    // reset everything
-    result->age = 0;
-    result->R = 0;
-    result->M = 0;
-    result->set = 0;
-    result->present = 0;
-    return old_page;
+/**
+ * A helper function that adds the accesses made without the MMU lock to the counters of the MMU
+ * and of each address space, when threaded.
+ */
+void accesses_fold() {
+    for (size_t row = 0; threaded && row < HIT_ROWS; row++) {
+        for (size_t asid = 0; asid < nspaces; asid++) {
+            uint64_t* count = &fast_accesses[row][asid];
+            uint64_t n = __atomic_load_n(count, __ATOMIC_RELAXED) != 0
+                         ? __atomic_exchange_n(count, 0, __ATOMIC_RELAXED) : 0;
+            vmstats.accesses += n;
+            spaces[asid].stats.accesses += n;
+        }
+    }
 }
 
-int pte_none(const pagetable_t *tbl, pagenum_t pagenum) {
-    int result = 1;
-    if (tbl->entries[pagenum].set) {
-        result = 0;
+/**
+ * A helper function that waits until the I/O thread has read every page it was given ahead.
+ */
+void prefetch_drain() {
+    if (prefetch_running) {
+        mmu_lock();
+        while (prefetch_pending > 0) {
+            pthread_cond_wait(&prefetch_done, &mmu_mutex);
+        }
+        mmu_unlock();
     }
-    return result;
 }
 
-int pte_present(const pagetable_t *tbl, pagenum_t pagenum) {
-    // look up the page's entry in the pagetable
-    pte_t entry = tbl->entries[pagenum];
-    // look at the present/absent bit in the entry
-    return entry.present;
+/**
+ * A helper function that waits until the flusher is between sweeps, and cancels any sweep asked
+ * for but not started, so that pages can be evicted without it.
+ */
+void writeback_quiesce() {
+    if (writeback_running) {
+        mmu_lock();
+        writeback_wanted = false;
+        while (writeback_active) {
+            pthread_cond_wait(&writeback_idle, &mmu_mutex);
+        }
+        mmu_unlock();
+    }
 }
 
-int pte_dirty(const pagetable_t *tbl, pagenum_t pagenum) {
-    return tbl->entries[pagenum].M;
+/**
+ * A helper function that counts present pages becoming dirty or clean, and wakes the flusher when
+ * more of them are dirty than its background ratio allows.
+ * @param delta 1 for a page made dirty, -1 for one made clean
+ */
+void dirty_count(int delta) {
+    dirty_frames += delta;
+    if (delta > 0 && writeback_running && !writeback_wanted
+        && dirty_frames * 100 > PAGE_FRAMES * writeback_opts.background_ratio) {
+        writeback_wanted = true;
+        pthread_cond_signal(&writeback_wake);
+    }
 }
 
-void pte_mkdirty(pagetable_t *tbl, pagenum_t pagenum) {
-    tbl->entries[pagenum].M = 1;
+bool mm_geometry_init(unsigned vaddr_bits, unsigned page_shift, size_t frames) {
+    bool success = mem_frames == NULL
+        && page_shift >= PAGE_SHIFT_MIN && page_shift <= PAGE_SHIFT_MAX
+        && vaddr_bits > page_shift && vaddr_bits <= VADDR_BITS_MAX
+        && frames > 0 && frames <= (size_t)UINT32_MAX + 1;
+#ifdef MMU_FIXED_GEOMETRY
+    // the constants compiled in cannot change
+    success = success && vaddr_bits == MMU_VADDR_BITS && page_shift == MMU_PAGE_SHIFT
+        && frames == MMU_FRAMES;
+#endif
+    if (success) {
+        mmu_geom.vaddr_bits = vaddr_bits;
+        mmu_geom.page_shift = page_shift;
+        mmu_geom.frames = frames;
+        mmu_geom.pages = (size_t)1 << (vaddr_bits - page_shift);
+    }
+    return success;
 }
 
-void pte_mkclean(pagetable_t *tbl, pagenum_t pagenum) {
-    tbl->entries[pagenum].M = 0;
+bool mm_spaces_init(size_t spaces, replace_scope_t scope) {
+    bool success = mem_frames == NULL && spaces > 0 && spaces <= ASID_MAX;
+    if (success) {
+        nspaces = spaces;
+        replace_scope = scope;
+    }
+    return success;
 }
 
-int pte_young(const pagetable_t *tbl, pagenum_t pagenum) {
-    return tbl->entries[pagenum].R;
+bool mm_threads_init() {
+    bool success = mem_frames == NULL;
+    if (success) {
+        threaded = true;
+    }
+    return success;
 }
 
-void pte_mkyoung(pagetable_t *tbl, pagenum_t pagenum) {
-    pte_t* current_pte = &tbl->entries[pagenum];
-    current_pte->R = 1;
-    // put a 1 in aging counter
-    current_pte->age |= 0b10000000;
+bool mm_readahead_init(size_t window, bool async) {
+    bool success = mem_frames == NULL && (!async || threaded);
+    if (success) {
+        readahead_window = window;
+        readahead_async = async && window > 0;
+    }
+    return success;
+}
 
+bool mm_superpages_init(unsigned order) {
+    bool success = mem_frames == NULL && order <= SUPERPAGE_ORDER_MAX;
+    if (success) {
+        superpage_order = order;
+    }
+    return success;
 }
 
-void pte_mkold(pagetable_t *tbl, pagenum_t pagenum) {
-    pte_t* current_pte = &tbl->entries[pagenum];
-    current_pte->R = 0;
-    current_pte->age >>= 1;
+bool mm_zcache_init(size_t budget) {
+    bool success = mem_frames == NULL;
+    if (success) {
+        zcache_budget = budget;
+    }
+    return success;
 }
 
-pte_t pte_val(pagetable_t *tbl, pagenum_t pagenum) {
-    pte_t result;
-    result = tbl->entries[pagenum];
-    return result;
+void* prefetch_main(void* arg);
+void* writeback_main(void* arg);
+void writeback_sweep(size_t target, size_t frames);
+
+bool mm_writeback_init(const writeback_opts_t* opts) {
+    bool success = mem_frames == NULL
+        && (opts == NULL || (opts->background_ratio <= 100 && opts->ratio <= 100
+                             && (!opts->async || threaded)));
+    if (success) {
+        writeback_on = opts != NULL;
+        if (opts != NULL) {
+            writeback_opts = *opts;
+        }
+    }
+    return success;
 }
 
-addr_t pagetable_translate(const pagetable_t *tbl, const vaddr_t vaddr) {
-    addr_t result;
+frame_t* mm_mem_init() {
+    if (mem_frames != NULL) {
+        fprintf(stderr, "simulation aborted\n");
+        abort();
+    }
+    mem_frames = calloc(PAGE_FRAMES, PAGE_SIZE);
+    fault_counts = pagemap_alloc(PAGE_FRAMES);
+    in_transit = threaded ? pagemap_alloc(PAGE_FRAMES) : NULL;
 
-    // offset stays the same
-    // translate 8 bit virtual pagenum to 4 bit physical framenum
+    // initialize frame table
+    frametable = frametable_alloc();
 
-    // get page table entry of pagenum
-    pte_t* pt_entry = &tbl->entries[vaddr.pagenum];
-    // ask its framenum and return it
-    result.framenum = pt_entry->framenum;
+    // pages read ahead in the background are handed to the I/O thread
+    if (readahead_async && frametable != NULL) {
+        prefetch_queue = malloc(PAGE_FRAMES * sizeof(prefetch_t));
+        prefetch_head = 0;
+        prefetch_count = 0;
+        prefetch_pending = 0;
+        prefetch_stop = false;
+        prefetch_running = prefetch_queue != NULL
+            && pthread_create(&prefetch_thread, NULL, prefetch_main, NULL) == 0;
+    }
 
-    // offset = other offset
-    result.offset = vaddr.offset;
+    // dirty pages are written back by a flusher of their own
+    dirty_frames = 0;
+    writeback_hand = 0;
+    if (writeback_on && writeback_opts.async && frametable != NULL) {
+        writeback_stop = false;
+        writeback_wanted = false;
+        writeback_running = pthread_create(&writeback_thread, NULL, writeback_main, NULL) == 0;
+    }
 
-    return result;
+    // replace by age unless told otherwise
+    if (mem_frames == NULL || fault_counts == NULL || (threaded && in_transit == NULL)
+        || frametable == NULL || (readahead_async && !prefetch_running)
+        || (writeback_on && writeback_opts.async && !writeback_running)
+        || !mm_policy_init(POLICY_AGING)) {
+        mm_mem_destroy();
+    }
+
+    return (frame_t*)mem_frames;
 }
 
+
 /**
- * A helper function that returns the frame corresponding to the specified page number
- * @param tbl the page table
- * @param pagenum the specified page number
- * @return the frame corresponding to the specified page number
+ * @brief Frees the specified frame table from memory.
+ * @param tbl the frame table to be freed from memory
  */
-frame_t* get_frame(pagetable_t* tbl, pagenum_t pagenum) {
-    int current_framenum = (tbl->entries[pagenum].framenum);
-    return &(mem_frames[current_framenum]);
+void frametable_free(frametable_t* tbl){
+    if (tbl != NULL) {
+        for (size_t i = 0; tbl->locks != NULL && i < tbl->size; i++) {
+            pthread_rwlock_destroy(&tbl->locks[i]);
+        }
+        free(tbl->locks);
+        free(tbl->tags);
+        free(tbl->young);
+        frameheap_free(tbl->resident);
+        free(tbl->free_summary);
+        free(tbl->free_map);
+        free(tbl->entries);
+        free(tbl);
+    }
 }
 
-void mm_page_evict(char* pagefile, pagetable_t* tbl, pagenum_t pagenum) {
-    pte_t* current_pte = &tbl->entries[pagenum];
-    // check if page is present
-    if(pte_present(tbl, pagenum)) {
-        frame_t *current_frame = get_frame(tbl, pagenum);
 
-        // if modified, write back to disk
-        if (pte_dirty(tbl, pagenum)) {
-            // open file
-            FILE *pg_file = fopen(pagefile, "rb+");
-            // seek to correct pg num
-            fseek(pg_file, PAGE_SIZE * pagenum, SEEK_SET);
-            // write page from frame starting at that spot
-            fwrite(current_frame, 1, PAGE_SIZE, pg_file);
-            fclose(pg_file);
-        }
-
-        // update pte for this page (present = 0)
-        pte_clear(tbl, 102);
-        // remove from frame
-        memset(current_frame, 0, PAGE_SIZE);
-        // mark frame as unoccupied
-        frametable->entries[current_pte->framenum].occupied = 0;
+void mm_mem_destroy() {
+    // let the I/O thread finish the pages it was given
+    if (prefetch_running) {
+        mmu_lock();
+        prefetch_stop = true;
+        pthread_cond_signal(&prefetch_ready);
+        mmu_unlock();
+        pthread_join(prefetch_thread, NULL);
+        prefetch_running = false;
+    }
+    free(prefetch_queue);
+    prefetch_queue = NULL;
+    if (writeback_running) {
+        mmu_lock();
+        writeback_stop = true;
+        pthread_cond_signal(&writeback_wake);
+        mmu_unlock();
+        pthread_join(writeback_thread, NULL);
+        writeback_running = false;
     }
-}
 
-void mm_page_load(char* pagefile, pagetable_t* tbl, pagenum_t pagenum) {
-    // look at pte for this pgnum and figure out which pg frame
-    pte_t* current_pte = &(tbl->entries[pagenum]);
-    frame_t* current_frame = get_frame(tbl, pagenum);
+    if (mem_frames != NULL) {
+        free(mem_frames);
+        mem_frames = NULL;
+    }
+    pagemap_free(fault_counts);
+    fault_counts = NULL;
+    pagemap_free(in_transit);
+    in_transit = NULL;
 
-    // open file
-    FILE *pg_file = fopen(pagefile, "wb");
-    // seek to correct pg num
-    fseek(pg_file, PAGE_SIZE * pagenum, SEEK_SET);
-    // read 4k bytes for page
-    // put bytes into page frame
-    fread(current_frame, 1, PAGE_SIZE, pg_file);
+    // free frame table
+    if (frametable != NULL) {
+        frametable_free(frametable);
+        frametable = NULL;
+    }
 
-    // mark frame as occupied
-    frametable->entries[current_pte->framenum].occupied = 1;
-    frametable->entries[current_pte->framenum].pagenum = pagenum;
-    // mark page as present
-    current_pte->present = 1;
-    // reset necessary bits
-    current_pte->M = 0;
-    current_pte->R = 0;
+    // free the policy's state
+    if (policy != NULL && policy->destroy != NULL) {
+        policy->destroy(policy_state);
+    }
+    policy = NULL;
+    policy_state = NULL;
 }
 
 /**
- * Evicts the page with the smallest aging counter, and loads the specified page into its frame.
- * @param pagefile the pagefile
+ * A helper function that chooses the frame holding the page with the smallest aging counter.
+ * The frame heap keeps the occupied frames ordered by age, so the victim is on top.  Under
+ * SCOPE_LOCAL only the frames of the faulting address space are considered.  A page used without
+ * the MMU lock since the last tick is aged as used, and the heap looked at again.
+ * @param state unused; the aging policy's state is the frame heap
  * @param tbl the page table
- * @param pagenum the page number of the page to be brought in
+ * @param pagenum the page number of the faulting page
+ * @param framenum where to store the victim frame
+ * @return true if a frame is occupied, else returns false
  */
-void aging_alg(char* pagefile, pagetable_t* tbl, pagenum_t pagenum) {
-    // choose best pg to evict and evict it
-    // look for page with smallest aging counter
-    pte_t* oldest_pte = NULL;
-    int oldest_pgnum = -1;
-    uint8_t oldest_age = 0b11111111;
-    for (int i = 0; i < PAGETABLE_SIZE; i++) {
-        pte_t* current_pte = &tbl->entries[i];
-        if (current_pte->age < oldest_age) {
-            oldest_age = current_pte->age;
-            oldest_pte = current_pte;
-            oldest_pgnum = i;
-        }
-    }
-    if (oldest_pgnum == -1) {
-        // pick random int between 0-255
-        srand(pagenum);
-        int upper_bound = 255;
-        int lower_bound = 0;
-        int num = (rand() % (upper_bound - lower_bound + 1)) + lower_bound;
-        // make it pagenum
-        oldest_pgnum = num;
-    }
-
-    mm_page_evict(pagefile, tbl, (pagenum_t)oldest_pgnum);
-    // update mapping for requested pg
-    pte_t new_pte = mk_pte(oldest_pte->framenum);
-    set_pte(tbl, pagenum, new_pte);
-    // load requested pg to frame
-    mm_page_load(pagefile, tbl, pagenum);
+bool aging_victim(void* state, pagetable_t* tbl, pagenum_t pagenum, framenum_t* framenum) {
+    frameheap_t* heap = replace_scope == SCOPE_LOCAL ? spaces[tbl->asid].resident
+                                                     : frametable->resident;
+    bool found = frameheap_min(heap, framenum);
+    for (size_t i = 0; found && i < frametable->size && frame_fold_young(*framenum); i++) {
+        found = frameheap_min(heap, framenum);
+    }
+    return found;
 }
 
-frame_t* pte_page(char* pagefile, pagetable_t* tbl, pagenum_t pagenum) {
-    pte_t current_pte = tbl->entries[pagenum];
-
-    // if page not present in memory
-    if (!pte_present(tbl, pagenum)) {
-        // if not mapped (not set):
-        if(pte_none(tbl, pagenum)) {
-            // search for a free frame
-            framenum_t i = 0;
-            int open_framenum = -1;
-            bool frame_found = false;
-            while (i < PAGE_FRAMES && open_framenum == -1) {
-                if (frametable->entries[i].occupied == 0) {
-                    open_framenum = i;
-                    frame_found = true;
-                }
-                i++;
-            }
-            //if there is an available frame:
-            if (frame_found) {
-                //map pg to it and load pg to it
-                pte_t new_pte = mk_pte(open_framenum);
-                set_pte(tbl, pagenum, new_pte);
-                mm_page_load(pagefile, tbl, pagenum);
-            }
+/**
+ * A helper function that finds the policy state that decides for an address space: its own under
+ * SCOPE_LOCAL, else the one shared by every address space.
+ * @param tbl the page table of the address space
+ * @return the policy state
+ */
+void* scope_state(const pagetable_t* tbl) {
+    return replace_scope == SCOPE_LOCAL ? spaces[tbl->asid].policy_state : policy_state;
+}
+
+/**
+ * A helper function that counts a page fault against the MMU and the faulting address space,
+ * telling a fault on a page never loaded from one on a page evicted since.
+ * @param tbl the page table
+ * @param pagenum the virtual page number of the faulting page
+ */
+void count_fault(const pagetable_t* tbl, pagenum_t pagenum) {
+    mmu_stats_t* stats = &spaces[tbl->asid].stats;
+    vmstats.faults++;
+    stats->faults++;
+    // a page that has faulted before has been evicted since
+    uint64_t* count = pagemap_insert(fault_counts, page_key(tbl, pagenum));
+    if (count == NULL || (*count)++ == 0) {
+        vmstats.cold_faults++;
+        stats->cold_faults++;
+    }
+    else {
+        vmstats.capacity_faults++;
+        stats->capacity_faults++;
+    }
+}
+
+/* the aging policy; the aging counters and the frame heap are kept up to date for every policy */
+static const policy_ops_t aging_ops = {
+    "aging", NULL, NULL, NULL, NULL, aging_victim, NULL, NULL
+};
+
+bool mm_policy_init(policy_kind_t kind) {
+    const policy_ops_t* ops = kind == POLICY_AGING ? &aging_ops : policy_ops(kind);
+    void* state = NULL;
+    bool result = false;
+    // the page tables' own instances cannot be swapped out from under them
+    bool in_use = false;
+    for (size_t i = 0; replace_scope == SCOPE_LOCAL && i < nspaces; i++) {
+        in_use = in_use || spaces[i].tbl != NULL;
+    }
+    if (ops != NULL && !in_use) {
+        if (ops->create != NULL) {
+            state = ops->create(PAGE_FRAMES, PAGETABLE_SIZE);
         }
-        else {
-            aging_alg(pagefile, tbl, pagenum);
+        if (ops->create == NULL || state != NULL) {
+            if (policy != NULL && policy->destroy != NULL) {
+                policy->destroy(policy_state);
+            }
+            policy = ops;
+            policy_state = state;
+            result = true;
         }
     }
-    // update R bit
-    pte_mkyoung(tbl, pagenum);
+    return result;
+}
+
+const char* mm_policy_name(policy_kind_t kind) {
+    const policy_ops_t* ops = kind == POLICY_AGING ? &aging_ops : policy_ops(kind);
+    return ops != NULL ? ops->name : "unknown";
+}
+
+bool mm_vmem_init(char* pagefile) {
+    pagefile_opts_t opts = {.mode = PAGEFILE_PIO};
+    return mm_vmem_init_opts(pagefile, &opts);
+}
+
+bool mm_vmem_init_opts(char* pagefile, const pagefile_opts_t* opts) {
+    /*
+     * This function will be used to initialize a 256 page × 4KB/page = 1024KB = 1MB page file.
+     * Note: these pages should not actually appear in memory (yet), only on disk.  The contents
+     * of each page should initially be all zeroes.  Each time the simulation program is run, the
+     * page file should be overwritten, to simulate a cold start of actual hardware without
+     * hibernation.
+     */
+
+    // one region per address space
+    size_t filesize = nspaces * PAGETABLE_SIZE * PAGE_SIZE;
+    // close any page file left open by a previous init
+    mm_vmem_destroy();
+    // a space too large to lay out page by page starts empty and grows a slot per written page
+    bool slotted = filesize > PAGEFILE_DIRECT_MAX;
+    // create new all-zero pagefile
+    bool success = pagefile_create(pagefile, slotted ? 0 : filesize, opts->create);
+    if (success) {
+        // hold the page file open for every later load and eviction
+        vmem = pagefile_open(pagefile, opts, nspaces * PAGETABLE_SIZE, slotted);
+        success = vmem != NULL;
+    }
+    if (success && zcache_budget > 0) {
+        zcache = zcache_alloc(zcache_budget, vmem);
+        success = zcache != NULL;
+    }
+
+    return success;
+}
+
+void mm_vmem_destroy() {
+    prefetch_drain();
+    writeback_quiesce();
+    // cached pages have nowhere to go once the page file is gone
+    zcache_free(zcache);
+    zcache = NULL;
+    if (vmem != NULL) {
+        pagefile_close(vmem);
+        vmem = NULL;
+    }
+}
+
+void mm_stats(mmu_stats_t* stats) {
+    mmu_lock();
+    accesses_fold();
+    *stats = vmstats;
+    stats->hits = vmstats.accesses - vmstats.faults;
+    if (zcache != NULL) {
+        zcache_usage(zcache, &stats->zcache_pages, &stats->zcache_bytes);
+    }
+    mmu_unlock();
+}
+
+void mm_stats_reset() {
+    mmu_lock();
+    accesses_fold();
+    memset(&vmstats, 0, sizeof(vmstats));
+    for (size_t i = 0; i < ASID_MAX; i++) {
+        memset(&spaces[i].stats, 0, sizeof(mmu_stats_t));
+    }
+    if (fault_counts != NULL) {
+        pagemap_clear(fault_counts);
+    }
+    mmu_unlock();
+}
+
+void mm_space_stats(asid_t asid, mmu_stats_t* stats) {
+    memset(stats, 0, sizeof(mmu_stats_t));
+    if (asid < ASID_MAX) {
+        mmu_lock();
+        accesses_fold();
+        *stats = spaces[asid].stats;
+        stats->hits = stats->accesses - stats->faults;
+        mmu_unlock();
+    }
+}
+
+pagetable_t* mm_space(asid_t asid) {
+    return asid < nspaces ? spaces[asid].tbl : NULL;
+}
+
+size_t mm_space_count() {
+    return nspaces;
+}
+
+/**
+ * A helper function that orders page fault counts by address space, then page number, for
+ * qsort().
+ * @param a the first page fault count
+ * @param b the second page fault count
+ * @return a negative, zero or positive number as a's page is lower than, equal to or higher than
+ * b's
+ */
+int page_faults_cmp(const void* a, const void* b) {
+    const page_faults_t* pa = a;
+    const page_faults_t* pb = b;
+    int result = (pa->asid > pb->asid) - (pa->asid < pb->asid);
+    if (result == 0) {
+        result = (pa->pagenum > pb->pagenum) - (pa->pagenum < pb->pagenum);
+    }
+    return result;
+}
+
+page_faults_t* mm_page_faults(size_t* count) {
+    page_faults_t* pages = NULL;
+    *count = 0;
+    mmu_lock();
+    if (fault_counts != NULL && fault_counts->size > 0) {
+        pages = malloc(fault_counts->size * sizeof(page_faults_t));
+    }
+    if (pages != NULL) {
+        for (size_t i = 0; i < fault_counts->capacity; i++) {
+            if (fault_counts->used[i]) {
+                pages[*count].asid = fault_counts->keys[i] >> ASID_SHIFT;
+                pages[*count].pagenum = fault_counts->keys[i] & ((1ULL << ASID_SHIFT) - 1);
+                pages[*count].faults = fault_counts->values[i];
+                (*count)++;
+            }
+        }
+        qsort(pages, *count, sizeof(page_faults_t), page_faults_cmp);
+    }
+    mmu_unlock();
+    return pages;
+}
+
+pagetable_t* pagetable_alloc() {
+    return pagetable_alloc_kind(PAGETABLE_SIZE <= PAGETABLE_FLAT_MAX ? PAGETABLE_FLAT
+                                                                     : PAGETABLE_RADIX);
+}
+
+pagetable_t* pagetable_alloc_kind(pagetable_kind_t kind) {
+    asid_t asid = 0;
+    while (asid < nspaces && spaces[asid].tbl != NULL) {
+        asid++;
+    }
+    return pagetable_alloc_space(kind, asid);
+}
+
+pagetable_t* pagetable_alloc_space(pagetable_kind_t kind, asid_t asid) {
+    pagetable_t* tbl = NULL;
+    if (asid < nspaces && spaces[asid].tbl == NULL) {
+        tbl = calloc(1, sizeof(pagetable_t));
+    }
+    if (tbl != NULL) {
+        bool success;
+        tbl->kind = kind;
+        tbl->asid = asid;
+        if (kind == PAGETABLE_RADIX) {
+            // enough levels to resolve every page number bit
+            unsigned bits = VADDR_BITS - PAGE_SHIFT;
+            tbl->levels = (bits + RADIX_BITS - 1) / RADIX_BITS;
+            if (tbl->levels > 1) {
+                tbl->root = calloc(RADIX_FANOUT, sizeof(void*));
+                tbl->nodes = 1;
+            }
+            else {
+                tbl->root = calloc(1, sizeof(pteleaf_t));
+            }
+            success = tbl->root != NULL;
+            if (success && tbl->levels == 1) {
+                tbl->leaves = malloc(sizeof(pteleaf_t*));
+                success = tbl->leaves != NULL;
+                if (success) {
+                    tbl->leaves[0] = (pteleaf_t*)tbl->root;
+                    tbl->nleaves = 1;
+                    tbl->leaves_cap = 1;
+                }
+            }
+        }
+        else {
+            // a flat table has an entry per page, an inverted one an entry per frame
+            tbl->size = kind == PAGETABLE_HASHED ? PAGE_FRAMES : PAGETABLE_SIZE;
+            tbl->entries = calloc(tbl->size, sizeof(pte_t));
+            tbl->age = calloc(tbl->size, sizeof(uint8_t));
+            tbl->ref = calloc(tbl->size, sizeof(uint8_t));
+            success = tbl->entries != NULL && tbl->age != NULL && tbl->ref != NULL;
+            if (kind == PAGETABLE_HASHED) {
+                tbl->owner = calloc(tbl->size, sizeof(pagenum_t));
+                tbl->index = pagemap_alloc(tbl->size);
+                success = success && tbl->owner != NULL && tbl->index != NULL;
+            }
+        }
+        readahead_reset(&spaces[asid].ra);
+        if (success && replace_scope == SCOPE_LOCAL) {
+            // the address space replaces its own pages, by its own history
+            space_t* space = &spaces[asid];
+            space->resident = frameheap_alloc(PAGE_FRAMES);
+            if (policy != NULL && policy->create != NULL) {
+                space->policy_state = policy->create(PAGE_FRAMES, PAGETABLE_SIZE);
+                success = space->policy_state != NULL;
+            }
+            success = success && space->resident != NULL;
+        }
+        // claim the ASID even on failure, so pagetable_free() releases what was allocated
+        spaces[asid].tbl = tbl;
+        if (!success) {
+            pagetable_free(tbl);
+            tbl = NULL;
+        }
+    }
+    return tbl;
+}
+
+/**
+ * A helper function that frees a radix page table level and every level below it.
+ * @param node the level
+ * @param level the number of levels below it
+ */
+void radix_free(void** node, unsigned level) {
+    if (node != NULL && level > 0) {
+        for (size_t i = 0; i < RADIX_FANOUT; i++) {
+            if (level > 1) {
+                radix_free(node[i], level - 1);
+            }
+            else {
+                free(node[i]);
+            }
+        }
+    }
+    free(node);
+}
+
+void pagetable_free(pagetable_t* tbl) {
+    if (tbl != NULL) {
+        space_t* space = &spaces[tbl->asid];
+        if (space->tbl == tbl) {
+            // release the ASID
+            frameheap_free(space->resident);
+            if (space->policy_state != NULL && policy != NULL && policy->destroy != NULL) {
+                policy->destroy(space->policy_state);
+            }
+            space->tbl = NULL;
+            space->resident = NULL;
+            space->policy_state = NULL;
+        }
+        // a page table given the ASID later must not use the frames this one leaves behind
+        for (size_t i = 0; frametable != NULL && frametable->tags != NULL && i < frametable->size;
+             i++) {
+            if (frametable->entries[i].owner == tbl) {
+                frame_untag(i);
+                frametable->young[i] = 0;
+            }
+        }
+        tlb_free(tbl->tlb);
+        free(tbl->entries);
+        free(tbl->age);
+        free(tbl->ref);
+        if (tbl->levels > 0) {
+            radix_free(tbl->root, tbl->levels - 1);
+        }
+        free(tbl->leaves);
+        free(tbl->owner);
+        pagemap_free(tbl->index);
+        free(tbl);
+    }
+}
+
+size_t pagetable_bytes(const pagetable_t* tbl) {
+    size_t bytes = sizeof(pagetable_t) + tbl->size * (sizeof(pte_t) + 2 * sizeof(uint8_t));
+    if (tbl->kind == PAGETABLE_RADIX) {
+        bytes += tbl->nodes * RADIX_FANOUT * sizeof(void*) + tbl->nleaves * sizeof(pteleaf_t)
+            + tbl->leaves_cap * sizeof(pteleaf_t*);
+    }
+    else if (tbl->kind == PAGETABLE_HASHED) {
+        bytes += tbl->size * sizeof(pagenum_t) + pagemap_bytes(tbl->index);
+    }
+    return bytes;
+}
+
+/**
+ * A helper function that doubles the capacity of the list of leaves of a radix page table.
+ * @param tbl the page table
+ * @return true if the list grew, else returns false
+ */
+bool pagetable_grow_leaves(pagetable_t* tbl) {
+    size_t cap = tbl->leaves_cap > 0 ? 2 * tbl->leaves_cap : 16;
+    pteleaf_t** leaves = realloc(tbl->leaves, cap * sizeof(pteleaf_t*));
+    if (leaves != NULL) {
+        tbl->leaves = leaves;
+        tbl->leaves_cap = cap;
+    }
+    return leaves != NULL;
+}
+
+/**
+ * @struct pte_slot_t
+ * @brief Where the entry, aging counter and R bit of one page are stored.
+ */
+typedef struct {
+    pte_t* pte;      /**< the page table entry */
+    uint8_t* age;    /**< its aging counter */
+    uint8_t* ref;    /**< its R bit */
+} pte_slot_t;
+
+/**
+ * A helper function that finds where the entry of a page is stored.  A flat table has an entry
+ * for every page; in the other kinds, a page has one only once it has been set.
+ * @param tbl the page table
+ * @param pagenum the virtual page number
+ * @param slot where to store the location of the entry
+ * @return true if the page has an entry, else returns false
+ */
+static inline bool pte_find(const pagetable_t* tbl, pagenum_t pagenum, pte_slot_t* slot) {
+    bool found = true;
+    size_t i = pagenum;
+    if (tbl->kind == PAGETABLE_RADIX) {
+        // walk down from the root, one RADIX_BITS slice of the page number per level
+        void** node = tbl->root;
+        for (unsigned level = tbl->levels - 1; node != NULL && level > 0; level--) {
+            node = node[(pagenum >> (level * RADIX_BITS)) & (RADIX_FANOUT - 1)];
+        }
+        found = node != NULL;
+        if (found) {
+            pteleaf_t* leaf = (pteleaf_t*)node;
+            i = pagenum & (RADIX_FANOUT - 1);
+            slot->pte = &leaf->entries[i];
+            slot->age = &leaf->age[i];
+            slot->ref = &leaf->ref[i];
+        }
+    }
+    else {
+        if (tbl->kind == PAGETABLE_HASHED) {
+            const uint64_t* framenum = pagemap_find(tbl->index, pagenum);
+            found = framenum != NULL;
+            i = found ? *framenum : 0;
+        }
+        slot->pte = &tbl->entries[i];
+        slot->age = &tbl->age[i];
+        slot->ref = &tbl->ref[i];
+    }
+    return found;
+}
+
+/**
+ * A helper function that finds where the entry of a page is stored, making room for it if it has
+ * none.  In a hashed table the entry goes in the element of the frame it maps to, replacing the
+ * entry of any other page mapped to that frame.
+ * @param tbl the page table
+ * @param pagenum the virtual page number
+ * @param framenum the frame the entry will map to
+ * @param slot where to store the location of the entry
+ * @return true if the page has an entry, else returns false if there was no memory for one or, in
+ * a hashed table, the frame number is out of range
+ */
+static bool pte_make(pagetable_t* tbl, pagenum_t pagenum, framenum_t framenum, pte_slot_t* slot) {
+    bool found = pte_find(tbl, pagenum, slot);
+    if (tbl->kind == PAGETABLE_RADIX && !found) {
+        void** node = tbl->root;
+        for (unsigned level = tbl->levels - 1; node != NULL && level > 0; level--) {
+            void** child = &node[(pagenum >> (level * RADIX_BITS)) & (RADIX_FANOUT - 1)];
+            if (*child == NULL) {
+                if (level > 1) {
+                    *child = calloc(RADIX_FANOUT, sizeof(void*));
+                    tbl->nodes += *child != NULL;
+                }
+                else if (tbl->nleaves < tbl->leaves_cap || pagetable_grow_leaves(tbl)) {
+                    *child = calloc(1, sizeof(pteleaf_t));
+                    if (*child != NULL) {
+                        tbl->leaves[tbl->nleaves++] = *child;
+                    }
+                }
+            }
+            node = *child;
+        }
+        found = pte_find(tbl, pagenum, slot);
+    }
+    else if (tbl->kind == PAGETABLE_HASHED && framenum < tbl->size
+             && (!found || slot->pte != &tbl->entries[framenum])) {
+        if (found) {
+            // the page moves to another frame
+            pagemap_remove(tbl->index, pagenum);
+        }
+        // the frame's element is taken over from its current page, if any
+        const uint64_t* owned = pagemap_find(tbl->index, tbl->owner[framenum]);
+        if (owned != NULL && *owned == framenum) {
+            pagemap_remove(tbl->index, tbl->owner[framenum]);
+            tlb_invalidate(tbl->tlb, page_key(tbl, tbl->owner[framenum]));
+        }
+        uint64_t* value = pagemap_insert(tbl->index, pagenum);
+        found = value != NULL;
+        if (found) {
+            *value = framenum;
+            tbl->owner[framenum] = pagenum;
+            memset(&tbl->entries[framenum], 0, sizeof(pte_t));
+            tbl->age[framenum] = 0;
+            tbl->ref[framenum] = 0;
+            found = pte_find(tbl, pagenum, slot);
+        }
+    }
+    return found;
+}
+
+/**
+ * A helper function that adds a frame to the heap of occupied frames and, under SCOPE_LOCAL, to
+ * the heap of the address space whose page it holds.
+ * @param tbl the page table of the page in the frame
+ * @param framenum the frame number
+ * @param age the aging counter of the page in the frame
+ */
+void resident_push(const pagetable_t* tbl, framenum_t framenum, uint8_t age) {
+    frameheap_push(frametable->resident, framenum, age);
+    if (spaces[tbl->asid].resident != NULL) {
+        frameheap_push(spaces[tbl->asid].resident, framenum, age);
+    }
+}
+
+/**
+ * A helper function that updates the age of a frame in the heaps that hold it.
+ * @param tbl the page table of the page in the frame
+ * @param framenum the frame number
+ * @param age the new aging counter of the page in the frame
+ */
+void resident_update(const pagetable_t* tbl, framenum_t framenum, uint8_t age) {
+    frameheap_update(frametable->resident, framenum, age);
+    if (spaces[tbl->asid].resident != NULL) {
+        frameheap_update(spaces[tbl->asid].resident, framenum, age);
+    }
+}
+
+/**
+ * A helper function that removes a frame from the heaps that hold it.
+ * @param tbl the page table of the page in the frame
+ * @param framenum the frame number
+ */
+void resident_remove(const pagetable_t* tbl, framenum_t framenum) {
+    frameheap_remove(frametable->resident, framenum);
+    if (spaces[tbl->asid].resident != NULL) {
+        frameheap_remove(spaces[tbl->asid].resident, framenum);
+    }
+}
+
+pte_t mk_pte(framenum_t framenum) {
+    pte_t result;
+    result.age = 0;
+    result.R = 0;       // has not been referenced yet
+    result.M = 0;
+    result.set = 0;
+    // the page is not yet in a frame
+    result.present = 0;
+    result.huge = 0;
+    result.cow = 0;
+    result.framenum = framenum;
+    return result;
+}
+
+/**
+ * A helper function that splits the superpage holding a page back into single pages, as when one
+ * of its pages is about to be evicted or remapped.  The pages stay present in their frames.
+ * @param tbl the page table
+ * @param pagenum a virtual page number of the superpage
+ */
+void superpage_demote(pagetable_t* tbl, pagenum_t pagenum) {
+    size_t pages = (size_t)1 << superpage_order;
+    pagenum_t first = pagenum & ~(pagenum_t)(pages - 1);
+    for (size_t i = 0; i < pages; i++) {
+        pte_slot_t slot;
+        if (pte_find(tbl, first + i, &slot)) {
+            slot.pte->huge = 0;
+        }
+    }
+    // the one entry caching the superpage goes with it
+    tlb_invalidate(tbl->tlb, page_key(tbl, first));
+    vmstats.demotions++;
+    spaces[tbl->asid].stats.demotions++;
+}
+
+void set_pte(pagetable_t *tbl, pagenum_t pagenum, pte_t pte) {
+    pte_slot_t slot;
+    if (pte_find(tbl, pagenum, &slot) && slot.pte->huge) {
+        superpage_demote(tbl, pagenum);
+    }
+    if (pte_make(tbl, pagenum, pte.framenum, &slot)) {
+        dirty_count((pte.present && pte.M) - (slot.pte->present && slot.pte->M));
+        if (slot.pte->present) {
+            frame_untag(slot.pte->framenum);
+        }
+        pte.set = 1;            // entry has been set
+        *slot.pte = pte;
+        *slot.age = pte.age;
+        *slot.ref = pte.R;
+    }
+    // any cached translation is now stale
+    tlb_invalidate(tbl->tlb, page_key(tbl, pagenum));
+}
+
+pte_t pte_clear(pagetable_t *tbl, pagenum_t pagenum) {
+    pte_t old_page = pte_val(tbl, pagenum); // copy of page
+    pte_slot_t slot;
+    if (pte_find(tbl, pagenum, &slot)) {
+        if (slot.pte->huge) {
+            superpage_demote(tbl, pagenum);
+        }
+        // reset everything
+        dirty_count(-(slot.pte->present && slot.pte->M));
+        if (slot.pte->present) {
+            frame_untag(slot.pte->framenum);
+        }
+        *slot.age = 0;
+        *slot.ref = 0;
+        slot.pte->M = 0;
+        slot.pte->set = 0;
+        slot.pte->present = 0;
+        slot.pte->cow = 0;
+        // an inverted table keeps entries only for pages that have one
+        if (tbl->kind == PAGETABLE_HASHED) {
+            pagemap_remove(tbl->index, pagenum);
+        }
+    }
+    // drop the cached translation
+    tlb_invalidate(tbl->tlb, page_key(tbl, pagenum));
+    return old_page;
+}
+
+int pte_none(const pagetable_t *tbl, pagenum_t pagenum) {
+    int result = 1;
+    pte_slot_t slot;
+    if (pte_find(tbl, pagenum, &slot) && slot.pte->set) {
+        result = 0;
+    }
+    return result;
+}
+
+int pte_present(const pagetable_t *tbl, pagenum_t pagenum) {
+    // look up the page's entry in the pagetable
+    pte_slot_t slot;
+    // look at the present/absent bit in the entry
+    return pte_find(tbl, pagenum, &slot) && slot.pte->present;
+}
+
+int pte_dirty(const pagetable_t *tbl, pagenum_t pagenum) {
+    pte_slot_t slot;
+    return pte_find(tbl, pagenum, &slot) && slot.pte->M;
+}
+
+void pte_mkdirty(pagetable_t *tbl, pagenum_t pagenum) {
+    pte_slot_t slot;
+    if (pte_find(tbl, pagenum, &slot)) {
+        dirty_count(slot.pte->present && !slot.pte->M);
+        slot.pte->M = 1;
+    }
+}
+
+void pte_mkclean(pagetable_t *tbl, pagenum_t pagenum) {
+    pte_slot_t slot;
+    if (pte_find(tbl, pagenum, &slot)) {
+        dirty_count(-(slot.pte->present && slot.pte->M));
+        // a write without the MMU lock would not make it dirty again
+        if (slot.pte->present) {
+            frame_untag(slot.pte->framenum);
+        }
+        slot.pte->M = 0;
+    }
+}
+
+int pte_young(const pagetable_t *tbl, pagenum_t pagenum) {
+    pte_slot_t slot;
+    return pte_find(tbl, pagenum, &slot) && *slot.ref;
+}
+
+void pte_mkyoung(pagetable_t *tbl, pagenum_t pagenum) {
+    pte_slot_t slot;
+    if (pte_find(tbl, pagenum, &slot)) {
+        *slot.ref = 1;
+        // put a 1 in aging counter
+        *slot.age |= 0b10000000;
+        // keep the victim order of resident pages up to date
+        if (slot.pte->present) {
+            resident_update(tbl, slot.pte->framenum, *slot.age);
+        }
+    }
+}
+
+void pte_mkold(pagetable_t *tbl, pagenum_t pagenum) {
+    pte_slot_t slot;
+    if (pte_find(tbl, pagenum, &slot)) {
+        *slot.ref = 0;
+        *slot.age >>= 1;
+        if (slot.pte->present) {
+            resident_update(tbl, slot.pte->framenum, *slot.age);
+        }
+    }
+}
+
+/**
+ * A helper function that shifts a run of aging counters right by one and clears their R bits.
+ * @param age the aging counters
+ * @param ref the R bits
+ * @param size the number of entries
+ */
+void age_entries(uint8_t* age, uint8_t* ref, size_t size) {
+    size_t i = 0;
+#ifdef __SSE2__
+    // shift 16 counters at a time; the mask drops the bit shifted in from the next byte
+    const __m128i mask = _mm_set1_epi8(0x7f);
+    for (; i + 16 <= size; i += 16) {
+        __m128i ages = _mm_loadu_si128((const __m128i*)&age[i]);
+        ages = _mm_and_si128(_mm_srli_epi16(ages, 1), mask);
+        _mm_storeu_si128((__m128i*)&age[i], ages);
+    }
+#endif
+    for (; i < size; i++) {
+        age[i] >>= 1;
+    }
+    memset(ref, 0, size);
+}
+
+/**
+ * A helper function that advances every aging counter of one page table by one tick.
+ * @param tbl the page table
+ */
+void age_table(pagetable_t* tbl) {
+    if (tbl->kind == PAGETABLE_RADIX) {
+        // untouched parts of the address space have no leaves to age
+        for (size_t i = 0; i < tbl->nleaves; i++) {
+            age_entries(tbl->leaves[i]->age, tbl->leaves[i]->ref, RADIX_FANOUT);
+        }
+    }
+    else {
+        age_entries(tbl->age, tbl->ref, tbl->size);
+    }
+}
+
+void pagetable_age(pagetable_t* tbl, bool resident_only) {
+    mmu_lock();
+    // uses without the lock since the last tick count as this tick's
+    frames_fold_young();
+    if (resident_only) {
+        // only resident pages can have a nonzero counter
+        for (size_t i = 0; i < frametable->size; i++) {
+            fte_t* entry = &frametable->entries[i];
+            pte_slot_t slot;
+            if (entry->occupied && pte_find(entry->owner, entry->pagenum, &slot)) {
+                *slot.age >>= 1;
+                *slot.ref = 0;
+            }
+        }
+    }
+    else {
+        for (size_t i = 0; i < nspaces; i++) {
+            if (spaces[i].tbl != NULL) {
+                age_table(spaces[i].tbl);
+            }
+        }
+    }
+    // the shift keeps resident pages in the same order
+    frameheap_age(frametable->resident);
+    // pages may have aged past the flusher's cutoff
+    if (writeback_running) {
+        writeback_wanted = true;
+        pthread_cond_signal(&writeback_wake);
+    }
+    else if (writeback_on) {
+        writeback_sweep(PAGE_FRAMES * writeback_opts.background_ratio / 100, WRITEBACK_BATCH);
+    }
+    if (replace_scope == SCOPE_GLOBAL && policy->tick != NULL) {
+        policy->tick(policy_state, tbl);
+    }
+    for (size_t i = 0; replace_scope == SCOPE_LOCAL && i < nspaces; i++) {
+        if (spaces[i].tbl != NULL) {
+            frameheap_age(spaces[i].resident);
+            if (policy->tick != NULL) {
+                policy->tick(spaces[i].policy_state, spaces[i].tbl);
+            }
+        }
+    }
+    mmu_unlock();
+}
+
+pte_t pte_val(pagetable_t *tbl, pagenum_t pagenum) {
+    pte_t result;
+    pte_slot_t slot;
+    if (pte_find(tbl, pagenum, &slot)) {
+        result = *slot.pte;
+        result.age = *slot.age;
+        result.R = *slot.ref;
+    }
+    else {
+        // a page that was never set has an all-zero entry
+        memset(&result, 0, sizeof(result));
+    }
+    return result;
+}
+
+/**
+ * A helper function that caches the translation of a present page in the page table's TLB, as one
+ * entry for its whole superpage if it is part of one.
+ * @param tbl the page table
+ * @param pagenum the virtual page number
+ * @param pte the page's entry
+ */
+void tlb_cache(const pagetable_t* tbl, pagenum_t pagenum, pte_t pte) {
+    if (pte.huge) {
+        pagenum_t first = pagenum >> superpage_order << superpage_order;
+        framenum_t base = pte.framenum - (framenum_t)(pagenum - first);
+        tlb_insert_huge(tbl->tlb, page_key(tbl, first), base, superpage_order);
+    }
+    else {
+        tlb_insert(tbl->tlb, page_key(tbl, pagenum), pte.framenum);
+    }
+}
+
+addr_t pagetable_translate(const pagetable_t *tbl, const vaddr_t vaddr) {
+    addr_t result;
+
+    // offset stays the same
+    // translate 8 bit virtual pagenum to 4 bit physical framenum
+
+    framenum_t framenum;
+    // try the TLB first
+    if (!tlb_lookup(tbl->tlb, page_key(tbl, vaddr.pagenum), &framenum)) {
+        // get page table entry of pagenum
+        pte_slot_t slot;
+        bool found = pte_find(tbl, vaddr.pagenum, &slot);
+        // ask its framenum and return it
+        framenum = found ? slot.pte->framenum : 0;
+        if (found && slot.pte->present) {
+            tlb_cache(tbl, vaddr.pagenum, *slot.pte);
+        }
+    }
+    result.framenum = framenum;
+
+    // offset = other offset
+    result.offset = vaddr.offset;
+
+    return result;
+}
+
+/**
+ * A helper function that returns the frame corresponding to the specified page number
+ * @param tbl the page table
+ * @param pagenum the specified page number
+ * @return the frame corresponding to the specified page number
+ */
+frame_t* get_frame(pagetable_t* tbl, pagenum_t pagenum) {
+    size_t current_framenum = pte_val(tbl, pagenum).framenum;
+    return (frame_t*)(mem_frames + (current_framenum << PAGE_SHIFT));
+}
+
+/**
+ * A helper function that finds where a page is kept in the page file.  Each address space has a
+ * region of the page file to itself.
+ * @param tbl the page table of the page's address space
+ * @param pagenum the virtual page number
+ * @return the number of the page's page-sized slot in the page file
+ */
+pagenum_t swap_page(const pagetable_t* tbl, pagenum_t pagenum) {
+    return (pagenum_t)tbl->asid * PAGETABLE_SIZE + pagenum;
+}
+
+/**
+ * A helper function that maps a superpage once its last page is present: when every page of it is
+ * present, and its pages are in a naturally aligned run of frames in the same order, the page-size
+ * bit of each is set so that one TLB entry can map them all.
+ * @param tbl the page table
+ * @param pagenum the virtual page number of the page just made present
+ */
+void superpage_promote(pagetable_t* tbl, pagenum_t pagenum) {
+    size_t pages = (size_t)1 << superpage_order;
+    pagenum_t first = pagenum & ~(pagenum_t)(pages - 1);
+    pte_slot_t slot;
+    bool whole = superpage_order > 0 && first + pages <= PAGETABLE_SIZE
+                 && pte_find(tbl, pagenum, &slot) && slot.pte->framenum >= pagenum - first;
+    framenum_t base = whole ? slot.pte->framenum - (framenum_t)(pagenum - first) : 0;
+    whole = whole && base % pages == 0 && base + pages <= frametable->size;
+    // last page first, since the pages of a superpage faulted in whole are mapped first page first
+    for (size_t i = pages; whole && i-- > 0;) {
+        const fte_t* entry = &frametable->entries[base + i];
+        whole = entry->occupied && entry->owner == tbl && entry->pagenum == first + i
+                && pte_present(tbl, first + i);
+    }
+    for (size_t i = 0; whole && i < pages; i++) {
+        pte_find(tbl, first + i, &slot);
+        slot.pte->huge = 1;
+    }
+    if (whole) {
+        vmstats.promotions++;
+        spaces[tbl->asid].stats.promotions++;
+    }
+}
+
+/**
+ * A helper function that marks a page present in the frame its entry maps it to, once the page's
+ * bytes are in the frame, and makes the frame a replacement candidate.  A superpage whose last
+ * page this is, is promoted.
+ * @param tbl the page table
+ * @param pagenum the virtual page number
+ */
+void page_mapped(pagetable_t* tbl, pagenum_t pagenum) {
+    pte_slot_t slot;
+    if (pte_find(tbl, pagenum, &slot)) {
+        // mark frame as occupied by this page
+        frame_take(slot.pte->framenum, tbl, pagenum);
+        dirty_count(-(slot.pte->present && slot.pte->M));
+        // mark page as present
+        slot.pte->present = 1;
+        // reset necessary bits
+        slot.pte->M = 0;
+        *slot.ref = 0;
+        // the page is now a replacement candidate
+        resident_push(tbl, slot.pte->framenum, *slot.age);
+        superpage_promote(tbl, pagenum);
+    }
+}
+
+/**
+ * A helper function that returns true if every byte of a frame is zero.
+ * @param frame the page frame
+ * @return true if the frame holds only zeros, else returns false
+ */
+bool frame_zero(const frame_t* frame) {
+    const uint64_t* words = (const uint64_t*)frame->bytes;
+    uint64_t any = 0;
+    for (size_t i = 0; i < PAGE_SIZE / sizeof(uint64_t) && any == 0; i += 8) {
+        // eight words at a time, so that the loop is not held up by its own exit test
+        for (size_t j = 0; j < 8; j++) {
+            any |= words[i + j];
+        }
+    }
+    return any == 0;
+}
+
+/**
+ * A helper function that brings a page's bytes into a frame from the compressed page cache, else
+ * from the page file.  A page the page file holds only zeros for is zeroed in the frame without
+ * reading.  Needs no MMU lock, so long as no other thread uses the frame or transfers the page.
+ * @param tbl the page table
+ * @param pagenum the virtual page number
+ * @param frame the page frame
+ * @return where the page's bytes came from
+ */
+tier_t page_read(const pagetable_t* tbl, pagenum_t pagenum, frame_t* frame) {
+    tier_t tier = TIER_ZCACHE;
+    if (zcache == NULL || !zcache_load(zcache, swap_page(tbl, pagenum), frame)) {
+        tier = pagefile_zero(vmem, swap_page(tbl, pagenum)) ? TIER_ZERO : TIER_PAGEFILE;
+        if (tier == TIER_ZERO || !pagefile_read(vmem, swap_page(tbl, pagenum), frame)) {
+            // a failed read leaves nothing of the frame's last page behind
+            memset(frame, 0, PAGE_SIZE);
+        }
+    }
+    return tier;
+}
+
+/**
+ * A helper function that writes a dirty page's bytes back from its frame to the compressed page
+ * cache, else to the page file.  A page that is all zeros is only recorded as such, without
+ * writing.  Needs no MMU lock, so long as no other thread uses the frame or transfers the page.
+ * @param tbl the page table
+ * @param pagenum the virtual page number
+ * @param frame the page frame
+ * @param spilled where to store the number of pages the cache spilled to the page file to make
+ * room for this one
+ * @return where the page's bytes went
+ */
+tier_t page_write(const pagetable_t* tbl, pagenum_t pagenum, const frame_t* frame,
+                  size_t* spilled) {
+    tier_t tier = frame_zero(frame) ? TIER_ZERO : TIER_ZCACHE;
+    *spilled = 0;
+    if (tier == TIER_ZERO) {
+        // neither tier may keep an older copy
+        if (zcache != NULL) {
+            zcache_drop(zcache, swap_page(tbl, pagenum));
+        }
+        pagefile_discard(vmem, swap_page(tbl, pagenum));
+    }
+    else if (zcache == NULL || !zcache_store(zcache, swap_page(tbl, pagenum), frame, spilled)) {
+        tier = TIER_PAGEFILE;
+        pagefile_write(vmem, swap_page(tbl, pagenum), frame);
+    }
+    return tier;
+}
+
+/**
+ * A helper function that counts a page brought in by page_read().
+ * @param tbl the page table
+ * @param tier where the page's bytes came from
+ */
+void count_read(const pagetable_t* tbl, tier_t tier) {
+    mmu_stats_t* stats = &spaces[tbl->asid].stats;
+    if (tier == TIER_ZERO) {
+        vmstats.zero_fills++;
+        stats->zero_fills++;
+    }
+    else if (tier == TIER_ZCACHE) {
+        vmstats.zcache_hits++;
+        stats->zcache_hits++;
+    }
+    else {
+        vmstats.bytes_read += PAGE_SIZE;
+        stats->bytes_read += PAGE_SIZE;
+    }
+}
+
+/**
+ * A helper function that counts a page written back by page_write(), at its eviction or ahead of
+ * it, and the pages the compressed page cache spilled to make room for it.
+ * @param tbl the page table
+ * @param tier where the page's bytes went
+ * @param spilled the number of pages spilled
+ * @param flush true if the page was written back ahead of its eviction
+ */
+void count_write(const pagetable_t* tbl, tier_t tier, size_t spilled, bool flush) {
+    mmu_stats_t* stats = &spaces[tbl->asid].stats;
+    // spills are the cache's, not this space's
+    vmstats.zcache_spills += spilled;
+    vmstats.bytes_written += spilled * PAGE_SIZE;
+    if (tier == TIER_ZERO) {
+        vmstats.zero_discards++;
+        stats->zero_discards++;
+    }
+    else if (tier == TIER_ZCACHE) {
+        vmstats.zcache_stores++;
+        stats->zcache_stores++;
+    }
+    else {
+        vmstats.bytes_written += PAGE_SIZE;
+        stats->bytes_written += PAGE_SIZE;
+        if (flush) {
+            vmstats.flushes++;
+            stats->flushes++;
+        }
+        else {
+            vmstats.writebacks++;
+            stats->writebacks++;
+        }
+    }
+}
+
+/**
+ * A helper function that returns true if a page table maps the page held by a frame to that frame.
+ * Every page table sharing a frame maps it at the same page, the one it was forked at.
+ * @param tbl the page table
+ * @param framenum the frame number
+ * @return true if the page table's entry for the frame's page maps it, else returns false
+ */
+bool frame_mapped(const pagetable_t* tbl, framenum_t framenum) {
+    const fte_t* entry = &frametable->entries[framenum];
+    pte_slot_t slot;
+    return entry->occupied && pte_find(tbl, entry->pagenum, &slot) && slot.pte->present
+           && slot.pte->framenum == framenum;
+}
+
+/**
+ * A helper function that finds a page table, other than the given one, mapping a shared frame.
+ * @param framenum the frame number
+ * @param except the page table to pass over
+ * @return the page table, or NULL if no other page table maps the frame
+ */
+pagetable_t* frame_sharer(framenum_t framenum, const pagetable_t* except) {
+    pagetable_t* sharer = NULL;
+    for (size_t i = 0; sharer == NULL && i < nspaces; i++) {
+        pagetable_t* tbl = spaces[i].tbl;
+        if (tbl != NULL && tbl != except && frame_mapped(tbl, framenum)) {
+            sharer = tbl;
+        }
+    }
+    return sharer;
+}
+
+/**
+ * A helper function that takes one page table's mapping away from a frame shared copy-on-write,
+ * leaving its entry to the caller.  A frame is aged and replaced as the page of the page table
+ * that owns it; if that was this one, the frame passes to another page table mapping it, with the
+ * page's aging counter, and is marked dirty there, since that address space has no copy of the
+ * page in the page file.  The last mapping left is writable again.
+ * @param tbl the page table
+ * @param framenum the frame number
+ */
+void frame_unshare(pagetable_t* tbl, framenum_t framenum) {
+    fte_t* entry = &frametable->entries[framenum];
+    pagenum_t pagenum = entry->pagenum;
+    pagetable_t* heir = entry->owner == tbl ? frame_sharer(framenum, tbl) : NULL;
+    entry->refs--;
+    if (heir != NULL) {
+        pte_t pte = pte_val(tbl, pagenum);
+        if (policy->on_evict != NULL) {
+            policy->on_evict(scope_state(tbl), tbl, pagenum, framenum);
+        }
+        resident_remove(tbl, framenum);
+        entry->owner = heir;
+        pte_slot_t slot;
+        if (pte_find(heir, pagenum, &slot)) {
+            *slot.age = pte.age;
+            *slot.ref = pte.R;
+        }
+        pte_mkdirty(heir, pagenum);
+        resident_push(heir, framenum, pte.age);
+        if (policy->on_access != NULL) {
+            policy->on_access(scope_state(heir), heir, pagenum, framenum);
+        }
+    }
+    pte_slot_t slot;
+    if (entry->refs == 1 && pte_find(entry->owner, pagenum, &slot)) {
+        slot.pte->cow = 0;
+    }
+}
+
+/**
+ * A helper function that evicts a page from one of the address spaces sharing its frame
+ * copy-on-write, leaving the frame to the others.  The page is written back unless this address
+ * space owned the frame and the page is clean: the other address spaces never wrote it.
+ * @param tbl the page table
+ * @param pagenum the virtual page number
+ * @param framenum the frame holding the page
+ */
+void frame_drop(pagetable_t* tbl, pagenum_t pagenum, framenum_t framenum) {
+    mmu_stats_t* stats = &spaces[tbl->asid].stats;
+    frame_t* frame = (frame_t*)(mem_frames + ((size_t)framenum << PAGE_SHIFT));
+    bool dirty = frametable->entries[framenum].owner != tbl || pte_dirty(tbl, pagenum);
+    vmstats.evictions++;
+    stats->evictions++;
+    frame_unshare(tbl, framenum);
+    pte_clear(tbl, pagenum);
+    if (dirty) {
+        size_t spilled;
+        tier_t tier = page_write(tbl, pagenum, frame, &spilled);
+        count_write(tbl, tier, spilled, false);
+    }
+}
+
+/**
+ * A helper function that takes a resident page out of its frame's records, as the first step of
+ * evicting it: counts the eviction, tells the policy, clears the page's entry and drops the frame
+ * from the replacement candidates.  The frame stays occupied, with the page's bytes still in it.
+ * The other address spaces sharing the frame copy-on-write lose it first.
+ * @param tbl the page table
+ * @param pagenum the virtual page number
+ * @param framenum the frame holding the page
+ * @return true if the page is dirty and its bytes must be written back, else returns false
+ */
+bool page_unmap(pagetable_t* tbl, pagenum_t pagenum, framenum_t framenum) {
+    mmu_stats_t* stats = &spaces[tbl->asid].stats;
+    bool dirty = pte_dirty(tbl, pagenum);
+    const fte_t* entry = &frametable->entries[framenum];
+    pagetable_t* sharer = entry->refs > 1 ? frame_sharer(framenum, tbl) : NULL;
+    while (sharer != NULL) {
+        frame_drop(sharer, pagenum, framenum);
+        sharer = entry->refs > 1 ? frame_sharer(framenum, tbl) : NULL;
+    }
+    vmstats.evictions++;
+    stats->evictions++;
+    if (frametable->entries[framenum].prefetched) {
+        // read ahead for nothing
+        vmstats.prefetch_wasted++;
+        stats->prefetch_wasted++;
+        frametable->entries[framenum].prefetched = false;
+    }
+    if (policy->on_evict != NULL) {
+        policy->on_evict(scope_state(tbl), tbl, pagenum, framenum);
+    }
+
+    // update pte for this page (present = 0)
+    pte_clear(tbl, pagenum);
+    resident_remove(tbl, framenum);
+    return dirty;
+}
+
+void mm_page_evict(char* pagefile, pagetable_t* tbl, pagenum_t pagenum) {
+    // check if page is present
+    framenum_t framenum = pte_val(tbl, pagenum).framenum;
+    if (pte_present(tbl, pagenum) && frametable->entries[framenum].refs > 1) {
+        // the other address spaces sharing the frame keep it
+        frame_drop(tbl, pagenum, framenum);
+    }
+    else if(pte_present(tbl, pagenum)) {
+        frame_t *current_frame = get_frame(tbl, pagenum);
+
+        // if modified, write back to disk
+        if (page_unmap(tbl, pagenum, framenum)) {
+            // write page from frame to its spot in the page file
+            size_t spilled;
+            tier_t tier = page_write(tbl, pagenum, current_frame, &spilled);
+            count_write(tbl, tier, spilled, false);
+        }
+        // remove from frame
+        memset(current_frame, 0, PAGE_SIZE);
+        // mark frame as unoccupied
+        frame_release(framenum);
+    }
+}
+
+void mm_page_evict_all(char* pagefile, pagetable_t* tbl) {
+    // pages still being read ahead are not yet present, and pages being written back are held
+    prefetch_drain();
+    writeback_quiesce();
+    for (size_t i = 0; i < frametable->size; i++) {
+        const fte_t* entry = &frametable->entries[i];
+        // frames shared with another owner are mapped but not owned
+        if (entry->occupied && (entry->owner == tbl || (entry->refs > 1 && frame_mapped(tbl, i)))) {
+            mm_page_evict(pagefile, tbl, entry->pagenum);
+        }
+    }
+}
+
+/**
+ * A helper function that orders page numbers, lowest first, for qsort().
+ * @param a the first page number
+ * @param b the second page number
+ * @return a negative, zero or positive number as a is below, equal to or above b
+ */
+int pagenum_cmp(const void* a, const void* b) {
+    pagenum_t pa = *(const pagenum_t*)a;
+    pagenum_t pb = *(const pagenum_t*)b;
+    return (pa > pb) - (pa < pb);
+}
+
+/**
+ * A helper function that lists the pages of an address space held outside memory, in the
+ * compressed page cache or the page file, each once and lowest first.
+ * @param tbl the page table
+ * @param pages where to store a dynamically allocated array of the virtual page numbers, to be
+ * freed by the caller; NULL if there are none
+ * @param count where to store the number of pages listed
+ * @return true if the pages were listed, else returns false if memory could not be allocated
+ */
+bool region_pages(const pagetable_t* tbl, pagenum_t** pages, size_t* count) {
+    pagenum_t first = swap_page(tbl, 0);
+    pagenum_t* cached = NULL;
+    pagenum_t* written = NULL;
+    size_t ncached = 0;
+    size_t nwritten = 0;
+    bool success = (zcache == NULL
+                    || zcache_pages(zcache, first, PAGETABLE_SIZE, &cached, &ncached))
+                   && pagefile_pages(vmem, first, PAGETABLE_SIZE, &written, &nwritten);
+    size_t total = ncached + nwritten;
+    *pages = success && total > 0 ? malloc(total * sizeof(pagenum_t)) : NULL;
+    *count = 0;
+    success = success && (*pages != NULL || total == 0);
+    if (success && total > 0) {
+        for (size_t i = 0; i < ncached; i++) {
+            (*pages)[i] = cached[i] - first;
+        }
+        for (size_t i = 0; i < nwritten; i++) {
+            (*pages)[ncached + i] = written[i] - first;
+        }
+        qsort(*pages, total, sizeof(pagenum_t), pagenum_cmp);
+        // a page can be both cached and written
+        for (size_t i = 0; i < total; i++) {
+            if (*count == 0 || (*pages)[i] != (*pages)[*count - 1]) {
+                (*pages)[(*count)++] = (*pages)[i];
+            }
+        }
+    }
+    free(cached);
+    free(written);
+    return success;
+}
+
+/**
+ * A helper function that gives a forked address space its own copy of each page of its parent
+ * held only outside memory, in its region of the compressed page cache and the page file, once
+ * whatever an earlier address space with its ASID left there is dropped.  The bytes moved are
+ * counted, against the new address space, but no page is counted as loaded or written back.
+ * @param parent the page table of the address space forked
+ * @param child the page table of the new address space
+ * @return true if every page was copied, else returns false if memory could not be allocated
+ */
+bool fork_region(pagetable_t* parent, const pagetable_t* child) {
+    mmu_stats_t* stats = &spaces[child->asid].stats;
+    pagenum_t* pages;
+    size_t count;
+    bool success = region_pages(child, &pages, &count);
+    for (size_t i = 0; success && i < count; i++) {
+        if (zcache != NULL) {
+            zcache_drop(zcache, swap_page(child, pages[i]));
+        }
+        pagefile_discard(vmem, swap_page(child, pages[i]));
+    }
+    free(pages);
+
+    success = success && region_pages(parent, &pages, &count);
+    frame_t copy;
+    for (size_t i = 0; success && i < count; i++) {
+        // a resident page is shared instead
+        if (!pte_present(parent, pages[i])) {
+            size_t spilled;
+            tier_t from = page_read(parent, pages[i], &copy);
+            tier_t to = page_write(child, pages[i], &copy, &spilled);
+            size_t read = from == TIER_PAGEFILE ? PAGE_SIZE : 0;
+            size_t written = to == TIER_PAGEFILE ? PAGE_SIZE : 0;
+            vmstats.bytes_read += read;
+            vmstats.bytes_written += written + spilled * PAGE_SIZE;
+            vmstats.zcache_spills += spilled;
+            stats->bytes_read += read;
+            stats->bytes_written += written;
+        }
+    }
+    free(pages);
+    return success;
+}
+
+pagetable_t* pagetable_fork(pagetable_t* tbl) {
+    asid_t asid = 0;
+    while (asid < nspaces && spaces[asid].tbl != NULL) {
+        asid++;
+    }
+    return pagetable_fork_space(tbl, asid);
+}
+
+pagetable_t* pagetable_fork_space(pagetable_t* tbl, asid_t asid) {
+    // pages still being read ahead are not yet present, and pages being written back are held
+    prefetch_drain();
+    writeback_quiesce();
+    pagetable_t* child = pagetable_alloc_space(tbl->kind, asid);
+    mmu_lock();
+    bool success = child != NULL && fork_region(tbl, child);
+    // every frame the parent maps is shared with the child, read-only until either writes it
+    for (size_t i = 0; success && i < frametable->size; i++) {
+        fte_t* entry = &frametable->entries[i];
+        if (frame_mapped(tbl, i)) {
+            pte_t pte = mk_pte(i);
+            pte.present = 1;
+            pte.cow = 1;
+            set_pte(child, entry->pagenum, pte);
+            pte_slot_t slot;
+            success = frame_mapped(child, i) && pte_find(tbl, entry->pagenum, &slot);
+            if (success) {
+                slot.pte->cow = 1;
+                entry->refs++;
+                frame_untag(i);
+                vmstats.cow_shares++;
+                spaces[asid].stats.cow_shares++;
+            }
+        }
+    }
+    mmu_unlock();
+    if (child != NULL && !success) {
+        mm_page_evict_all(NULL, child);
+        pagetable_free(child);
+        child = NULL;
+    }
+    return child;
+}
+
+void mm_page_load(char* pagefile, pagetable_t* tbl, pagenum_t pagenum) {
+    // look at pte for this pgnum and figure out which pg frame
+    if (!pte_none(tbl, pagenum) || pte_present(tbl, pagenum) || tbl->kind == PAGETABLE_FLAT) {
+        frame_t* current_frame = get_frame(tbl, pagenum);
+
+        // read the page from its spot in the page file into the page frame
+        count_read(tbl, page_read(tbl, pagenum, current_frame));
+        page_mapped(tbl, pagenum);
+    }
+}
+
+/**
+ * A helper function that orders frame records by the aging counter of their pages, coldest first,
+ * for qsort().
+ * @param a the first frame record
+ * @param b the second frame record
+ * @return a negative, zero or positive number as a's page is colder than, as cold as or hotter
+ * than b's
+ */
+int image_frame_cmp(const void* a, const void* b) {
+    const image_frame_t* fa = a;
+    const image_frame_t* fb = b;
+    return (fa->age > fb->age) - (fa->age < fb->age);
+}
+
+bool mm_checkpoint(const char* path) {
+    // pages still being read ahead are not yet present, and pages being written back are held
+    prefetch_drain();
+    writeback_quiesce();
+    FILE* out = mem_frames != NULL && vmem != NULL ? fopen(path, "wb") : NULL;
+    bool success = out != NULL;
+    mmu_lock();
+    image_header_t header = {
+        .version = IMAGE_VERSION,
+        .vaddr_bits = VADDR_BITS,
+        .page_shift = PAGE_SHIFT,
+        .frames = PAGE_FRAMES,
+        .spaces = nspaces,
+        .scope = replace_scope,
+        .superpage_order = superpage_order,
+        .zcache = zcache != NULL
+    };
+    memcpy(header.magic, IMAGE_MAGIC, 4);
+    // the image holds the uses made without the lock
+    frames_fold_young();
+    accesses_fold();
+    // the page file on disk must hold every page the image leaves out
+    success = success && pagefile_sync(vmem) && image_put(out, &header, sizeof(header));
+
+    success = success && image_put(out, &vmstats, sizeof(vmstats));
+    for (size_t i = 0; success && i < nspaces; i++) {
+        success = image_put(out, &spaces[i].stats, sizeof(mmu_stats_t));
+    }
+    for (size_t i = 0; success && i < nspaces; i++) {
+        uint32_t kind = spaces[i].tbl != NULL ? spaces[i].tbl->kind : IMAGE_NO_SPACE;
+        success = image_put(out, &kind, sizeof(kind));
+    }
+
+    // the resident pages, by frame, each owner followed by the address spaces sharing its frame
+    uint64_t count = 0;
+    for (size_t i = 0; i < frametable->size; i++) {
+        count += frametable->entries[i].refs;
+    }
+    success = success && image_put(out, &count, sizeof(count));
+    for (size_t i = 0; success && i < frametable->size; i++) {
+        const fte_t* entry = &frametable->entries[i];
+        for (size_t j = 0; success && entry->occupied && j <= nspaces; j++) {
+            pagetable_t* tbl = j == 0 ? entry->owner : spaces[j - 1].tbl;
+            bool shared = j > 0;
+            if (!shared || (tbl != NULL && tbl != entry->owner && frame_mapped(tbl, i))) {
+                pte_t pte = pte_val(tbl, entry->pagenum);
+                image_frame_t rec = {i, entry->pagenum, tbl->asid, pte.age, pte.R, pte.M,
+                                     pte.huge, pte.cow, shared};
+                success = image_put(out, &rec, sizeof(rec));
+            }
+        }
+    }
+
+    // which pages have faulted before, so that their next faults are not counted as cold
+    count = fault_counts->size;
+    success = success && image_put(out, &count, sizeof(count));
+    for (size_t i = 0; success && i < fault_counts->capacity; i++) {
+        if (fault_counts->used[i]) {
+            uint64_t pair[2] = {fault_counts->keys[i], fault_counts->values[i]};
+            success = image_put(out, pair, sizeof(pair));
+        }
+    }
+
+    success = success && pagefile_save(vmem, out);
+    if (zcache != NULL) {
+        success = success && zcache_save(zcache, out);
+    }
+    for (size_t i = 0; success && i < frametable->size; i++) {
+        if (frametable->entries[i].occupied) {
+            success = image_put(out, mem_frames + (i << PAGE_SHIFT), PAGE_SIZE);
+        }
+    }
+    mmu_unlock();
+    if (out != NULL) {
+        success = fclose(out) == 0 && success;
+    }
+    return success;
+}
+
+/**
+ * A helper function that maps the pages of a restored image back into the frames they were in, as
+ * they were at the checkpoint, and hands them to the replacement policy.
+ * @param image the image, positioned at the frame records
+ * @param order log2 of the pages in a superpage when the image was taken
+ * @param recs where to store the frame records, to be freed by the caller
+ * @param count where to store the number of frame records
+ * @return true if every page was mapped, else returns false on a damaged image
+ */
+bool image_restore_frames(image_t* image, unsigned order, image_frame_t** recs, uint64_t* count) {
+    bool success = image_get(image, count, sizeof(*count)) && *count <= PAGE_FRAMES * nspaces;
+    *recs = success && *count > 0 ? malloc(*count * sizeof(image_frame_t)) : NULL;
+    success = success && (*recs != NULL || *count == 0)
+              && image_get(image, *recs, *count * sizeof(image_frame_t));
+    for (uint64_t i = 0; success && i < *count; i++) {
+        const image_frame_t* rec = &(*recs)[i];
+        pagetable_t* tbl = rec->asid < nspaces ? spaces[rec->asid].tbl : NULL;
+        fte_t* entry = rec->framenum < PAGE_FRAMES ? &frametable->entries[rec->framenum] : NULL;
+        // a sharer's record follows its owner's, with the same page
+        success = tbl != NULL && entry != NULL && rec->pagenum < PAGETABLE_SIZE
+                  && (rec->shared ? entry->occupied && entry->pagenum == rec->pagenum
+                                    && !frame_mapped(tbl, rec->framenum)
+                                  : !entry->occupied);
+        if (success) {
+            pte_t pte = mk_pte(rec->framenum);
+            pte.present = 1;
+            pte.age = rec->age;
+            pte.R = rec->R;
+            pte.M = rec->M;
+            pte.cow = rec->cow;
+            set_pte(tbl, rec->pagenum, pte);
+            // superpages of another size are left to be promoted afresh
+            pte_slot_t slot;
+            success = pte_find(tbl, rec->pagenum, &slot);
+            if (success) {
+                slot.pte->huge = rec->huge && order == superpage_order;
+            }
+            if (rec->shared) {
+                entry->refs++;
+            }
+            else {
+                frame_take(rec->framenum, tbl, rec->pagenum);
+                resident_push(tbl, rec->framenum, rec->age);
+            }
+        }
+    }
+
+    // each page is handed to the policy as if it had just faulted into a free frame, coldest first
+    if (success && *count > 0) {
+        image_frame_t* sorted = malloc(*count * sizeof(image_frame_t));
+        success = sorted != NULL;
+        if (success) {
+            memcpy(sorted, *recs, *count * sizeof(image_frame_t));
+            qsort(sorted, *count, sizeof(image_frame_t), image_frame_cmp);
+        }
+        for (uint64_t i = 0; success && i < *count; i++) {
+            pagetable_t* tbl = spaces[sorted[i].asid].tbl;
+            // the policy knows a shared frame only as its owner's page
+            bool owner = !sorted[i].shared;
+            if (owner && policy->on_fault != NULL) {
+                policy->on_fault(scope_state(tbl), tbl, sorted[i].pagenum);
+            }
+            if (owner && policy->on_access != NULL) {
+                policy->on_access(scope_state(tbl), tbl, sorted[i].pagenum, sorted[i].framenum);
+            }
+        }
+        free(sorted);
+    }
+    return success;
+}
+
+bool mm_vmem_restore(char* pagefile, const pagefile_opts_t* opts, const char* path) {
+    image_t* image = image_open(path);
+    image_header_t header;
+    bool success = image != NULL && image_get(image, &header, sizeof(header))
+                   && mem_frames != NULL && frametable->free == PAGE_FRAMES
+                   && header.vaddr_bits == VADDR_BITS && header.page_shift == PAGE_SHIFT
+                   && header.frames == PAGE_FRAMES && header.spaces == nspaces
+                   && header.scope == replace_scope;
+    for (size_t i = 0; success && i < nspaces; i++) {
+        success = spaces[i].tbl == NULL;
+    }
+    // a rejected image leaves the running page file and compressed cache as they were; an
+    // accepted one has the page file reopened in place rather than created
+    bool accepted = success;
+    size_t filesize = nspaces * PAGETABLE_SIZE * PAGE_SIZE;
+    if (accepted) {
+        mm_vmem_destroy();
+        vmem = pagefile_open(pagefile, opts, nspaces * PAGETABLE_SIZE,
+                             filesize > PAGEFILE_DIRECT_MAX);
+        success = vmem != NULL;
+    }
+
+    mmu_lock();
+    success = success && image_get(image, &vmstats, sizeof(vmstats));
+    for (size_t i = 0; success && i < nspaces; i++) {
+        success = image_get(image, &spaces[i].stats, sizeof(mmu_stats_t));
+    }
+    for (size_t i = 0; success && i < nspaces; i++) {
+        uint32_t kind;
+        success = image_get(image, &kind, sizeof(kind))
+                  && (kind == IMAGE_NO_SPACE || kind <= PAGETABLE_HASHED);
+        if (success && kind != IMAGE_NO_SPACE) {
+            success = pagetable_alloc_space((pagetable_kind_t)kind, i) != NULL;
+        }
+    }
+
+    image_frame_t* recs = NULL;
+    uint64_t count = 0;
+    success = success && image_restore_frames(image, header.superpage_order, &recs, &count);
+
+    uint64_t faulted;
+    success = success && image_get(image, &faulted, sizeof(faulted));
+    for (uint64_t i = 0; success && i < faulted; i++) {
+        uint64_t pair[2];
+        uint64_t* value = image_get(image, pair, sizeof(pair))
+                          ? pagemap_insert(fault_counts, pair[0]) : NULL;
+        success = value != NULL;
+        if (success) {
+            *value = pair[1];
+        }
+    }
+
+    success = success && pagefile_restore(vmem, image);
+    // cached pages are spilled to the page file if there is no longer room for them
+    zcache_t* cache = success && (header.zcache || zcache_budget > 0)
+                      ? zcache_alloc(zcache_budget, vmem) : NULL;
+    size_t spilled = 0;
+    success = success && (cache != NULL || (!header.zcache && zcache_budget == 0));
+    if (success && header.zcache) {
+        success = zcache_restore(cache, image, &spilled);
+        vmstats.zcache_spills += spilled;
+    }
+    if (accepted && zcache_budget > 0) {
+        zcache = cache;
+    }
+    else {
+        zcache_free(cache);
+    }
+
+    // the bytes of every resident page, in one pass over the mapped image
+    size_t frames = PAGE_FRAMES - frametable->free;
+    const uint8_t* bytes = success ? image_next(image, frames * PAGE_SIZE) : NULL;
+    success = bytes != NULL;
+    for (uint64_t i = 0, j = 0; success && i < count; i++) {
+        if (!recs[i].shared) {
+            memcpy(mem_frames + (recs[i].framenum << PAGE_SHIFT), bytes + j++ * PAGE_SIZE,
+                   PAGE_SIZE);
+        }
+    }
+    mmu_unlock();
+    free(recs);
+    image_close(image);
+    return success;
+}
+
+/**
+ * A helper function that finds a frame to read a page ahead into without disturbing the working
+ * set: the lowest free frame, else the frame of the oldest resident page if that page is clean and
+ * its aging counter has run down to zero.  Such a page is dropped from its frame; it needs no
+ * write-back.
+ * @param framenum where to store the frame number
+ * @return true if a frame was found, else returns false
+ */
+bool prefetch_frame(framenum_t* framenum) {
+    bool found = frame_find_free(framenum);
+    if (!found && frameheap_min(frametable->resident, framenum)) {
+        fte_t* entry = &frametable->entries[*framenum];
+        frame_t* frame = (frame_t*)(mem_frames + ((size_t)*framenum << PAGE_SHIFT));
+        // a page used without the MMU lock since the last tick is not cold, nor is one another
+        // space shares, nor one being copied by another thread
+        bool cold = !frame_fold_young(*framenum) && frametable->resident->age[*framenum] == 0
+                    && entry->refs == 1 && !pte_dirty(entry->owner, entry->pagenum);
+        if (cold) {
+            frame_untag(*framenum);
+        }
+        found = cold && frame_trypin(*framenum, PIN_WRITE);
+        if (found) {
+            frame_unpin(frame);
+            page_unmap(entry->owner, entry->pagenum, *framenum);
+        }
+    }
+    return found;
+}
+
+/**
+ * A helper function that reads a page ahead of its first access, unless it is already present or
+ * on its way in.  The I/O thread reads it if there is one; otherwise it is read here.
+ * @param tbl the page table
+ * @param pagenum the virtual page number
+ * @return true if the page was read ahead or needed no reading, else returns false if no frame
+ * could take it
+ */
+bool prefetch_page(pagetable_t* tbl, pagenum_t pagenum) {
+    uint64_t key = page_key(tbl, pagenum);
+    bool needed = !pte_present(tbl, pagenum)
+                  && (!threaded || pagemap_find(in_transit, key) == NULL);
+    framenum_t framenum;
+    bool success = !needed || prefetch_frame(&framenum);
+    if (needed && success) {
+        mmu_stats_t* stats = &spaces[tbl->asid].stats;
+        vmstats.prefetches++;
+        stats->prefetches++;
+        // start the page out as if just used, so that it is not the next victim
+        pte_t new_pte = mk_pte(framenum);
+        new_pte.age = PREFETCH_AGE;
+        set_pte(tbl, pagenum, new_pte);
+        frame_take(framenum, tbl, pagenum);
+
+        uint64_t* slot = prefetch_running ? pagemap_insert(in_transit, key) : NULL;
+        if (slot != NULL) {
+            // faults on the page wait for the I/O thread
+            *slot = framenum;
+            frametable->entries[framenum].prefetching = true;
+            size_t tail = (prefetch_head + prefetch_count) % PAGE_FRAMES;
+            prefetch_queue[tail] = (prefetch_t){tbl, pagenum, framenum};
+            prefetch_count++;
+            prefetch_pending++;
+            pthread_cond_signal(&prefetch_ready);
+        }
+        else {
+            frame_t* frame = (frame_t*)(mem_frames + ((size_t)framenum << PAGE_SHIFT));
+            count_read(tbl, page_read(tbl, pagenum, frame));
+            page_mapped(tbl, pagenum);
+            frametable->entries[framenum].prefetched = true;
+        }
+    }
+    return success;
+}
+
+/**
+ * The I/O thread, which reads the pages queued by prefetch_page() until mm_mem_destroy() stops it.
+ * Each page is read without the MMU lock, then made present.
+ * @param arg unused
+ * @return NULL
+ */
+void* prefetch_main(void* arg) {
+    mmu_lock();
+    while (!prefetch_stop || prefetch_count > 0) {
+        if (prefetch_count == 0) {
+            pthread_cond_wait(&prefetch_ready, &mmu_mutex);
+        }
+        else {
+            prefetch_t next = prefetch_queue[prefetch_head];
+            prefetch_head = (prefetch_head + 1) % PAGE_FRAMES;
+            prefetch_count--;
+            mmu_unlock();
+            // no fault takes a frame that is neither free nor a replacement candidate
+            frame_t* frame = (frame_t*)(mem_frames + ((size_t)next.framenum << PAGE_SHIFT));
+            tier_t tier = page_read(next.tbl, next.pagenum, frame);
+            mmu_lock();
+            count_read(next.tbl, tier);
+            pagemap_remove(in_transit, page_key(next.tbl, next.pagenum));
+            frametable->entries[next.framenum].prefetching = false;
+            page_mapped(next.tbl, next.pagenum);
+            frametable->entries[next.framenum].prefetched = true;
+            prefetch_pending--;
+            pthread_cond_broadcast(&prefetch_done);
+        }
+    }
+    mmu_unlock();
+    return arg;
+}
+
+/**
+ * A helper function that tells the readahead detector of an address space about a fault or the
+ * first use of a page read ahead, and reads ahead the pages it asks for.
+ * @param tbl the page table
+ * @param pagenum the virtual page number
+ */
+void readahead(pagetable_t* tbl, pagenum_t pagenum) {
+    pagenum_t start;
+    int64_t stride;
+    size_t count = readahead_observe(&spaces[tbl->asid].ra, pagenum, readahead_window, &start,
+                                     &stride);
+    // stop once the frames run out
+    for (size_t i = 0; i < count && prefetch_page(tbl, start + stride * (int64_t)i); i++) {
+    }
+}
+
+/**
+ * A helper function that counts the first use of a page read ahead.
+ * @param tbl the page table
+ * @param framenum the frame holding the page
+ * @return true if the page was read ahead and not used before, else returns false
+ */
+bool prefetch_hit(const pagetable_t* tbl, framenum_t framenum) {
+    fte_t* entry = &frametable->entries[framenum];
+    bool hit = entry->prefetched && entry->occupied && entry->owner == tbl;
+    if (hit) {
+        entry->prefetched = false;
+        vmstats.prefetch_hits++;
+        spaces[tbl->asid].stats.prefetch_hits++;
+    }
+    return hit;
+}
+
+/**
+ * A helper function that writes a dirty resident page back to the page file and marks it clean,
+ * leaving it in its frame.  When threaded, the MMU lock is released for the write, with the frame
+ * held exclusively so that no thread changes the page or reuses the frame meanwhile, and faults on
+ * the page wait for the write so that they do not read the page file before it.  A frame another
+ * thread is using is skipped.
+ * @param tbl the page table
+ * @param pagenum the virtual page number
+ * @param framenum the frame holding the page
+ */
+void writeback_page(pagetable_t* tbl, pagenum_t pagenum, framenum_t framenum) {
+    uint64_t key = page_key(tbl, pagenum);
+    frame_t* frame = (frame_t*)(mem_frames + ((size_t)framenum << PAGE_SHIFT));
+    uint64_t* slot = NULL;
+    bool held = frame_trypin(framenum, PIN_WRITE);
+    if (held && threaded) {
+        slot = pagemap_insert(in_transit, key);
+        if (slot != NULL) {
+            *slot = framenum;
+        }
+        else {
+            frame_unpin(frame);
+        }
+    }
+    if (held && (!threaded || slot != NULL)) {
+        // a write to the page after this one makes it dirty again
+        pte_mkclean(tbl, pagenum);
+        mmu_unlock();
+        size_t spilled;
+        tier_t tier = page_write(tbl, pagenum, frame, &spilled);
+        mmu_lock();
+        count_write(tbl, tier, spilled, true);
+        if (threaded) {
+            pagemap_remove(in_transit, key);
+        }
+        frame_unpin(frame);
+    }
+}
+
+/**
+ * A helper function that moves the flusher's hand over the given number of frames, writing back
+ * each dirty page it passes while more than target pages are dirty, and each dirty page whose
+ * aging counter has fallen to the age cutoff.  Like a clock hand, it passes over pages referenced
+ * since the last tick unless they are that old, since they are likely to be written again.
+ * @param target the most dirty pages to leave
+ * @param frames the number of frames to look at
+ */
+void writeback_sweep(size_t target, size_t frames) {
+    for (size_t i = 0; i < frames && i < frametable->size; i++) {
+        framenum_t framenum = writeback_hand;
+        writeback_hand = (writeback_hand + 1) % frametable->size;
+        fte_t* entry = &frametable->entries[framenum];
+        pte_slot_t slot;
+        frame_fold_young(framenum);
+        if (entry->occupied && pte_find(entry->owner, entry->pagenum, &slot)
+            && slot.pte->present && slot.pte->M && slot.pte->framenum == framenum
+            && ((dirty_frames > target && !*slot.ref) || *slot.age <= writeback_opts.age_cutoff)) {
+            writeback_page(entry->owner, entry->pagenum, framenum);
+        }
+    }
+}
+
+/**
+ * The flusher thread, which sweeps every frame once each time it is asked to, until
+ * mm_mem_destroy() stops it.
+ * @param arg unused
+ * @return NULL
+ */
+void* writeback_main(void* arg) {
+    mmu_lock();
+    while (!writeback_stop) {
+        if (!writeback_wanted) {
+            pthread_cond_wait(&writeback_wake, &mmu_mutex);
+        }
+        else {
+            writeback_wanted = false;
+            writeback_active = true;
+            writeback_sweep(PAGE_FRAMES * writeback_opts.background_ratio / 100, PAGE_FRAMES);
+            writeback_active = false;
+            pthread_cond_broadcast(&writeback_idle);
+        }
+    }
+    mmu_unlock();
+    return arg;
+}
+
+/**
+ * A helper function that chooses the address space to give up a frame for a fault.  Under
+ * SCOPE_LOCAL each address space is entitled to an equal share of the frames: one holding at least
+ * its share replaces its own pages, and one holding less takes a page from the address space
+ * holding the most frames.  Under SCOPE_GLOBAL the one policy chooses among every page.
+ * @param tbl the page table of the faulting address space
+ * @return the page table of the address space to give up a frame
+ */
+pagetable_t* replace_donor(pagetable_t* tbl) {
+    pagetable_t* donor = tbl;
+    if (replace_scope == SCOPE_LOCAL) {
+        size_t active = 0;
+        asid_t largest = tbl->asid;
+        for (asid_t asid = 0; asid < nspaces; asid++) {
+            if (spaces[asid].tbl != NULL) {
+                active++;
+                if (spaces[asid].resident->size > spaces[largest].resident->size) {
+                    largest = asid;
+                }
+            }
+        }
+        if (spaces[tbl->asid].resident->size < PAGE_FRAMES / active) {
+            donor = spaces[largest].tbl;
+        }
+    }
+    return donor;
+}
+
+/**
+ * A helper function that chooses the resident page to be replaced by the replacement policy.
+ * The victim may belong to another address space unless replacement is local and the faulting
+ * address space holds its share of the frames.
+ * @param tbl the page table of the faulting address space
+ * @param pagenum the page number of the page to be brought in
+ * @param framenum where to store the frame of the victim
+ * @return true if a victim was found, else returns false if no frame is a candidate
+ */
+bool page_victim(pagetable_t* tbl, pagenum_t pagenum, framenum_t* framenum) {
+    // should the chosen address space have no page to give up, take the oldest page of any
+    pagetable_t* donor = replace_donor(tbl);
+    bool found = policy->victim(scope_state(donor), donor, pagenum, framenum)
+        || (replace_scope == SCOPE_LOCAL && frameheap_min(frametable->resident, framenum));
+    return found && frametable->entries[*framenum].occupied;
+}
+
+/**
+ * A helper function that finds the free frame a page would take in its superpage, going by the
+ * frame of the nearest present page of the same superpage, so that the superpage can be promoted
+ * once all of its pages are present.
+ * @param tbl the page table
+ * @param pagenum the virtual page number
+ * @param framenum where to store the frame number
+ * @return true if that frame is free, else returns false
+ */
+bool frame_find_near(const pagetable_t* tbl, pagenum_t pagenum, framenum_t* framenum) {
+    size_t pages = (size_t)1 << superpage_order;
+    pagenum_t first = pagenum & ~(pagenum_t)(pages - 1);
+    pte_slot_t slot;
+    bool seen = false;
+    bool found = false;
+    // nearest first, since the pages of a run tend to be touched in order
+    for (size_t i = 1; !seen && i < pages; i++) {
+        pagenum_t near = pagenum - i;
+        seen = pagenum >= first + i && pte_find(tbl, near, &slot) && slot.pte->present;
+        if (!seen) {
+            near = pagenum + i;
+            seen = near < first + pages && pte_find(tbl, near, &slot) && slot.pte->present;
+        }
+        if (seen) {
+            int64_t frame = (int64_t)slot.pte->framenum + (int64_t)pagenum - (int64_t)near;
+            found = frame >= 0 && (size_t)frame < frametable->size
+                    && !frametable->entries[frame].occupied;
+            *framenum = (framenum_t)frame;
+        }
+    }
+    return found;
+}
+
+/**
+ * A helper function that brings in every page of the superpage holding a page at once, when none
+ * of them is present or on its way in and a naturally aligned run of frames is free, and maps
+ * them as a superpage.  When threaded, the MMU lock is released while the bytes move, with the
+ * frames held exclusively.
+ * @param tbl the page table
+ * @param pagenum the virtual page number
+ * @return true if the superpage was brought in, else returns false if the page must be brought in
+ * on its own
+ */
+bool superpage_fault(pagetable_t* tbl, pagenum_t pagenum) {
+    size_t pages = (size_t)1 << superpage_order;
+    pagenum_t first = pagenum & ~(pagenum_t)(pages - 1);
+    bool whole = first + pages <= PAGETABLE_SIZE;
+    for (size_t i = 0; whole && i < pages; i++) {
+        whole = !pte_present(tbl, first + i)
+                && (!threaded || pagemap_find(in_transit, page_key(tbl, first + i)) == NULL);
+    }
+    framenum_t base;
+    whole = whole && frame_find_run(pages, &base);
+
+    if (whole) {
+        // faults on any of the pages wait for all of them
+        bool unlocked = threaded;
+        for (size_t i = 0; unlocked && i < pages; i++) {
+            uint64_t* slot = pagemap_insert(in_transit, page_key(tbl, first + i));
+            unlocked = slot != NULL;
+            if (unlocked) {
+                *slot = base + i;
+            }
+        }
+        for (size_t i = 0; threaded && !unlocked && i < pages; i++) {
+            pagemap_remove(in_transit, page_key(tbl, first + i));
+        }
+        bool held[1 << SUPERPAGE_ORDER_MAX];
+        for (size_t i = 0; i < pages; i++) {
+            set_pte(tbl, first + i, mk_pte(base + i));
+            frame_take(base + i, tbl, first + i);
+            held[i] = unlocked && pthread_rwlock_trywrlock(&frametable->locks[base + i]) == 0;
+        }
+        if (unlocked) {
+            mmu_unlock();
+        }
+
+        // how many pages came from each tier
+        size_t tiers[TIER_PAGEFILE + 1] = {0};
+        for (size_t i = 0; i < pages; i++) {
+            if (unlocked && !held[i]) {
+                // a thread still copying out of the frame's last page is waited for unlocked
+                pthread_rwlock_wrlock(&frametable->locks[base + i]);
+            }
+            frame_t* frame = (frame_t*)(mem_frames + ((size_t)(base + i) << PAGE_SHIFT));
+            tiers[page_read(tbl, first + i, frame)]++;
+        }
+
+        if (unlocked) {
+            mmu_lock();
+            for (size_t i = 0; i < pages; i++) {
+                pthread_rwlock_unlock(&frametable->locks[base + i]);
+                pagemap_remove(in_transit, page_key(tbl, first + i));
+            }
+        }
+        for (int tier = TIER_ZERO; tier <= TIER_PAGEFILE; tier++) {
+            for (size_t i = 0; i < tiers[tier]; i++) {
+                count_read(tbl, (tier_t)tier);
+            }
+        }
+        // the last page mapped completes the superpage
+        for (size_t i = 0; i < pages; i++) {
+            page_mapped(tbl, first + i);
+        }
+        vmstats.superpage_faults++;
+        spaces[tbl->asid].stats.superpage_faults++;
+    }
+    return whole;
+}
+
+/**
+ * A helper function that brings a page that is not present into a frame.  With superpages, the
+ * whole superpage holding it is brought in if it can be, and else the page goes next to the pages
+ * of its superpage that are present if their neighbouring frame is free.  Otherwise it goes in the
+ * frame it was mapped to ahead of time if that frame is free, else the lowest free frame, else the
+ * frame of a victim
+ * chosen by the replacement policy, which is evicted.  When threaded, the MMU lock is released
+ * while the bytes move, with the frame held exclusively; other threads faulting on the page or on
+ * its victim meanwhile wait for the transfer rather than repeat it.  Given a copy of the page, a
+ * page present in a frame it shares copy-on-write is moved to a frame of its own holding the copy.
+ * @param pagefile the page file
+ * @param tbl the page table
+ * @param pagenum the virtual page number
+ * @param counted true if the fault was counted by an earlier try of the same access; set once
+ * it has been
+ * @param copy the bytes to fill the frame with instead of reading the page, or NULL to read it
+ * @return true if the page was brought in, else returns false if the access must be tried again
+ * after waiting for another thread
+ */
+bool page_fault(char* pagefile, pagetable_t* tbl, pagenum_t pagenum, bool* counted,
+                const frame_t* copy) {
+    uint64_t key = page_key(tbl, pagenum);
+    const uint64_t* moving = threaded ? pagemap_find(in_transit, key) : NULL;
+    bool loaded = false;
+    if (moving != NULL && frametable->entries[*moving].prefetching) {
+        // the I/O thread is reading the page ahead
+        pthread_cond_wait(&prefetch_done, &mmu_mutex);
+    }
+    else if (moving != NULL) {
+        frame_wait(*moving);
+    }
+    else {
+        framenum_t framenum;
+        pagetable_t* victim_tbl = NULL;
+        pagenum_t victim_page = 0;
+        bool dirty = false;
+        if (!*counted) {
+            count_fault(tbl, pagenum);
+            if (policy->on_fault != NULL) {
+                policy->on_fault(scope_state(tbl), tbl, pagenum);
+            }
+            *counted = true;
+        }
+
+        loaded = copy == NULL && superpage_order > 0 && superpage_fault(tbl, pagenum);
+        // a page mapped ahead of time keeps its frame if that frame is free
+        bool found = !loaded && !pte_none(tbl, pagenum)
+                     && !frametable->entries[pte_val(tbl, pagenum).framenum].occupied;
+        if (found) {
+            framenum = pte_val(tbl, pagenum).framenum;
+        }
+        // else take a frame next to the page's superpage, the lowest free frame, or replace a page
+        else if (!loaded) {
+            found = (superpage_order > 0 && frame_find_near(tbl, pagenum, &framenum))
+                    || frame_find_free(&framenum);
+            if (!found && page_victim(tbl, pagenum, &framenum)) {
+                victim_tbl = frametable->entries[framenum].owner;
+                victim_page = frametable->entries[framenum].pagenum;
+                dirty = page_unmap(victim_tbl, victim_page, framenum);
+                found = true;
+            }
+            // a page copied on write leaves the frame it shared, unless that was the victim
+            if (found && copy != NULL && pte_present(tbl, pagenum)) {
+                frame_unshare(tbl, pte_val(tbl, pagenum).framenum);
+            }
+            if (found) {
+                // update mapping for requested pg
+                pte_t new_pte = mk_pte(framenum);
+                set_pte(tbl, pagenum, new_pte);
+            }
+        }
+
+        if (found) {
+            frame_t* frame = (frame_t*)(mem_frames + ((size_t)framenum << PAGE_SHIFT));
+            uint64_t victim_key = dirty ? page_key(victim_tbl, victim_page) : key;
+            uint64_t* slot = threaded ? pagemap_insert(in_transit, key) : NULL;
+            uint64_t* victim_slot = slot != NULL ? pagemap_insert(in_transit, victim_key) : NULL;
+            // no other fault takes the frame now, so the bytes can move without the MMU lock
+            frame_take(framenum, tbl, pagenum);
+            bool unlocked = victim_slot != NULL;
+            if (unlocked) {
+                *pagemap_find(in_transit, key) = framenum;
+                *victim_slot = framenum;
+                // a thread still copying out of the victim's frame is waited for unlocked
+                bool held = pthread_rwlock_trywrlock(&frametable->locks[framenum]) == 0;
+                mmu_unlock();
+                if (!held) {
+                    pthread_rwlock_wrlock(&frametable->locks[framenum]);
+                }
+            }
+            tier_t victim_tier = TIER_ZERO;
+            size_t spilled = 0;
+            if (dirty) {
+                // write page from frame to its spot in the page file
+                victim_tier = page_write(victim_tbl, victim_page, frame, &spilled);
+            }
+            // read the page from its spot in the page file into the page frame, which overwrites
+            // every byte of the victim
+            tier_t tier = TIER_ZERO;
+            if (copy != NULL) {
+                memcpy(frame, copy, PAGE_SIZE);
+            }
+            else {
+                tier = page_read(tbl, pagenum, frame);
+            }
+            if (unlocked) {
+                mmu_lock();
+                pthread_rwlock_unlock(&frametable->locks[framenum]);
+            }
+            if (dirty) {
+                count_write(victim_tbl, victim_tier, spilled, false);
+            }
+            if (copy == NULL) {
+                count_read(tbl, tier);
+            }
+            if (threaded) {
+                pagemap_remove(in_transit, key);
+                pagemap_remove(in_transit, victim_key);
+            }
+            page_mapped(tbl, pagenum);
+            loaded = true;
+        }
+        else if (threaded && !loaded) {
+            // every frame is being transferred; let those transfers finish
+            mmu_unlock();
+            sched_yield();
+            mmu_lock();
+        }
+    }
+    return loaded;
+}
+
+/**
+ * A helper function that gives a page its own frame on the first write to it through an entry
+ * sharing its frame copy-on-write: the page is copied aside and moved to a frame found as for a
+ * fault, which the copy is put in.  The fault itself is not counted, as the page was present.
+ * @param pagefile the page file
+ * @param tbl the page table
+ * @param pagenum the virtual page number
+ * @param framenum the shared frame
+ * @return true if the page was copied, else returns false if the write must be tried again after
+ * waiting for another thread
+ */
+bool cow_fault(char* pagefile, pagetable_t* tbl, pagenum_t pagenum, framenum_t framenum) {
+    frame_t copy;
+    bool counted = true;
+    memcpy(&copy, mem_frames + ((size_t)framenum << PAGE_SHIFT), PAGE_SIZE);
+    bool copied = page_fault(pagefile, tbl, pagenum, &counted, &copy);
+    if (copied) {
+        vmstats.cow_copies++;
+        spaces[tbl->asid].stats.cow_copies++;
+    }
+    return copied;
+}
+
+/**
+ * A helper function that lets this thread's later accesses to a page it has pinned skip the MMU
+ * lock, when threaded under a policy that keeps no order of use: the page's frame is tagged with
+ * it, and remembered.  Only a page alone in its frame, present and not read ahead unused is
+ * tagged, and writable only once dirty, so that an access without the lock changes nothing but
+ * the page's R bit and the access counters.
+ * @param tbl the page table
+ * @param pagenum the virtual page number
+ * @param framenum the frame holding the page
+ */
+void frame_publish(pagetable_t* tbl, pagenum_t pagenum, framenum_t framenum) {
+    const fte_t* entry = &frametable->entries[framenum];
+    pte_slot_t slot;
+    if (frametable->tags != NULL && policy->on_access == NULL && entry->refs == 1
+        && entry->owner == tbl && !entry->prefetched && pte_find(tbl, pagenum, &slot)
+        && slot.pte->present && !slot.pte->cow && slot.pte->framenum == framenum) {
+        uint64_t key = page_key(tbl, pagenum);
+        __atomic_store_n(&frametable->tags[framenum], frame_tag(key, slot.pte->M),
+                         __ATOMIC_SEQ_CST);
+        frame_hints[(key ^ key >> ASID_SHIFT) % HINT_SLOTS] = framenum;
+    }
+}
+
+/**
+ * A helper function that checks that a frame may be used for a page without the MMU lock.
+ * @param framenum the frame number
+ * @param key the page key of the page
+ * @param pin how the frame is to be held
+ * @return true if the frame is tagged with the page, writable if it is to be written, else returns
+ * false
+ */
+bool frame_tagged(framenum_t framenum, uint64_t key, pin_t pin) {
+    uint64_t tag = __atomic_load_n(&frametable->tags[framenum], __ATOMIC_SEQ_CST);
+    return pin == PIN_WRITE ? tag == frame_tag(key, true) : (tag | 1) == frame_tag(key, true);
+}
+
+/**
+ * A helper function that makes an access without the MMU lock, when threaded, if this thread last
+ * pinned the page in a frame still tagged with it by frame_publish().  The frame is pinned, then
+ * its tag checked again: whatever clears the tag before the page leaves the frame either sees the
+ * pin and waits for it, or is seen here.  The access is counted in this thread's row of counters
+ * and the page marked young in the frame table, both folded in later under the lock.  Nothing in
+ * the page's TLB is looked up or counted.
+ * @param tbl the page table
+ * @param pagenum the virtual page number
+ * @param pin how the frame is to be held
+ * @return a pointer to the page frame, pinned, or NULL if the access must take the MMU lock
+ */
+frame_t* page_access_fast(const pagetable_t* tbl, pagenum_t pagenum, pin_t pin) {
+    frame_t* frame = NULL;
+    uint64_t key = page_key(tbl, pagenum);
+    framenum_t framenum = frame_hints[(key ^ key >> ASID_SHIFT) % HINT_SLOTS];
+    if (pin != PIN_NONE && framenum < frametable->size && frame_tagged(framenum, key, pin)
+        && frame_trypin(framenum, pin)) {
+        frame = (frame_t*)(mem_frames + ((size_t)framenum << PAGE_SHIFT));
+        if (!frame_tagged(framenum, key, pin)) {
+            // the page left the frame, or stopped being writable, before it was pinned
+            frame_unpin(frame);
+            frame = NULL;
+        }
+    }
+    if (frame != NULL) {
+        if (!__atomic_load_n(&frametable->young[framenum], __ATOMIC_RELAXED)) {
+            __atomic_store_n(&frametable->young[framenum], 1, __ATOMIC_RELAXED);
+        }
+        if (fast_row == HIT_ROWS) {
+            fast_row = __atomic_fetch_add(&fast_rows, 1, __ATOMIC_RELAXED) % HIT_ROWS;
+        }
+        __atomic_fetch_add(&fast_accesses[fast_row][tbl->asid], 1, __ATOMIC_RELAXED);
+    }
+    return frame;
+}
+
+/**
+ * A helper function that finds the frame holding a page, faulting the page in if it is not
+ * present, and records the access.  When threaded, the frame can be pinned until frame_unpin(),
+ * so that no fault reuses it while its bytes are copied; a page pinned for writing is marked
+ * dirty, once it has a frame of its own if its frame was shared copy-on-write.  A pinned access
+ * is first tried without the MMU lock, by page_access_fast().
+ * @param pagefile the page file
+ * @param tbl the page table
+ * @param pagenum the virtual page number
+ * @param pin how the frame is to be held
+ * @return a pointer to the page frame containing the page
+ */
+frame_t* page_access(char* pagefile, pagetable_t* tbl, pagenum_t pagenum, pin_t pin) {
+    // a page this thread pinned before may still be in the same frame
+    frame_t* frame = threaded && policy->on_access == NULL
+                     ? page_access_fast(tbl, pagenum, pin) : NULL;
+    bool locked = frame == NULL;
+    bool counted = false;
+    bool recorded = false;
+    if (locked) {
+        mmu_lock();
+        vmstats.accesses++;
+        spaces[tbl->asid].stats.accesses++;
+        // past the dirty limit, a writer cleans pages before it dirties another
+        size_t limit = PAGE_FRAMES * writeback_opts.ratio / 100;
+        if (pin == PIN_WRITE && writeback_on && limit > 0 && dirty_frames >= limit) {
+            writeback_sweep(limit - 1, PAGE_FRAMES);
+        }
+    }
+    while (frame == NULL) {
+        framenum_t framenum;
+        bool found = true;
+        bool loaded = false;
+
+        // a TLB hit means the page is present; skip the walk
+        if (!tlb_lookup(tbl->tlb, page_key(tbl, pagenum), &framenum)) {
+            // if page not present in memory
+            if (!pte_present(tbl, pagenum)) {
+                loaded = page_fault(pagefile, tbl, pagenum, &counted, NULL);
+                found = loaded || !threaded;
+            }
+            // cache the translation
+            pte_t pte = pte_val(tbl, pagenum);
+            framenum = pte.framenum;
+            if (found && pte.present) {
+                tlb_cache(tbl, pagenum, pte);
+            }
+        }
+        // the first write through an entry sharing its frame copies the page, then tries again
+        if (found && pin == PIN_WRITE && frametable->entries[framenum].refs > 1) {
+            cow_fault(pagefile, tbl, pagenum, framenum);
+            found = false;
+        }
+        if (found && (!recorded || loaded)) {
+            // a shared frame is aged as its owner's page
+            const fte_t* entry = &frametable->entries[framenum];
+            pagetable_t* holder = entry->refs > 1 ? entry->owner : tbl;
+            // update R bit
+            pte_mkyoung(holder, pagenum);
+            if (policy->on_access != NULL && pte_present(holder, pagenum)) {
+                policy->on_access(scope_state(holder), holder, pagenum, framenum);
+            }
+            recorded = true;
+            // a fault, or the first use of a page read ahead, moves a stream along
+            if (readahead_window > 0 && (loaded || prefetch_hit(tbl, framenum))) {
+                readahead(tbl, pagenum);
+            }
+        }
+        if (found && frame_trypin(framenum, pin)) {
+            frame = (frame_t*)(mem_frames + ((size_t)framenum << PAGE_SHIFT));
+            if (pin == PIN_WRITE) {
+                pte_mkdirty(tbl, pagenum);
+            }
+            if (pin != PIN_NONE) {
+                frame_publish(tbl, pagenum, framenum);
+            }
+        }
+        else if (found) {
+            // another thread is using the frame; it may no longer hold the page afterwards
+            frame_wait(framenum);
+        }
+    }
+    if (locked) {
+        mmu_unlock();
+    }
     // return ptr to corresponding pg frame in pseudo-physical mem buffer
-    return get_frame(tbl, pagenum);
+    return frame;
+}
+
+frame_t* pte_page(char* pagefile, pagetable_t* tbl, pagenum_t pagenum) {
+    return page_access(pagefile, tbl, pagenum, PIN_NONE);
+}
+
+/**
+ * A helper function that copies a run of bytes to or from virtual memory, one page at a time.
+ * Exactly one of src and dst is used, unless both are NULL, in which case the run is filled with
+ * val.
+ * @param pagefile the page file
+ * @param tbl the page table
+ * @param vaddr the virtual address of the first byte
+ * @param dst the buffer to read into, or NULL when writing
+ * @param src the bytes to be written, or NULL when reading or filling
+ * @param val the fill value
+ * @param nbytes the number of bytes
+ * @return the number of bytes copied
+ */
+static size_t mmu_span(char* pagefile, pagetable_t* tbl, vaddr_t vaddr, uint8_t* dst,
+                       const uint8_t* src, uint8_t val, size_t nbytes) {
+    size_t done = 0;
+    size_t page_index = vaddr.pagenum;
+    size_t offset = vaddr.offset;
+    // stop at the end of the virtual address space rather than wrap
+    while (done < nbytes && page_index < PAGETABLE_SIZE) {
+        size_t chunk = PAGE_SIZE - offset;
+        if (chunk > nbytes - done) {
+            chunk = nbytes - done;
+        }
+        // one translation per page, holding the frame while its bytes are copied
+        frame_t* frame = page_access(pagefile, tbl, page_index, dst != NULL ? PIN_READ : PIN_WRITE);
+        if (dst != NULL) {
+            memcpy(dst + done, &frame->bytes[offset], chunk);
+        }
+        else if (src != NULL) {
+            memcpy(&frame->bytes[offset], src + done, chunk);
+        }
+        else {
+            memset(&frame->bytes[offset], val, chunk);
+        }
+        frame_unpin(frame);
+        done += chunk;
+        page_index++;
+        offset = 0;
+    }
+    return done;
+}
+
+size_t mmu_read_span(char* pagefile, pagetable_t* tbl, vaddr_t vaddr, uint8_t* buf,
+                     size_t nbytes) {
+    return mmu_span(pagefile, tbl, vaddr, buf, NULL, 0, nbytes);
+}
+
+size_t mmu_write_span(char* pagefile, pagetable_t* tbl, vaddr_t vaddr, const uint8_t* buf,
+                      size_t nbytes) {
+    return mmu_span(pagefile, tbl, vaddr, NULL, buf, 0, nbytes);
+}
+
+size_t mmu_fill_span(char* pagefile, pagetable_t* tbl, vaddr_t vaddr, uint8_t val,
+                     size_t nbytes) {
+    return mmu_span(pagefile, tbl, vaddr, NULL, NULL, val, nbytes);
 }
@@ -2,12 +2,74 @@
  * @file mmu.h
  * @brief Function prototypes and type definitions for the MMU.
  *
- * The MMU translates 20-bit virtual addresses to 16-bit physical addresses,
- * and maps 8-bit virtual page numbers to 4-bit physical page frame numbers.
- * This yields a page table with 2^8 page table entries, one per virtual page,
- * mapping to 2^4 page frames in physical memory.  Each page is 2^12 bytes,
- * with each byte within a page addressable via the offset specified in the
- * virtual or physical address.
+ * The MMU translates virtual addresses to physical addresses, mapping virtual
+ * page numbers to physical page frame numbers, with each byte within a page
+ * addressable via the offset specified in the virtual or physical address.
+ * By default virtual addresses are 20 bits, pages are 2^12 bytes and there
+ * are 2^4 page frames, which yields a page table with 2^8 entries.  The
+ * geometry can be changed at startup with mm_geometry_init(), up to 48-bit
+ * virtual addresses, pages of 4 KB to 64 KB and 2^32 page frames.
+ *
+ * Up to ASID_MAX address spaces, one per page table, can share the frames.
+ * Each page table is given an address space identifier (ASID) when it is
+ * allocated.  The TLB, the replacement policies and the page file tell pages
+ * of different address spaces apart by it, so switching between address
+ * spaces needs no flush.
+ *
+ * After mm_threads_init(), several threads can access memory at once through
+ * pte_page() and the mmu_*_span() functions, and tick with pagetable_age().
+ * Page table, frame table, policy and counter updates are serialized by one
+ * MMU lock, but page file transfers and the copies of the span functions run
+ * outside it, holding only the lock of the frame involved.  A page that one
+ * thread is loading or writing back is waited for by the others rather than
+ * transferred twice.  The other functions must not run while threads are
+ * accessing memory.
+ *
+ * Under the aging policy, which keeps no order of use, a span function's access
+ * to a page the same thread found before in a frame that still holds it takes no
+ * MMU lock: the frame is pinned, the page's R bit is left to the frame table
+ * until the next tick or victim choice, and the access is counted per thread
+ * until the counters are read.  The TLB neither sees nor counts these accesses.
+ * A page is written this way only once it is dirty.  The other policies order
+ * pages on every access, so their accesses all take the lock.
+ *
+ * After mm_readahead_init(), a fault that continues a sequential or strided run of faults reads
+ * the next pages of the run ahead of time, into free frames or frames whose pages have gone cold.
+ * When threaded, the pages can be read by a background I/O thread instead of the faulting one.
+ *
+ * A page the page file holds only zeros for, because it was never written back or was last
+ * evicted all zeros, is loaded by zeroing its frame without reading the page file, and a dirty
+ * page that is all zeros is not written back.
+ *
+ * After mm_zcache_init(), dirty pages are written back into a compressed page cache held in
+ * memory, and pages are loaded from it when it has them.  Only the pages it spills to stay within
+ * its budget, and pages that do not compress, go to the page file.
+ *
+ * After mm_writeback_init(), dirty resident pages are written back to the page file before they
+ * are chosen as victims, so that most evictions drop clean pages and a fault only waits for its
+ * own read.
+ *
+ * After mm_superpages_init(), naturally aligned runs of pages held in naturally aligned runs of
+ * frames are mapped as superpages, with the page-size bit set in each page's entry and one TLB
+ * entry covering the run.  A fault brings in the whole run at once when none of it is present and
+ * enough aligned frames are free, and otherwise places the page next to the rest of its run, so
+ * that the run is promoted once its last page comes in.  Evicting or remapping any page of a
+ * superpage demotes it back to single pages.
+ *
+ * A run can be checkpointed with mm_checkpoint() and resumed later with mm_vmem_restore(), which
+ * reuses the page file in place and reloads the resident pages from the image instead of faulting
+ * the working set back in.
+ *
+ * pagetable_fork() duplicates an address space without copying its resident pages: the entries
+ * of both address spaces map the same frames, marked copy-on-write, and the frame table counts
+ * the entries mapping each frame.  The first write to a shared page through either entry copies
+ * it into a frame of its own, so a fork only ever costs the pages written after it.
+ *
+ * Building with MMU_VADDR_BITS, MMU_PAGE_SHIFT and MMU_FRAMES all defined
+ * fixes the geometry at compile time: PAGE_SIZE and friends become constants,
+ * so address splitting and frame addressing compile to immediate shifts and
+ * masks, and mm_geometry_init() accepts only that geometry.  For example,
+ * -DMMU_VADDR_BITS=20 -DMMU_PAGE_SHIFT=12 -DMMU_FRAMES=16 is the default one.
  *
  * @note MMU functions are loosely based on page table management functions
  * in the Linux kernel, described here:
@@ -23,86 +85,455 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include "mmu_pagemap.h"
 
-#define PAGETABLE_SIZE  (1UL << 8)
-#define PAGE_SIZE       (1UL << 12)
-#define PAGE_FRAMES     (1UL << 4)
+#define VADDR_BITS_MAX  48    /* widest virtual address */
+#define PAGE_SHIFT_MIN  12    /* smallest page, 4 KB */
+#define PAGE_SHIFT_MAX  16    /* largest page, 64 KB */
 
+/**
+ * @struct mmu_geometry_t
+ * @brief The shape of the simulated machine.
+ * @see mm_geometry_init().
+ */
+typedef struct {
+    unsigned vaddr_bits;    /**< bits in a virtual address */
+    unsigned page_shift;    /**< log2 of the page size */
+    size_t frames;          /**< number of physical page frames */
+    size_t pages;           /**< number of virtual pages, derived from the above */
+} mmu_geometry_t;
+
+/* the current geometry; set by mm_geometry_init() */
+extern mmu_geometry_t mmu_geom;
+
+#if defined(MMU_VADDR_BITS) && defined(MMU_PAGE_SHIFT) && defined(MMU_FRAMES)
+#define MMU_FIXED_GEOMETRY
+#define VADDR_BITS      ((unsigned)MMU_VADDR_BITS)
+#define PAGE_SHIFT      ((unsigned)MMU_PAGE_SHIFT)
+#define PAGE_FRAMES     ((size_t)MMU_FRAMES)
+#define PAGETABLE_SIZE  ((size_t)1 << (MMU_VADDR_BITS - MMU_PAGE_SHIFT))
+#else
+#define VADDR_BITS      (mmu_geom.vaddr_bits)
+#define PAGE_SHIFT      (mmu_geom.page_shift)
+#define PAGE_FRAMES     (mmu_geom.frames)
+#define PAGETABLE_SIZE  (mmu_geom.pages)
+#endif
+#define PAGE_SIZE       ((size_t)1 << PAGE_SHIFT)
+
+#define RADIX_BITS          9                       /* page number bits per radix level */
+#define RADIX_FANOUT        (1UL << RADIX_BITS)     /* entries per radix level */
+#define PAGETABLE_FLAT_MAX  (1UL << 20)             /* most pages pagetable_alloc() keeps flat */
+#define SUPERPAGE_ORDER_MAX RADIX_BITS              /* largest superpage, a radix leaf of pages */
+
+#define ASID_MAX    256    /* most address spaces sharing the frames */
+#define ASID_SHIFT  48     /* position of the ASID in a page key; above any page number */
+
+/** A page number type. */
+typedef uint64_t pagenum_t;
+
+/** A frame number type. */
+typedef uint32_t framenum_t;
+
+/** An address space identifier type. */
+typedef uint16_t asid_t;
 
 /**
  * @struct vaddr_t
- * @brief A 20-bit virtual address type.
+ * @brief A virtual address type, split into page number and offset.
+ * @see mk_vaddr(), vaddr_value().
  */
 typedef struct {
-    union {
-        uint32_t value;                /* allows access to all bits at once */
-        struct {
-            uint32_t offset     : 12;  /**< offset within the page */
-            uint32_t pagenum    : 8;   /**< virtual page number */
-            uint32_t            : 12;  /* unused */
-        };
-    };
+    pagenum_t pagenum;    /**< virtual page number */
+    uint32_t offset;      /**< offset within the page */
 } vaddr_t;
 
 /**
  * @struct addr_t
- * @brief A 16-bit physical address type.
+ * @brief A physical address type, split into frame number and offset.
  */
 typedef struct {
-    union {
-        uint32_t value;                /* allows access to all bits at once */
-        struct {
-            uint32_t offset     : 12;  /**< offset within the frame */
-            uint32_t framenum   : 4;   /**< physical page frame number */
-            uint32_t            : 16;  /* unused */
-        };
-    };
+    framenum_t framenum;  /**< physical page frame number */
+    uint32_t offset;      /**< offset within the frame */
 } addr_t;
 
 /**
  * @struct pte_t
- * @brief A 16-bit page table entry type.
+ * @brief A page table entry type.
+ *
+ * A page table keeps the aging counters and R bits of its entries in separate byte arrays, so
+ * that an aging tick is one pass over contiguous memory; the age and R fields of an entry are
+ * filled in by pte_val() and stored by set_pte().
  */
 typedef struct {
-    uint16_t age         : 8;  /**< aging counter */
-    uint16_t R           : 1;  /**< referenced bit */
-    uint16_t M           : 1;  /**< modified bit */
-    uint16_t set         : 1;  /**< set bit (valid bit) */
-    uint16_t present     : 1;  /**< present/absent bit (1 if page is in a frame) */
-    uint16_t framenum    : 4;  /**< physical page frame number */
+    framenum_t framenum;       /**< physical page frame number */
+    uint8_t age;               /**< aging counter */
+    uint8_t R           : 1;   /**< referenced bit */
+    uint8_t M           : 1;   /**< modified bit */
+    uint8_t set         : 1;   /**< set bit (valid bit) */
+    uint8_t present     : 1;   /**< present/absent bit (1 if page is in a frame) */
+    uint8_t huge        : 1;   /**< page-size bit (1 if the page is part of a superpage) */
+    uint8_t cow         : 1;   /**< copy-on-write bit (1 if the frame is shared, read-only) */
 } pte_t;
 
+/**
+ * @enum tlb_policy_t
+ * @brief How a TLB picks the entry to replace within a full set.
+ */
+typedef enum {
+    TLB_LRU,       /**< least recently used entry */
+    TLB_FIFO,      /**< oldest inserted entry */
+    TLB_RANDOM     /**< pseudo-random entry */
+} tlb_policy_t;
+
+/**
+ * @struct tlbe_t
+ * @brief A TLB entry type, caching the mapping of one virtual page, or of a superpage, to frames.
+ */
+typedef struct {
+    unsigned long stamp;     /**< last use (TLB_LRU) or insertion (TLB_FIFO) time */
+    pagenum_t pagenum;       /**< virtual page number, the first of a superpage */
+    framenum_t framenum;     /**< physical page frame number, the first of a superpage */
+    uint8_t order;           /**< log2 of the pages mapped; 0 for a single page */
+    bool valid;              /**< true if the entry holds a mapping */
+} tlbe_t;
+
+/**
+ * @struct tlb_t
+ * @brief A set-associative translation lookaside buffer.
+ *
+ * A TLB with one set is fully associative; a TLB with one way per set is direct mapped.
+ * @see tlb_alloc(), tlb_free().
+ */
+typedef struct {
+    tlbe_t* entries;         /**< TLB entries, grouped by set */
+    size_t sets;             /**< number of sets */
+    size_t ways;             /**< number of entries per set */
+    tlb_policy_t policy;     /**< replacement policy within a set */
+    unsigned long clock;     /**< logical time, advanced on every stamp */
+    uint32_t seed;           /**< pseudo-random state (TLB_RANDOM) */
+    unsigned long hits;      /**< lookups that found a mapping */
+    unsigned long misses;    /**< lookups that did not find a mapping */
+    unsigned long huge_hits; /**< hits on superpage entries */
+    unsigned order;          /**< log2 of the pages of superpage entries; 0 until one is cached */
+} tlb_t;
+
+/**
+ * @enum pagetable_kind_t
+ * @brief How a page table stores its entries.
+ * @see pagetable_alloc_kind().
+ */
+typedef enum {
+    PAGETABLE_FLAT,      /**< one array with an entry for every virtual page */
+    PAGETABLE_RADIX,     /**< a tree of RADIX_FANOUT-entry levels, allocated as pages are mapped */
+    PAGETABLE_HASHED     /**< an inverted table with one entry per frame, found by hashing */
+} pagetable_kind_t;
+
+/**
+ * @struct pteleaf_t
+ * @brief The last level of a radix page table, with the aging counters and R bits of its
+ * entries kept apart as in a flat table.
+ */
+typedef struct {
+    pte_t entries[RADIX_FANOUT];    /**< page table entries */
+    uint8_t age[RADIX_FANOUT];      /**< aging counter of each entry */
+    uint8_t ref[RADIX_FANOUT];      /**< R bit of each entry */
+} pteleaf_t;
+
 /**
  * @struct pagetable_t
  * @brief A page table type, consisting of many page table entries.
+ *
+ * Entries are only reached through the pte_* functions, whatever the kind of table.  A flat
+ * table's arrays have one element per virtual page and a hashed table's one element per frame;
+ * a radix table keeps its entries in leaves instead.  A page whose entry was never set reads as
+ * all zeros.
  * @see pagetable_alloc(), pagetable_free().
  */
 typedef struct {
-    pte_t* entries;    /**< page table entries */
-    size_t size;       /**< number of page table entries */
+    pagetable_kind_t kind;   /**< how entries are stored */
+    pte_t* entries;          /**< page table entries (flat and hashed) */
+    uint8_t* age;            /**< aging counter of each entry (flat and hashed) */
+    uint8_t* ref;            /**< R bit of each entry, one byte per entry (flat and hashed) */
+    size_t size;             /**< number of elements in the arrays above */
+    void** root;             /**< top level of the tree (radix) */
+    unsigned levels;         /**< number of levels, counting the leaves (radix) */
+    size_t nodes;            /**< number of levels allocated above the leaves (radix) */
+    pteleaf_t** leaves;      /**< every allocated leaf, for aging (radix) */
+    size_t nleaves;          /**< number of allocated leaves (radix) */
+    size_t leaves_cap;       /**< capacity of the leaves array (radix) */
+    pagenum_t* owner;        /**< page whose entry is at each frame's element (hashed) */
+    pagemap_t* index;        /**< frame of each page with an entry (hashed) */
+    tlb_t* tlb;              /**< TLB in front of the entries, or NULL for none; may be shared */
+    asid_t asid;             /**< address space identifier, assigned on allocation */
 } pagetable_t;
 
-/** A page number type. */
-typedef uint8_t pagenum_t;
+/**
+ * Makes the key that tells a page apart from the pages of every other address space.  The TLB,
+ * the replacement policies and the fault counts are all keyed by it.
+ * @param tbl the page table of the page's address space
+ * @param pagenum the virtual page number
+ * @return the page's key
+ */
+static inline uint64_t page_key(const pagetable_t* tbl, pagenum_t pagenum) {
+    return (uint64_t)tbl->asid << ASID_SHIFT | pagenum;
+}
 
-/** A frame number type. */
-typedef uint8_t framenum_t;
 
 /**
  * @struct page_t
- * @brief A page type, consisting of a fixed amount of bytes.
+ * @brief A page type, consisting of PAGE_SIZE bytes.
+ *
+ * Only the first PAGE_SIZE bytes belong to the page, and frames are PAGE_SIZE bytes apart, so a
+ * page is only ever handled through a pointer and never as an array element.
  */
 typedef struct {
-    uint8_t bytes[PAGE_SIZE];  /**< the bytes of the page */
+    uint8_t bytes[1UL << PAGE_SHIFT_MAX];  /**< the bytes of the page */
 } page_t;
 
 /** A frame type, equivalent to a page type. */
 typedef page_t frame_t;
 
+/**
+ * @enum policy_kind_t
+ * @brief A page replacement policy.
+ * @see mm_policy_init().
+ */
+typedef enum {
+    POLICY_AGING,      /**< evict the page with the smallest aging counter */
+    POLICY_CLOCK,      /**< second chance over a circular list of frames */
+    POLICY_LRU,        /**< evict the least recently used page */
+    POLICY_WSCLOCK,    /**< CLOCK that prefers clean pages outside the working set */
+    POLICY_ARC,        /**< adaptive replacement cache */
+    POLICY_2Q,         /**< two queues: a FIFO for new pages and an LRU for reused ones */
+    POLICY_COUNT       /* number of policies */
+} policy_kind_t;
+
+/**
+ * @enum replace_scope_t
+ * @brief Which resident pages a faulting address space may replace.
+ * @see mm_spaces_init().
+ */
+typedef enum {
+    SCOPE_GLOBAL,    /**< any page, chosen by one policy over every address space */
+    SCOPE_LOCAL      /**< its own pages once it holds its share, chosen by a policy of its own */
+} replace_scope_t;
+
+/**
+ * @struct mmu_stats_t
+ * @brief MMU activity counters.
+ * @see mm_stats(), mm_stats_reset().
+ */
+typedef struct {
+    unsigned long accesses;          /**< page lookups through pte_page() */
+    unsigned long hits;              /**< lookups that found the page present */
+    unsigned long faults;            /**< lookups that had to load the page */
+    unsigned long cold_faults;       /**< faults on pages never loaded before */
+    unsigned long capacity_faults;   /**< faults on pages loaded before and since evicted */
+    unsigned long evictions;         /**< pages removed from their frames */
+    unsigned long writebacks;        /**< evictions that wrote a dirty page to the page file */
+    unsigned long zero_fills;        /**< loads that zeroed the frame instead of reading */
+    unsigned long zero_discards;     /**< dirty pages found all zeros and not written back */
+    unsigned long bytes_read;        /**< bytes read from the page file */
+    unsigned long bytes_written;     /**< bytes written to the page file */
+    unsigned long prefetches;        /**< pages read ahead of their first access */
+    unsigned long prefetch_hits;     /**< pages read ahead that were used before being evicted */
+    unsigned long prefetch_wasted;   /**< pages read ahead that were evicted without being used */
+    unsigned long flushes;           /**< dirty pages written back ahead of their eviction */
+    unsigned long zcache_hits;       /**< loads served from the compressed page cache */
+    unsigned long zcache_stores;     /**< dirty pages written back into the compressed page cache */
+    unsigned long zcache_spills;     /**< cached pages moved on to the page file to make room */
+    unsigned long superpage_faults;  /**< faults that brought in a whole superpage */
+    unsigned long promotions;        /**< runs of pages mapped as a superpage */
+    unsigned long demotions;         /**< superpages split back into single pages */
+    unsigned long cow_shares;        /**< resident pages shared with a forked address space */
+    unsigned long cow_copies;        /**< writes that copied a page shared copy-on-write */
+    size_t zcache_pages;             /**< pages held in the compressed page cache now */
+    size_t zcache_bytes;             /**< bytes held in the compressed page cache now */
+} mmu_stats_t;
+
+/**
+ * @struct page_faults_t
+ * @brief The number of faults on one virtual page.
+ * @see mm_page_faults().
+ */
+typedef struct {
+    asid_t asid;             /**< address space of the page */
+    pagenum_t pagenum;       /**< virtual page number */
+    unsigned long faults;    /**< faults on the page */
+} page_faults_t;
+
+/**
+ * @enum pagefile_mode_t
+ * @brief How the backing page file is accessed on page loads and evictions.
+ */
+typedef enum {
+    PAGEFILE_STDIO,    /**< fopen/fseek/fclose on every page transfer (legacy path) */
+    PAGEFILE_PIO,      /**< one descriptor held open, positional pread/pwrite per page */
+    PAGEFILE_MMAP      /**< page file mapped into memory, pages copied with memcpy */
+} pagefile_mode_t;
+
+/**
+ * @enum msync_policy_t
+ * @brief When a memory-mapped page file is flushed to disk with msync.
+ */
+typedef enum {
+    MSYNC_NEVER,       /**< leave flushing entirely to the OS page cache */
+    MSYNC_HALT,        /**< flush once when the page file is closed */
+    MSYNC_EVERY        /**< flush after every msync_every page write-backs */
+} msync_policy_t;
+
+/**
+ * @enum pagefile_create_t
+ * @brief How a new page file is zeroed when it is created.
+ */
+typedef enum {
+    PAGEFILE_SPARSE,       /**< truncate to size; unwritten ranges read back as zeros */
+    PAGEFILE_FALLOCATE,    /**< truncate, then reserve zeroed blocks for the whole file */
+    PAGEFILE_ZERO_FILL     /**< write every byte as zero (legacy path) */
+} pagefile_create_t;
+
+/**
+ * @struct writeback_opts_t
+ * @brief Options for writing dirty pages back ahead of their eviction.
+ * @see mm_writeback_init().
+ */
+typedef struct {
+    unsigned background_ratio;    /**< percent of frames dirty above which pages are written back */
+    unsigned ratio;               /**< percent of frames dirty at which a thread dirtying a page
+                                       writes pages back itself; 0 for no limit */
+    uint8_t age_cutoff;           /**< dirty pages whose aging counter has fallen to this or below
+                                       are written back whatever the ratio */
+    bool async;                   /**< true to write back on a background thread */
+} writeback_opts_t;
+
+/**
+ * @struct pagefile_opts_t
+ * @brief Options for opening the backing page file.
+ * @see mm_vmem_init_opts().
+ */
+typedef struct {
+    pagefile_mode_t mode;          /**< page file access mode */
+    pagefile_create_t create;      /**< how the page file is zeroed on creation */
+    msync_policy_t msync;          /**< flush policy (PAGEFILE_MMAP only) */
+    unsigned long msync_every;     /**< write-backs between flushes (MSYNC_EVERY only) */
+} pagefile_opts_t;
+
+
+/**
+ * Makes a virtual address from its integer value.  Bits above the virtual address width are
+ * ignored, as the fixed-width bitfields of the original layout ignored them.
+ * @param value the virtual address
+ * @return the virtual address, split into page number and offset
+ */
+static inline vaddr_t mk_vaddr(uint64_t value) {
+    vaddr_t vaddr;
+    vaddr.pagenum = (value >> PAGE_SHIFT) & (PAGETABLE_SIZE - 1);
+    vaddr.offset = value & (PAGE_SIZE - 1);
+    return vaddr;
+}
+
+/**
+ * @brief Returns the integer value of a virtual address.
+ * @param vaddr the virtual address
+ * @return the virtual address as an integer
+ */
+static inline uint64_t vaddr_value(vaddr_t vaddr) {
+    return vaddr.pagenum << PAGE_SHIFT | vaddr.offset;
+}
+
+
+/**
+ * Sets the geometry of the simulated machine.  It must be called before mm_mem_init(); the
+ * default is 20-bit virtual addresses, 4 KB pages and 16 frames.  The page table has one entry
+ * per virtual page, so its size grows with 2^(vaddr_bits - page_shift).
+ * @param vaddr_bits bits in a virtual address, from page_shift + 1 to VADDR_BITS_MAX
+ * @param page_shift log2 of the page size, from PAGE_SHIFT_MIN to PAGE_SHIFT_MAX
+ * @param frames the number of page frames, from 1 to 2^32
+ * @return true if the geometry was set, else returns false for a geometry out of range, for one
+ * other than the compile-time geometry, or when memory is already initialized
+ */
+bool mm_geometry_init(unsigned vaddr_bits, unsigned page_shift, size_t frames);
+
+
+/**
+ * Sets how many address spaces share the frames and how they compete for them.  It must be called
+ * before mm_mem_init(); the default is one address space.  The page file holds a region for each
+ * address space.  Under SCOPE_LOCAL a faulting address space takes a free frame while there is
+ * one; otherwise, if it holds its equal share of the frames it replaces one of its own pages, and
+ * if not, one of the pages of the address space holding the most frames.
+ * @param spaces the number of address spaces, from 1 to ASID_MAX
+ * @param scope which pages a faulting address space may replace
+ * @return true if the address spaces were set, else returns false for a number out of range or
+ * when memory is already initialized
+ */
+bool mm_spaces_init(size_t spaces, replace_scope_t scope);
+
+
+/**
+ * Makes memory safe to access from several threads at once.  It must be called before
+ * mm_mem_init(); the default is a single thread, which takes no locks.
+ * @return true if threads were enabled, else returns false when memory is already initialized
+ */
+bool mm_threads_init();
+
+
+/**
+ * Turns on readahead: once faults step through the pages of an address space with the same stride
+ * a few times in a row, the next pages along the stride are prefetched, keeping up to window pages
+ * ahead of the accesses.  Pages are only read ahead into free frames and frames holding clean pages
+ * whose aging counters have run down to zero, so the working set is never pushed out.  It must be
+ * called before mm_mem_init(); the default is no readahead.
+ * @param window the most pages to read ahead; 0 turns readahead off
+ * @param async true to read the pages on a background I/O thread, which needs mm_threads_init()
+ * to have been called first; false to read them on the faulting thread
+ * @return true if readahead was set, else returns false when async is asked for without threads or
+ * when memory is already initialized
+ */
+bool mm_readahead_init(size_t window, bool async);
+
+
+/**
+ * Turns on write-back ahead of eviction.  A flusher sweeps the frames like a clock hand, writing
+ * back and cleaning dirty pages while more than background_ratio percent of the frames are dirty,
+ * and any dirty page whose aging counter has fallen to age_cutoff, as such a page is among the
+ * next victims.  The flusher runs on a background thread woken by every aging tick and whenever
+ * the dirty pages pass the background ratio, or, without async, sweeps a few frames on every
+ * aging tick.  Past ratio percent, a thread dirtying a page first writes pages back itself.  It
+ * must be called before mm_mem_init(); the default is no write-back ahead of eviction.
+ * @param opts the write-back options, or NULL to turn write-back off
+ * @return true if write-back was set, else returns false for a ratio over 100, when async is asked
+ * for without threads, or when memory is already initialized
+ */
+bool mm_writeback_init(const writeback_opts_t* opts);
+
+
+/**
+ * Puts a compressed page cache in front of the page file.  Dirty pages are compressed into it
+ * when written back, unless they do not compress well, and faults look in it before the page
+ * file.  When it holds more than budget bytes, the pages least recently stored or loaded are
+ * written on to the page file.  It must be called before mm_mem_init(), and takes effect at the
+ * next mm_vmem_init(); the default is no cache.
+ * @param budget the most bytes of memory the cache may hold; 0 turns the cache off
+ * @return true if the cache was sized, else returns false when memory is already initialized
+ */
+bool mm_zcache_init(size_t budget);
+
+
+/**
+ * Turns on superpages of 2^order pages.  A superpage is a naturally aligned run of pages held, in
+ * order, by a naturally aligned run of frames; a TLB caches it in one entry.  Each page keeps its
+ * own entry, with its own referenced, modified and aging bits, so replacement and write-back still
+ * work a page at a time.  It must be called before mm_mem_init(); the default is no superpages.
+ * @param order log2 of the pages in a superpage, up to SUPERPAGE_ORDER_MAX; 0 turns them off
+ * @return true if superpages were set, else returns false for too large an order or when memory
+ * is already initialized
+ */
+bool mm_superpages_init(unsigned order);
+
 
 /**
  * @brief Initializes the pseudo-physical memory frames.
- * @return a pointer to the first memory frame
+ * @return a pointer to the first memory frame, or NULL if memory could not be allocated
  */
 frame_t* mm_mem_init();
 
@@ -123,14 +554,190 @@ bool mm_vmem_init(char* pagefile);
 
 
 /**
- * @brief Dynamically allocates a new page table.
- * @return a pointer to the new page table
+ * Initializes the backing page file like mm_vmem_init(), but opens it with the given options
+ * instead of the defaults.  The page file stays open until mm_vmem_destroy() is called.
+ * @param pagefile the filename of the page file to be initialized
+ * @param opts the page file options
+ * @return true if the page file was created and opened successfully, else returns false
+ */
+bool mm_vmem_init_opts(char* pagefile, const pagefile_opts_t* opts);
+
+
+/**
+ * @brief Closes the backing page file opened by mm_vmem_init().
+ */
+void mm_vmem_destroy();
+
+
+/**
+ * Saves the state of the machine to an image: the counters, the kind of each address space's
+ * page table, the entry and aging counter of every resident page with the bytes of its frame,
+ * the fault counts, the page file's record of which pages it holds, and the compressed page
+ * cache.  Pages only held by the page file are not copied; the page file is flushed and left to
+ * be reused in place.  It must not be called while threads are accessing memory.
+ * @param path the filename of the image, which is overwritten
+ * @return true if the image was written, else returns false
+ */
+bool mm_checkpoint(const char* path);
+
+
+/**
+ * Restores the state saved by mm_checkpoint() in place of mm_vmem_init_opts(): the page file is
+ * reopened as it is rather than created, and the page tables, resident pages, counters and
+ * compressed page cache are read back from the image, mapped in one go.  It must be called after
+ * mm_mem_init() and mm_policy_init(), before any page table is allocated, with the geometry, the
+ * number of address spaces and the replacement scope the image was taken with; the page tables
+ * of the image's address spaces are allocated with their saved kinds and found with mm_space().
+ * Each resident page is handed to the replacement policy as a fresh fault into its frame, coldest
+ * first, and the TLBs and readahead detectors start empty.  The page file must not have changed
+ * since the image was taken.
+ * @param pagefile the filename of the page file the image was taken with
+ * @param opts the page file options
+ * @param path the filename of the image
+ * @return true if the state was restored, else returns false; an image whose header does not
+ * match leaves memory and the page file as they were, but on failure after the header was
+ * accepted, memory and the page file must be destroyed and initialized again
+ */
+bool mm_vmem_restore(char* pagefile, const pagefile_opts_t* opts, const char* path);
+
+
+/**
+ * Selects the page replacement policy, starting it with an empty history.  mm_mem_init() selects
+ * POLICY_AGING; call this before any page is loaded to use another one.  Under SCOPE_LOCAL each
+ * page table starts its own instance of the policy, so it must be called before any page table
+ * is allocated.
+ * @param kind the policy
+ * @return true if the policy's state could be allocated, else returns false
+ */
+bool mm_policy_init(policy_kind_t kind);
+
+
+/**
+ * @brief Returns the name of the given page replacement policy.
+ * @param kind the policy
+ * @return the policy's name
+ */
+const char* mm_policy_name(policy_kind_t kind);
+
+
+/**
+ * Copies the MMU activity counters.  The counters are plain increments on the fault and I/O paths
+ * only, so they are always on; hits are derived from accesses and faults when they are read.
+ * @param stats where to store the counters
+ */
+void mm_stats(mmu_stats_t* stats);
+
+
+/**
+ * Lists the virtual pages that have faulted since the counters were last reset, with their fault
+ * counts.  Counts are only kept for pages that faulted, so the list is short however large the
+ * virtual address space is.
+ * @param count where to store the number of pages listed
+ * @return a dynamically allocated array of pages in ascending order, to be freed by the caller, or
+ * NULL if no page has faulted or memory could not be allocated
+ */
+page_faults_t* mm_page_faults(size_t* count);
+
+
+/**
+ * Copies the MMU activity counters of one address space.  Evictions and write-backs count
+ * against the address space whose page was evicted, not the one that faulted.
+ * @param asid the address space identifier
+ * @param stats where to store the counters
+ */
+void mm_space_stats(asid_t asid, mmu_stats_t* stats);
+
+
+/**
+ * @brief Returns the page table of the given address space.
+ * @param asid the address space identifier
+ * @return the page table, or NULL if no page table has the ASID
+ */
+pagetable_t* mm_space(asid_t asid);
+
+
+/**
+ * @brief Returns the number of address spaces set by mm_spaces_init().
+ * @return the number of address spaces
+ */
+size_t mm_space_count();
+
+
+/**
+ * @brief Resets every MMU activity counter to zero.
+ */
+void mm_stats_reset();
+
+
+/**
+ * Dynamically allocates a new page table: a flat one for up to PAGETABLE_FLAT_MAX virtual pages,
+ * else a radix one.
+ * @return a pointer to the new page table, or NULL if it could not be allocated
  */
 pagetable_t* pagetable_alloc();
 
 
 /**
- * @brief Frees the specified page table from memory.
+ * Dynamically allocates a new page table of the given kind, with the lowest free ASID.  A flat
+ * table takes memory for every virtual page up front; a radix table grows with the pages mapped;
+ * a hashed table holds one entry per frame, so mapping a page to a frame replaces the entry of any
+ * other page mapped to it.
+ * @param kind how the table stores its entries
+ * @return a pointer to the new page table, or NULL if it could not be allocated or every ASID set
+ * by mm_spaces_init() is in use
+ */
+pagetable_t* pagetable_alloc_kind(pagetable_kind_t kind);
+
+
+/**
+ * @brief Dynamically allocates a new page table of the given kind for the given address space.
+ * @param kind how the table stores its entries
+ * @param asid the address space identifier, below the number set by mm_spaces_init()
+ * @return a pointer to the new page table, or NULL if it could not be allocated or the ASID is
+ * out of range or in use
+ */
+pagetable_t* pagetable_alloc_space(pagetable_kind_t kind, asid_t asid);
+
+
+/**
+ * Duplicates an address space into a new page table of the same kind, with the lowest free ASID.
+ * No resident page is copied: both page tables map its frame, with their entries marked
+ * copy-on-write, until the first write to it through either copies it into a frame of its own.
+ * A shared frame is aged and replaced as a page of the address space that held it first, and
+ * evicting it writes it back for every address space mapping it.  Pages held only in the
+ * compressed page cache or the page file are copied into the new address space's region of
+ * them, replacing whatever an earlier address space with its ASID left there.  The new page
+ * table has no TLB.  It must not be called while threads are accessing memory.
+ * @param tbl the page table of the address space to duplicate
+ * @return a pointer to the new page table, or NULL if it could not be allocated or every ASID set
+ * by mm_spaces_init() is in use
+ */
+pagetable_t* pagetable_fork(pagetable_t* tbl);
+
+
+/**
+ * @brief Duplicates an address space into a new page table for the given address space.
+ * @param tbl the page table of the address space to duplicate
+ * @param asid the address space identifier, below the number set by mm_spaces_init()
+ * @return a pointer to the new page table, or NULL if it could not be allocated or the ASID is
+ * out of range or in use
+ * @see pagetable_fork().
+ */
+pagetable_t* pagetable_fork_space(pagetable_t* tbl, asid_t asid);
+
+
+/**
+ * @brief Returns the number of bytes of memory held by the given page table, not counting its TLB.
+ * @param tbl the page table
+ * @return the size of the page table in bytes
+ */
+size_t pagetable_bytes(const pagetable_t* tbl);
+
+
+/**
+ * Frees the specified page table, and its TLB if it has one, from memory, and frees its ASID.  A
+ * TLB shared with other page tables must be detached first, and any resident pages evicted with
+ * mm_page_evict_all().
  * @param tbl the page table to be freed from memory
  */
 void pagetable_free(pagetable_t* tbl);
@@ -144,6 +751,8 @@ pte_t mk_pte(framenum_t framenum);
 
 /**
  * @brief Sets the page table entry in the page table for the given virtual page number.
+ *
+ * Any TLB entry for the page is invalidated.
  * @param tbl a pointer to the page table
  * @param pagenum the virtual page number
  * @param pte the page table entry to be set
@@ -152,6 +761,8 @@ void set_pte(pagetable_t* tbl, pagenum_t pagenum, pte_t pte);
 
 /**
  * @brief Clears the page table entry for the given virtual page number.
+ *
+ * Any TLB entry for the page is invalidated.
  * @param tbl a pointer to the page table
  * @param pagenum the virtual page number of the page to be cleared
  * @return the cleared page table entry
@@ -221,6 +832,17 @@ void pte_mkyoung(pagetable_t* tbl, pagenum_t pagenum);
 void pte_mkold(pagetable_t* tbl, pagenum_t pagenum);
 
 
+/**
+ * Advances every aging counter by one tick: shifts each counter right and clears each R bit, as
+ * pte_mkold() does for one page.  Pages that are not present always have a zero counter, so
+ * limiting the tick to resident pages gives the same result.  Time passes in every address space
+ * at once, so the counters of every page table sharing the frames are advanced.
+ * @param tbl a pointer to the page table of the running address space
+ * @param resident_only true to touch only the pages that are in a frame
+ */
+void pagetable_age(pagetable_t* tbl, bool resident_only);
+
+
 /**
  * @brief Returns the specified page table entry.
  * @param tbl a pointer to the page table
@@ -232,6 +854,8 @@ pte_t pte_val(pagetable_t* tbl, pagenum_t pagenum);
 
 /**
  * @brief Translates a virtual address to a physical address.
+ *
+ * The page table's TLB, if it has one, is consulted before the page table entry.
  * @param tbl a pointer to the page table
  * @param vaddr the virtual address
  * @return the physical address corresponding to the given virtual address
@@ -241,7 +865,8 @@ addr_t pagetable_translate(const pagetable_t* tbl, const vaddr_t vaddr);
 
 /**
  * Writes the specified page from the page frame to the backing page file and clears the page's R
- * and M bits, so that some page replacement algorithm might now use the frame.
+ * and M bits, so that some page replacement algorithm might now use the frame.  A frame shared
+ * copy-on-write with other address spaces is left to them.
  * @param pagefile the page file to be written to
  * @param tbl the page table
  * @param pagenum the number of the page to be evicted
@@ -249,6 +874,15 @@ addr_t pagetable_translate(const pagetable_t* tbl, const vaddr_t vaddr);
 void mm_page_evict(char* pagefile, pagetable_t* tbl, pagenum_t pagenum);
 
 
+/**
+ * Evicts every resident page, writing back those that are dirty.  Only the frames are visited, so
+ * this is cheap however large the virtual address space is.
+ * @param pagefile the page file to be written to
+ * @param tbl the page table
+ */
+void mm_page_evict_all(char* pagefile, pagetable_t* tbl);
+
+
 /**
  * Loads the specified page from the backing page file to the corresponding page frame per the
  * page's page table entry.
@@ -261,7 +895,10 @@ void mm_page_load(char* pagefile, pagetable_t* tbl, pagenum_t pagenum);
 
 /**
  * Returns a pointer to the page frame containing the specified page, according to the specified
- * page number's corresponding page table entry.
+ * page number's corresponding page table entry.  A hit in the page table's TLB skips the page
+ * table walk; otherwise the mapping is cached in the TLB once the page is present.  With several
+ * threads, another thread's fault may reuse the frame as soon as this returns; the span functions
+ * hold the frame while they copy.
  * @param pagefile the page file
  * @param tbl the page table
  * @param pagenum the number of the page to be located
@@ -269,4 +906,46 @@ void mm_page_load(char* pagefile, pagetable_t* tbl, pagenum_t pagenum);
  */
 frame_t* pte_page(char* pagefile, pagetable_t* tbl, pagenum_t pagenum);
 
+/**
+ * Reads a run of bytes starting at the specified virtual address.  The range is split at page
+ * boundaries, and each page is faulted in once and copied as a whole chunk.
+ * @param pagefile the page file
+ * @param tbl the page table
+ * @param vaddr the virtual address of the first byte to be read
+ * @param buf the buffer to read into
+ * @param nbytes the number of bytes to be read
+ * @return the number of bytes read, which is less than nbytes if the range runs past the end of
+ * the virtual address space
+ */
+size_t mmu_read_span(char* pagefile, pagetable_t* tbl, vaddr_t vaddr, uint8_t* buf,
+                     size_t nbytes);
+
+/**
+ * Writes a run of bytes starting at the specified virtual address.  The range is split at page
+ * boundaries, and each page is faulted in and marked dirty once and copied as a whole chunk.
+ * @param pagefile the page file
+ * @param tbl the page table
+ * @param vaddr the virtual address of the first byte to be written
+ * @param buf the bytes to be written
+ * @param nbytes the number of bytes to be written
+ * @return the number of bytes written, which is less than nbytes if the range runs past the end
+ * of the virtual address space
+ */
+size_t mmu_write_span(char* pagefile, pagetable_t* tbl, vaddr_t vaddr, const uint8_t* buf,
+                      size_t nbytes);
+
+/**
+ * Sets a run of bytes starting at the specified virtual address to one value, one page at a time
+ * like mmu_write_span().
+ * @param pagefile the page file
+ * @param tbl the page table
+ * @param vaddr the virtual address of the first byte to be set
+ * @param val the value of every byte
+ * @param nbytes the number of bytes to be set
+ * @return the number of bytes set, which is less than nbytes if the range runs past the end of
+ * the virtual address space
+ */
+size_t mmu_fill_span(char* pagefile, pagetable_t* tbl, vaddr_t vaddr, uint8_t val,
+                     size_t nbytes);
+
 #endif /* MMU_H */
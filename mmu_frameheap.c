@@ -0,0 +1,146 @@
+/**
+ * @file mmu_frameheap.c
+ * @brief Frame heap implementation.
+ *
+ * @author ckurdelak20@georgefox.edu
+ */
+
+#include "mmu_frameheap.h"
+
+frameheap_t* frameheap_alloc(size_t frames) {
+    frameheap_t* heap = malloc(sizeof(frameheap_t));
+    if (heap != NULL) {
+        heap->heap = calloc(frames, sizeof(framenum_t));
+        heap->age = calloc(frames, sizeof(uint8_t));
+        heap->pos = calloc(frames, sizeof(size_t));
+        if (heap->heap != NULL && heap->age != NULL && heap->pos != NULL) {
+            heap->size = 0;
+            heap->capacity = frames;
+            for (size_t i = 0; i < frames; i++) {
+                heap->pos[i] = frames;
+            }
+        }
+        else {
+            frameheap_free(heap);
+            heap = NULL;
+        }
+    }
+    return heap;
+}
+
+void frameheap_free(frameheap_t* heap) {
+    if (heap != NULL) {
+        free(heap->heap);
+        free(heap->age);
+        free(heap->pos);
+        free(heap);
+    }
+}
+
+/**
+ * A helper function that places a frame at the given heap index.
+ * @param heap the frame heap
+ * @param i the heap index
+ * @param framenum the frame number
+ */
+static void frameheap_place(frameheap_t* heap, size_t i, framenum_t framenum) {
+    heap->heap[i] = framenum;
+    heap->pos[framenum] = i;
+}
+
+/**
+ * A helper function that moves the frame at the given heap index up until its parent is no
+ * older than it is.
+ * @param heap the frame heap
+ * @param i the heap index
+ */
+static void frameheap_sift_up(frameheap_t* heap, size_t i) {
+    framenum_t framenum = heap->heap[i];
+    while (i > 0 && heap->age[heap->heap[(i - 1) / 2]] > heap->age[framenum]) {
+        frameheap_place(heap, i, heap->heap[(i - 1) / 2]);
+        i = (i - 1) / 2;
+    }
+    frameheap_place(heap, i, framenum);
+}
+
+/**
+ * A helper function that moves the frame at the given heap index down until neither child is
+ * younger than it is.
+ * @param heap the frame heap
+ * @param i the heap index
+ */
+static void frameheap_sift_down(frameheap_t* heap, size_t i) {
+    framenum_t framenum = heap->heap[i];
+    bool done = false;
+    while (!done) {
+        size_t child = 2 * i + 1;
+        // pick the younger-keyed of the two children
+        if (child + 1 < heap->size
+            && heap->age[heap->heap[child + 1]] < heap->age[heap->heap[child]]) {
+            child++;
+        }
+        if (child < heap->size && heap->age[heap->heap[child]] < heap->age[framenum]) {
+            frameheap_place(heap, i, heap->heap[child]);
+            i = child;
+        }
+        else {
+            done = true;
+        }
+    }
+    frameheap_place(heap, i, framenum);
+}
+
+void frameheap_push(frameheap_t* heap, framenum_t framenum, uint8_t age) {
+    if (heap->pos[framenum] < heap->capacity) {
+        frameheap_update(heap, framenum, age);
+    }
+    else {
+        heap->age[framenum] = age;
+        frameheap_place(heap, heap->size, framenum);
+        heap->size++;
+        frameheap_sift_up(heap, heap->size - 1);
+    }
+}
+
+void frameheap_update(frameheap_t* heap, framenum_t framenum, uint8_t age) {
+    size_t i = heap->pos[framenum];
+    if (i < heap->capacity) {
+        uint8_t old_age = heap->age[framenum];
+        heap->age[framenum] = age;
+        if (age < old_age) {
+            frameheap_sift_up(heap, i);
+        }
+        else if (age > old_age) {
+            frameheap_sift_down(heap, i);
+        }
+    }
+}
+
+void frameheap_age(frameheap_t* heap) {
+    for (size_t i = 0; i < heap->size; i++) {
+        heap->age[heap->heap[i]] >>= 1;
+    }
+}
+
+void frameheap_remove(frameheap_t* heap, framenum_t framenum) {
+    size_t i = heap->pos[framenum];
+    if (i < heap->capacity) {
+        heap->pos[framenum] = heap->capacity;
+        heap->size--;
+        if (i < heap->size) {
+            // fill the hole with the last frame and restore the order around it
+            framenum_t moved = heap->heap[heap->size];
+            frameheap_place(heap, i, moved);
+            frameheap_sift_up(heap, i);
+            frameheap_sift_down(heap, heap->pos[moved]);
+        }
+    }
+}
+
+bool frameheap_min(const frameheap_t* heap, framenum_t* framenum) {
+    bool found = heap->size > 0;
+    if (found) {
+        *framenum = heap->heap[0];
+    }
+    return found;
+}
@@ -0,0 +1,81 @@
+/**
+ * @file mmu_frameheap.h
+ * @brief Function prototypes for the frame heap used to pick page replacement victims.
+ *
+ * The frame heap holds only the occupied page frames, keyed by the aging counter of the page in
+ * each frame, so the frame holding the oldest page is always at the top.  Its cost depends on
+ * the number of page frames, not on the size of the page table.
+ *
+ * @author ckurdelak20@georgefox.edu
+ */
+
+#ifndef MMU_FRAMEHEAP_H
+#define MMU_FRAMEHEAP_H
+
+#include "mmu.h"
+
+/**
+ * @struct frameheap_t
+ * @brief A frame-indexed binary min-heap of occupied frames, keyed by age.
+ * @see frameheap_alloc(), frameheap_free().
+ */
+typedef struct {
+    framenum_t* heap;    /**< occupied frames in heap order */
+    uint8_t* age;        /**< key of each frame, indexed by frame number */
+    size_t* pos;         /**< heap index of each frame, or capacity if not in the heap */
+    size_t size;         /**< number of frames in the heap */
+    size_t capacity;     /**< number of frames */
+} frameheap_t;
+
+/**
+ * @brief Dynamically allocates a new, empty frame heap.
+ * @param frames the number of page frames
+ * @return a pointer to the new frame heap
+ */
+frameheap_t* frameheap_alloc(size_t frames);
+
+/**
+ * @brief Frees the specified frame heap from memory.
+ * @param heap the frame heap to be freed from memory
+ */
+void frameheap_free(frameheap_t* heap);
+
+/**
+ * @brief Adds a frame to the heap, or updates its age if it is already there.
+ * @param heap the frame heap
+ * @param framenum the frame number
+ * @param age the aging counter of the page in the frame
+ */
+void frameheap_push(frameheap_t* heap, framenum_t framenum, uint8_t age);
+
+/**
+ * @brief Updates the age of a frame, if it is in the heap.
+ * @param heap the frame heap
+ * @param framenum the frame number
+ * @param age the new aging counter of the page in the frame
+ */
+void frameheap_update(frameheap_t* heap, framenum_t framenum, uint8_t age);
+
+/**
+ * Shifts the age of every frame right by one, as an aging tick does.  The shift never reorders
+ * two ages, so the heap stays in order without any sifting.
+ * @param heap the frame heap
+ */
+void frameheap_age(frameheap_t* heap);
+
+/**
+ * @brief Removes a frame from the heap, if it is there.
+ * @param heap the frame heap
+ * @param framenum the frame number
+ */
+void frameheap_remove(frameheap_t* heap, framenum_t framenum);
+
+/**
+ * Returns the frame holding the page with the smallest aging counter, without removing it.
+ * @param heap the frame heap
+ * @param framenum where to store the frame number
+ * @return true if the heap was not empty, else returns false
+ */
+bool frameheap_min(const frameheap_t* heap, framenum_t* framenum);
+
+#endif /* MMU_FRAMEHEAP_H */
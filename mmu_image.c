@@ -0,0 +1,71 @@
+/**
+ * @file mmu_image.c
+ * @brief Checkpoint image implementation.
+ *
+ * @author ckurdelak20@georgefox.edu
+ */
+
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "mmu_image.h"
+
+image_t* image_open(const char* path) {
+    image_t* image = NULL;
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd != -1 && fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(image_header_t)) {
+        void* data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED) {
+            image_header_t header;
+            memcpy(&header, data, sizeof(header));
+            // the image is read front to back exactly once
+            madvise(data, st.st_size, MADV_SEQUENTIAL);
+            if (memcmp(header.magic, IMAGE_MAGIC, 4) == 0 && header.version == IMAGE_VERSION) {
+                image = malloc(sizeof(image_t));
+            }
+            if (image != NULL) {
+                image->data = data;
+                image->size = st.st_size;
+                image->pos = 0;
+            }
+            else {
+                munmap(data, st.st_size);
+            }
+        }
+    }
+    if (fd != -1) {
+        close(fd);
+    }
+    return image;
+}
+
+void image_close(image_t* image) {
+    if (image != NULL) {
+        munmap((void*)image->data, image->size);
+        free(image);
+    }
+}
+
+const uint8_t* image_next(image_t* image, size_t size) {
+    const uint8_t* bytes = NULL;
+    if (image->size - image->pos >= size) {
+        bytes = image->data + image->pos;
+        image->pos += size;
+    }
+    return bytes;
+}
+
+bool image_get(image_t* image, void* buf, size_t size) {
+    const uint8_t* bytes = image_next(image, size);
+    if (bytes != NULL && size > 0) {
+        memcpy(buf, bytes, size);
+    }
+    return bytes != NULL;
+}
+
+bool image_put(FILE* out, const void* buf, size_t size) {
+    return fwrite(buf, 1, size, out) == size;
+}
@@ -0,0 +1,113 @@
+/**
+ * @file mmu_image.h
+ * @brief Declarations for checkpoint images of the MMU's state.
+ *
+ * An image is an image_header_t followed by sections, each written by the part of the MMU that
+ * owns the state: the counters, the address spaces, a record per entry mapping an occupied frame,
+ * the fault counts, the page file's record of its pages, the compressed page cache, and last the
+ * bytes of every occupied frame in the order of their records.  The sections hold no pages that
+ * are only in the page file; the page file is kept in place and reused, so it must not change
+ * between taking an image and restoring it.  Fields are fixed-width and in the byte order of the
+ * machine that wrote them, and nothing is padded between fields of different sections, so a
+ * reader must not assume any alignment.
+ *
+ * @author ckurdelak20@georgefox.edu
+ */
+
+#ifndef MMU_IMAGE_H
+#define MMU_IMAGE_H
+
+#include <stdio.h>
+#include "mmu.h"
+
+#define IMAGE_MAGIC     "MMUI"
+#define IMAGE_VERSION   2
+#define IMAGE_NO_SPACE  UINT32_MAX    /* kind of an address space without a page table */
+
+/**
+ * @struct image_header_t
+ * @brief The start of an image: the shape of the machine it was taken on.
+ */
+typedef struct {
+    char magic[4];               /**< IMAGE_MAGIC */
+    uint32_t version;            /**< IMAGE_VERSION */
+    uint32_t vaddr_bits;         /**< bits in a virtual address */
+    uint32_t page_shift;         /**< log2 of the page size */
+    uint64_t frames;             /**< number of page frames */
+    uint32_t spaces;             /**< number of address spaces */
+    uint32_t scope;              /**< replacement scope */
+    uint32_t superpage_order;    /**< log2 of the pages in a superpage, or 0 */
+    uint32_t zcache;             /**< 1 if a compressed page cache section follows */
+} image_header_t;
+
+/**
+ * @struct image_frame_t
+ * @brief The record of an entry mapping an occupied frame: the page the frame holds and that
+ * page's entry.  The owner's record of a frame comes first, then one for each address space
+ * sharing it copy-on-write.
+ */
+typedef struct {
+    uint64_t framenum;    /**< physical page frame number */
+    uint64_t pagenum;     /**< virtual page number of the page in the frame */
+    uint16_t asid;        /**< address space of the entry */
+    uint8_t age;          /**< aging counter of the page */
+    uint8_t R;            /**< referenced bit */
+    uint8_t M;            /**< modified bit */
+    uint8_t huge;         /**< page-size bit */
+    uint8_t cow;          /**< copy-on-write bit */
+    uint8_t shared;       /**< 1 if the frame's owner was recorded before, else 0 */
+} image_frame_t;
+
+/**
+ * @struct image_t
+ * @brief An image opened for restoring; the whole file is memory-mapped.
+ * @see image_open(), image_close().
+ */
+typedef struct {
+    const uint8_t* data;    /**< the mapped image file */
+    size_t size;            /**< size of the image file in bytes */
+    size_t pos;             /**< offset of the next unread byte */
+} image_t;
+
+/**
+ * Opens an image for restoring and checks its magic and version.  The header is left for the
+ * caller to read with image_get().
+ * @param path the filename of the image
+ * @return a pointer to the open image, or NULL if it could not be opened or is not an image of
+ * this version
+ */
+image_t* image_open(const char* path);
+
+/**
+ * @brief Closes the given image and frees it from memory.
+ * @param image the image to be closed
+ */
+void image_close(image_t* image);
+
+/**
+ * @brief Returns the next bytes of an image in place and moves past them.
+ * @param image the image
+ * @param size the number of bytes
+ * @return a pointer to the bytes in the mapping, or NULL if fewer are left
+ */
+const uint8_t* image_next(image_t* image, size_t size);
+
+/**
+ * @brief Copies the next bytes of an image out and moves past them.
+ * @param image the image
+ * @param buf where to copy the bytes
+ * @param size the number of bytes
+ * @return true if the bytes were copied, else returns false if fewer are left
+ */
+bool image_get(image_t* image, void* buf, size_t size);
+
+/**
+ * @brief Writes bytes to an image being taken.
+ * @param out the file to write to
+ * @param buf the bytes to be written
+ * @param size the number of bytes
+ * @return true if the bytes were written, else returns false
+ */
+bool image_put(FILE* out, const void* buf, size_t size);
+
+#endif /* MMU_IMAGE_H */
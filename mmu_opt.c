@@ -0,0 +1,515 @@
+/**
+ * @file mmu_opt.c
+ * @brief The optimal (Belady MIN) replacement oracle for recorded traces.
+ *
+ * Reports how far each replacement policy is from the fewest misses any policy could take on a
+ * trace.  Build and run from the repository root with:
+ *
+ *     cc -O2 -pthread -I. -o mmu_opt mmu_opt.c mmu_trace.c mmu.c mmu_frameheap.c mmu_image.c \
+ *         mmu_pagefile.c mmu_pagemap.c mmu_policy.c mmu_readahead.c mmu_tlb.c mmu_zcache.c
+ *     ./mmu_sim -o trace.bin < commands.txt
+ *     ./mmu_opt -f <frames> trace.bin
+ *
+ * @author ckurdelak20@georgefox.edu
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "mmu.h"
+#include "mmu_opt.h"
+#include "mmu_pagemap.h"
+#include "mmu_trace.h"
+
+/**
+ * @struct opt_heap_t
+ * @brief A max-heap of the occupied frames of an optimal run, keyed by the next use of the page
+ * each holds, so that the root is always the victim.
+ */
+typedef struct {
+    uint32_t* order;    /**< frames in heap order */
+    uint32_t* pos;      /**< heap position of each frame */
+    uint32_t* next;     /**< next use of the page in each frame */
+    uint32_t* page;     /**< page held by each frame */
+    size_t size;        /**< number of occupied frames */
+} opt_heap_t;
+
+static char* pagefile = "mmu_opt.sys";
+
+int main(int argc, char* argv[]) {
+    opt_opts_t opts = {
+        .vaddr_bits = mmu_geom.vaddr_bits,
+        .page_shift = mmu_geom.page_shift,
+        .frames = mmu_geom.frames,
+        .spaces = 1,
+        .policies = (1u << POLICY_COUNT) - 1
+    };
+    if (!opt_get_opts(argc, argv, &opts)) {
+        fprintf(stderr, "usage: %s [-v <vaddr bits>] [-k <page KB>] [-f <frames>] "
+                "[-n <processes>] [-a all|resident] [-e aging|clock|lru|wsclock|arc|2q|none]... "
+                "[-E <evictions file>] <trace>\n",
+                argv[0]);
+        exit(EXIT_FAILURE);
+    }
+    if (!mm_geometry_init(opts.vaddr_bits, opts.page_shift, opts.frames)) {
+        fprintf(stderr, "unsupported geometry: %u-bit addresses, %zu KB pages, %zu frames\n",
+                opts.vaddr_bits, ((size_t)1 << opts.page_shift) / 1024, opts.frames);
+        exit(EXIT_FAILURE);
+    }
+    if (!mm_spaces_init(opts.spaces, SCOPE_GLOBAL)) {
+        fprintf(stderr, "unsupported number of processes: %zu\n", opts.spaces);
+        exit(EXIT_FAILURE);
+    }
+
+    // Expand the trace into page references and find the next use of each
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    opt_refs_t* refs = opt_refs_load(opts.trace);
+    if (refs == NULL) {
+        fprintf(stderr, "could not load %s\n", opts.trace);
+        exit(EXIT_FAILURE);
+    }
+
+    // Run the optimum, writing out its evictions if asked
+    FILE* evictions = NULL;
+    if (opts.evictions != NULL) {
+        evictions = fopen(opts.evictions, "w");
+        if (evictions == NULL) {
+            fprintf(stderr, "could not write %s\n", opts.evictions);
+            exit(EXIT_FAILURE);
+        }
+    }
+    unsigned long misses;
+    bool success = opt_run(refs, PAGE_FRAMES, evictions, &misses);
+    if (evictions != NULL) {
+        success = fclose(evictions) == 0 && success;
+    }
+    if (!success) {
+        fprintf(stderr, "could not run the optimum over %s\n", opts.trace);
+        exit(EXIT_FAILURE);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    fprintf(stderr, "opt: %zu references in %.3f s (%.0f refs/sec)\n", refs->length, elapsed,
+            elapsed > 0 ? refs->length / elapsed : 0.0);
+
+    printf("%s: %zu references to %zu pages, %zu frames\n", opts.trace, refs->length,
+           refs->pages, PAGE_FRAMES);
+    printf("%-8s %12s %12s %9s %12s %9s\n", "policy", "accesses", "misses", "hit_rate",
+           "over_opt", "over_pct");
+    printf("%-8s %12zu %12lu %9.4f %12s %9s\n", "opt", refs->length, misses,
+           refs->length > 0 ? 1.0 - (double)misses / refs->length : 0.0, "-", "-");
+
+    // Replay the trace under each policy and compare its misses with the optimum
+    for (policy_kind_t kind = POLICY_AGING; kind < POLICY_COUNT; kind++) {
+        mmu_stats_t stats;
+        if ((opts.policies >> kind & 1) == 0) {
+            // not asked for
+        }
+        else if (opt_replay(opts.trace, kind, opts.age_resident, &stats)) {
+            long over = (long)stats.faults - (long)misses;
+            printf("%-8s %12lu %12lu %9.4f %+12ld %+8.1f%%\n", mm_policy_name(kind),
+                   stats.accesses, stats.faults,
+                   stats.accesses > 0 ? 1.0 - (double)stats.faults / stats.accesses : 0.0,
+                   over, misses > 0 ? 100.0 * over / misses : 0.0);
+        }
+        else {
+            fprintf(stderr, "could not replay %s under %s\n", opts.trace, mm_policy_name(kind));
+        }
+    }
+    remove(pagefile);
+    opt_refs_free(refs);
+    exit(0);
+}
+
+
+bool opt_get_opts(int argc, char* argv[], opt_opts_t* opts) {
+    bool success = true;
+    bool chosen = false;
+    int opt;
+    char* end;
+    const char* optstring = "v:k:f:n:a:e:E:";
+    while (success && (opt = getopt(argc, argv, optstring)) != -1) {
+        if (opt == 'v') {
+            opts->vaddr_bits = strtoul(optarg, &end, 10);
+            success = *end == '\0';
+        }
+        else if (opt == 'k') {
+            // a power of two number of kilobytes
+            unsigned long kb = strtoul(optarg, &end, 10);
+            success = *end == '\0' && kb > 0 && (kb & (kb - 1)) == 0;
+            if (success) {
+                opts->page_shift = 10 + __builtin_ctzl(kb);
+            }
+        }
+        else if (opt == 'f') {
+            opts->frames = strtoul(optarg, &end, 10);
+            success = *end == '\0';
+        }
+        else if (opt == 'n') {
+            opts->spaces = strtoul(optarg, &end, 10);
+            success = *end == '\0';
+        }
+        else if (opt == 'a') {
+            if (strcmp(optarg, "all") == 0) {
+                opts->age_resident = false;
+            }
+            else if (strcmp(optarg, "resident") == 0) {
+                opts->age_resident = true;
+            }
+            else {
+                success = false;
+            }
+        }
+        else if (opt == 'e') {
+            // the first policy named replaces the default of all of them; none runs only OPT
+            if (!chosen) {
+                opts->policies = 0;
+                chosen = true;
+            }
+            policy_kind_t kind = POLICY_AGING;
+            while (kind < POLICY_COUNT && strcmp(optarg, mm_policy_name(kind)) != 0) {
+                kind++;
+            }
+            if (kind < POLICY_COUNT) {
+                opts->policies |= 1u << kind;
+            }
+            else {
+                success = strcmp(optarg, "none") == 0;
+            }
+        }
+        else if (opt == 'E') {
+            opts->evictions = optarg;
+        }
+        else {
+            success = false;
+        }
+    }
+    if (success && optind == argc - 1) {
+        opts->trace = argv[optind];
+    }
+    return success && opts->trace != NULL;
+}
+
+
+/**
+ * A helper function that adds a page to the reference string, numbering it if it is new.
+ * @param refs the reference string
+ * @param map the page number of each page key seen so far, plus one
+ * @param capacity the number of references and of pages there is room for, grown as needed
+ * @param key the page key
+ * @return true if the reference was added, else returns false if memory could not be allocated
+ * or the string is full
+ */
+static bool refs_add(opt_refs_t* refs, pagemap_t* map, size_t capacity[2], uint64_t key) {
+    bool success = refs->length < OPT_NEVER;
+    if (success && refs->length == capacity[0]) {
+        size_t grown = capacity[0] * 2;
+        uint32_t* more = realloc(refs->refs, grown * sizeof(uint32_t));
+        success = more != NULL;
+        if (success) {
+            refs->refs = more;
+            capacity[0] = grown;
+        }
+    }
+    uint64_t* page = success ? pagemap_insert(map, key) : NULL;
+    success = page != NULL;
+    if (success && *page == 0) {
+        // first reference to the page
+        if (refs->pages == capacity[1]) {
+            size_t grown = capacity[1] * 2;
+            uint64_t* more = realloc(refs->keys, grown * sizeof(uint64_t));
+            success = more != NULL;
+            if (success) {
+                refs->keys = more;
+                capacity[1] = grown;
+            }
+        }
+        if (success) {
+            refs->keys[refs->pages] = key;
+            *page = ++refs->pages;
+        }
+    }
+    if (success) {
+        refs->refs[refs->length++] = *page - 1;
+    }
+    return success;
+}
+
+/**
+ * A helper function that finds the next use of each reference with one backward pass, keeping
+ * the index of the latest reference seen to each page.
+ * @param refs the reference string
+ * @return true if the next uses were found, else returns false if memory could not be allocated
+ */
+static bool refs_next_use(opt_refs_t* refs) {
+    uint32_t* later = malloc(refs->pages * sizeof(uint32_t) + 1);
+    refs->next = malloc(refs->length * sizeof(uint32_t) + 1);
+    bool success = later != NULL && refs->next != NULL;
+    for (size_t p = 0; success && p < refs->pages; p++) {
+        later[p] = OPT_NEVER;
+    }
+    for (size_t i = refs->length; success && i > 0; i--) {
+        uint32_t page = refs->refs[i - 1];
+        refs->next[i - 1] = later[page];
+        later[page] = i - 1;
+    }
+    free(later);
+    return success;
+}
+
+opt_refs_t* opt_refs_load(const char* path) {
+    trace_t* trace = trace_open(path);
+    opt_refs_t* refs = calloc(1, sizeof(opt_refs_t));
+    pagemap_t* map = pagemap_alloc(1024);
+    size_t capacity[2] = {1 << 16, 1024};
+    bool success = trace != NULL && refs != NULL && map != NULL;
+    if (success) {
+        refs->refs = malloc(capacity[0] * sizeof(uint32_t));
+        refs->keys = malloc(capacity[1] * sizeof(uint64_t));
+        success = refs->refs != NULL && refs->keys != NULL;
+    }
+    size_t space = PAGETABLE_SIZE * PAGE_SIZE;
+    uint64_t asid = 0;
+    trace_rec_t rec;
+    while (success && trace_next(trace, &rec)) {
+        // the pages the span functions would touch, stopping at the end of the address space
+        vaddr_t vaddr = mk_vaddr(rec.vaddr);
+        size_t length = rec.length;
+        if (length > space - vaddr_value(vaddr)) {
+            length = space - vaddr_value(vaddr);
+        }
+        size_t pages = (vaddr.offset + length + PAGE_SIZE - 1) / PAGE_SIZE;
+        if (rec.op == TRACE_SWITCH) {
+            if (rec.vaddr < mm_space_count()) {
+                asid = rec.vaddr;
+            }
+        }
+        else if (rec.op == TRACE_FORK) {
+            fprintf(stderr, "opt: fork records are not supported\n");
+            success = false;
+        }
+        for (size_t p = 0; success && rec.op != TRACE_SWITCH && length > 0 && p < pages; p++) {
+            success = refs_add(refs, map, capacity, asid << ASID_SHIFT | (vaddr.pagenum + p));
+        }
+    }
+    // a trace that stops short of its end is truncated or corrupt
+    success = success && trace->pos == trace->size && refs_next_use(refs);
+    pagemap_free(map);
+    trace_close(trace);
+    if (!success) {
+        opt_refs_free(refs);
+        refs = NULL;
+    }
+    return refs;
+}
+
+void opt_refs_free(opt_refs_t* refs) {
+    if (refs != NULL) {
+        free(refs->refs);
+        free(refs->next);
+        free(refs->keys);
+        free(refs);
+    }
+}
+
+
+/**
+ * A helper function that swaps two entries of the heap.
+ * @param heap the heap
+ * @param a the position of one entry
+ * @param b the position of the other
+ */
+static void heap_swap(opt_heap_t* heap, size_t a, size_t b) {
+    uint32_t frame = heap->order[a];
+    heap->order[a] = heap->order[b];
+    heap->order[b] = frame;
+    heap->pos[heap->order[a]] = a;
+    heap->pos[heap->order[b]] = b;
+}
+
+/**
+ * A helper function that moves an entry towards the root while its next use is later than its
+ * parent's.
+ * @param heap the heap
+ * @param i the position of the entry
+ */
+static void heap_up(opt_heap_t* heap, size_t i) {
+    while (i > 0 && heap->next[heap->order[(i - 1) / 2]] < heap->next[heap->order[i]]) {
+        heap_swap(heap, i, (i - 1) / 2);
+        i = (i - 1) / 2;
+    }
+}
+
+/**
+ * A helper function that moves an entry away from the root while a child's next use is later
+ * than its own.
+ * @param heap the heap
+ * @param i the position of the entry
+ */
+static void heap_down(opt_heap_t* heap, size_t i) {
+    bool moved = true;
+    while (moved) {
+        size_t latest = i;
+        for (size_t c = 2 * i + 1; c <= 2 * i + 2 && c < heap->size; c++) {
+            if (heap->next[heap->order[c]] > heap->next[heap->order[latest]]) {
+                latest = c;
+            }
+        }
+        moved = latest != i;
+        if (moved) {
+            heap_swap(heap, i, latest);
+            i = latest;
+        }
+    }
+}
+
+bool opt_run(const opt_refs_t* refs, size_t frames, FILE* evictions, unsigned long* misses) {
+    // frames past one per page are never used
+    if (frames > refs->pages) {
+        frames = refs->pages;
+    }
+    opt_heap_t heap = {
+        .order = malloc(frames * sizeof(uint32_t) + 1),
+        .pos = malloc(frames * sizeof(uint32_t) + 1),
+        .next = malloc(frames * sizeof(uint32_t) + 1),
+        .page = malloc(frames * sizeof(uint32_t) + 1)
+    };
+    // the frame holding each page, or OPT_NEVER if it is not resident
+    uint32_t* frame_of = malloc(refs->pages * sizeof(uint32_t) + 1);
+    bool success = heap.order != NULL && heap.pos != NULL && heap.next != NULL
+                   && heap.page != NULL && frame_of != NULL;
+    for (size_t p = 0; success && p < refs->pages; p++) {
+        frame_of[p] = OPT_NEVER;
+    }
+    *misses = 0;
+    for (size_t i = 0; success && i < refs->length; i++) {
+        uint32_t page = refs->refs[i];
+        uint32_t frame = frame_of[page];
+        if (frame != OPT_NEVER) {
+            // a hit only pushes the page's next use later
+            heap.next[frame] = refs->next[i];
+            heap_up(&heap, heap.pos[frame]);
+        }
+        else if (heap.size < frames) {
+            // a free frame
+            frame = heap.size++;
+            heap.order[frame] = frame;
+            heap.pos[frame] = frame;
+            heap.next[frame] = refs->next[i];
+            heap.page[frame] = page;
+            heap_up(&heap, frame);
+            (*misses)++;
+        }
+        else {
+            // evict the page used furthest in the future, and load this one in its frame
+            frame = heap.order[0];
+            uint64_t victim = refs->keys[heap.page[frame]];
+            frame_of[heap.page[frame]] = OPT_NEVER;
+            if (evictions != NULL) {
+                success = fprintf(evictions, "%zu %lu %lu\n", i,
+                                  (unsigned long)(victim >> ASID_SHIFT),
+                                  (unsigned long)(victim & (((uint64_t)1 << ASID_SHIFT) - 1))) > 0;
+            }
+            heap.next[frame] = refs->next[i];
+            heap.page[frame] = page;
+            heap_down(&heap, 0);
+            (*misses)++;
+        }
+        frame_of[page] = frame;
+    }
+    free(heap.order);
+    free(heap.pos);
+    free(heap.next);
+    free(heap.page);
+    free(frame_of);
+    return success;
+}
+
+
+/**
+ * A helper function that switches to the address space of the given process, allocating its page
+ * table on first use with the layout of the running one, as sim_switch() does.
+ * @param current the page table of the running process
+ * @param pid the process to switch to
+ * @return the page table of the process, or NULL if the process number is not below the number of
+ * address spaces or its page table could not be allocated
+ */
+static pagetable_t* replay_switch(pagetable_t* current, uint64_t pid) {
+    pagetable_t* tbl = NULL;
+    if (pid < mm_space_count()) {
+        tbl = mm_space(pid);
+        if (tbl == NULL) {
+            tbl = pagetable_alloc_space(current->kind, pid);
+        }
+    }
+    return tbl;
+}
+
+bool opt_replay(const char* path, policy_kind_t kind, bool age_resident, mmu_stats_t* stats) {
+    trace_t* trace = trace_open(path);
+    bool success = trace != NULL && mm_mem_init() != NULL && mm_policy_init(kind)
+                   && mm_vmem_init(pagefile);
+    pagetable_t* tbl = success ? pagetable_alloc() : NULL;
+    success = tbl != NULL;
+    // grown to the longest read; a read never goes past the end of the address space
+    uint8_t* buf = NULL;
+    size_t buf_size = 0;
+    size_t space = PAGETABLE_SIZE * PAGE_SIZE;
+    trace_rec_t rec;
+    while (success && trace_next(trace, &rec)) {
+        // one aging tick per record, as in replay_trace()
+        pagetable_age(tbl, age_resident);
+        vaddr_t vaddr = mk_vaddr(rec.vaddr);
+        size_t length = rec.length;
+        if (length > space - vaddr_value(vaddr)) {
+            length = space - vaddr_value(vaddr);
+        }
+        if (rec.op == TRACE_SWITCH) {
+            pagetable_t* next = replay_switch(tbl, rec.vaddr);
+            if (next != NULL) {
+                tbl = next;
+            }
+        }
+        else if (rec.op == TRACE_FORK) {
+            success = false;
+        }
+        else if (rec.op == TRACE_READ) {
+            if (length > buf_size) {
+                uint8_t* grown = realloc(buf, length);
+                success = grown != NULL;
+                if (success) {
+                    buf = grown;
+                    buf_size = length;
+                }
+            }
+            if (success) {
+                mmu_read_span(pagefile, tbl, vaddr, buf, length);
+            }
+        }
+        else if (rec.op == TRACE_WRITE) {
+            mmu_write_span(pagefile, tbl, vaddr, rec.payload, length);
+        }
+        else {
+            mmu_fill_span(pagefile, tbl, vaddr, rec.fill, length);
+        }
+    }
+    // a trace that stops short of its end is truncated or corrupt
+    success = success && trace->pos == trace->size;
+    mm_stats(stats);
+    free(buf);
+
+    // tear the machine down for the next policy; the page file is left for it to reuse
+    for (asid_t asid = 0; asid < mm_space_count(); asid++) {
+        if (mm_space(asid) != NULL) {
+            pagetable_free(mm_space(asid));
+        }
+    }
+    mm_vmem_destroy();
+    mm_mem_destroy();
+    mm_stats_reset();
+    trace_close(trace);
+    return success;
+}
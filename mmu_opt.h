@@ -0,0 +1,108 @@
+/**
+ * @file mmu_opt.h
+ * @brief Declarations for mmu_opt, the optimal replacement oracle for recorded traces.
+ *
+ * mmu_opt reads a binary trace written by mmu_sim -o and computes the misses of Belady's optimal
+ * (MIN) replacement for the given geometry: on a miss with every frame full, the page evicted is
+ * the resident one whose next use is furthest away, or that is never used again.  The trace is
+ * first expanded into one reference per page touched, exactly as the span functions touch them,
+ * and a single backward pass gives each reference the index of the next reference to its page.
+ * A max-heap of the frames keyed by that index then finds each victim in logarithmic time, so
+ * the whole run is near linear in the length of the trace.  The same trace is then replayed
+ * through the MMU under each replacement policy, and the misses of each are reported against the
+ * optimum.
+ *
+ * @author ckurdelak20@georgefox.edu
+ */
+
+#ifndef MMU_NEW_MMU_OPT_H
+#define MMU_NEW_MMU_OPT_H
+
+#include <stdio.h>
+#include "mmu.h"
+
+#define OPT_NEVER  UINT32_MAX    /* next use of a page that is not used again */
+
+/**
+ * @struct opt_opts_t
+ * @brief Startup options for mmu_opt.
+ */
+typedef struct {
+    unsigned vaddr_bits;     /**< bits in a virtual address */
+    unsigned page_shift;     /**< log2 of the page size */
+    size_t frames;           /**< number of page frames */
+    size_t spaces;           /**< number of processes, each with its own address space */
+    bool age_resident;       /**< true to age only resident pages each tick of a replay */
+    unsigned policies;       /**< policies to replay the trace under, one bit per policy_kind_t */
+    char* evictions;         /**< file to write the optimal evictions to, or NULL */
+    char* trace;             /**< binary trace to analyze */
+} opt_opts_t;
+
+/**
+ * @struct opt_refs_t
+ * @brief The page reference string of a trace, with the next use of each reference.
+ *
+ * Pages are numbered densely in order of first reference; keys maps each back to its page key,
+ * with the ASID above ASID_SHIFT as page_key() builds it.
+ * @see opt_refs_load(), opt_refs_free().
+ */
+typedef struct {
+    uint32_t* refs;      /**< the page of each reference */
+    uint32_t* next;      /**< index of the next reference to the same page, or OPT_NEVER */
+    size_t length;       /**< number of references */
+    uint64_t* keys;      /**< the page key of each page */
+    size_t pages;        /**< number of distinct pages */
+} opt_refs_t;
+
+/**
+ * Reads the startup options from the command line.
+ * @param argc the number of command line arguments
+ * @param argv the command line arguments
+ * @param opts the options to be filled in; fields not given on the command line are left as is
+ * @return true if the command line was valid and named one trace, else returns false
+ */
+bool opt_get_opts(int argc, char* argv[], opt_opts_t* opts);
+
+/**
+ * Expands a binary trace into its page reference string, for the geometry and number of address
+ * spaces already set.  Each read, write or fill references every page it touches, once, in
+ * address order; switch records change the process as replay_trace() does, and switches to a
+ * process past the last are ignored.  Traces with fork records are not supported, since the pages
+ * a child shares with its parent are neither one's own.
+ * @param path the filename of the binary trace
+ * @return a pointer to the reference string, or NULL if the trace could not be read, is truncated,
+ * forks or holds OPT_NEVER or more references
+ */
+opt_refs_t* opt_refs_load(const char* path);
+
+/**
+ * @brief Frees the specified reference string from memory.
+ * @param refs the reference string to be freed from memory
+ */
+void opt_refs_free(opt_refs_t* refs);
+
+/**
+ * Runs optimal replacement over a reference string, starting with every frame free.
+ * @param refs the reference string
+ * @param frames the number of page frames
+ * @param evictions if not NULL, the file to write each eviction to, as a line holding the index of
+ * the reference that caused it, the ASID and the page number of the victim
+ * @param misses where to store the number of references that found their page not resident
+ * @return true if the run completed, else returns false if memory could not be allocated or an
+ * eviction could not be written
+ */
+bool opt_run(const opt_refs_t* refs, size_t frames, FILE* evictions, unsigned long* misses);
+
+/**
+ * Replays a binary trace through the MMU under the given replacement policy, on a machine of the
+ * geometry and number of address spaces already set, with one aging tick per record as
+ * replay_trace() does.  The machine is set up before the replay and torn down after it.
+ * @param path the filename of the binary trace
+ * @param kind the replacement policy
+ * @param age_resident true to age only resident pages each tick
+ * @param stats where to store the MMU counters at the end of the replay
+ * @return true if the whole trace was replayed, else returns false
+ */
+bool opt_replay(const char* path, policy_kind_t kind, bool age_resident, mmu_stats_t* stats);
+
+#endif /* MMU_NEW_MMU_OPT_H */
@@ -0,0 +1,426 @@
+/**
+ * @file mmu_pagefile.c
+ * @brief Backing page file implementation.
+ *
+ * @author ckurdelak20@georgefox.edu
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "mmu_pagefile.h"
+
+bool pagefile_create(const char* path, size_t size, pagefile_create_t create) {
+    bool success = false;
+    // truncate any old page file so no stale pages survive into this run
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd != -1) {
+        if (create == PAGEFILE_ZERO_FILL) {
+            // make contents of pages all zeros, one byte at a time
+            FILE* pg_file = fdopen(fd, "wb");
+            success = pg_file != NULL;
+            for (size_t i = 0; success && i < size; i++) {
+                success = fputc(0, pg_file) != EOF;
+            }
+            if (pg_file != NULL) {
+                success = fclose(pg_file) == 0 && success;
+            }
+            fd = -1;
+        }
+        else {
+            // extend to full size without writing; the holes read back as zeros
+            success = ftruncate(fd, size) == 0;
+            if (success && create == PAGEFILE_FALLOCATE) {
+                success = posix_fallocate(fd, 0, size) == 0;
+            }
+        }
+        if (fd != -1) {
+            success = close(fd) == 0 && success;
+        }
+    }
+    return success;
+}
+
+pagefile_t* pagefile_open(const char* path, const pagefile_opts_t* opts, size_t pages,
+                          bool slotted) {
+    pagefile_t* pf = malloc(sizeof(pagefile_t));
+    if (pf != NULL) {
+        pf->mode = opts->mode;
+        pf->path = strdup(path);
+        pf->fd = -1;
+        pf->map = NULL;
+        pf->size = 0;
+        pf->msync = opts->msync;
+        pf->msync_every = opts->msync_every;
+        pf->writes = 0;
+        pf->slots = NULL;
+        pf->next_slot = 0;
+        pf->pages = pages;
+        pf->zero_map = NULL;
+        pthread_mutex_init(&pf->lock, NULL);
+        bool success = pf->path != NULL;
+
+        if (success && slotted) {
+            // a slotted page file grows as it is written, so it cannot be mapped up front; a page
+            // without a slot is all zeros
+            pf->slots = pagemap_alloc(PAGE_FRAMES);
+            success = pf->slots != NULL && pf->mode != PAGEFILE_MMAP;
+        }
+        else if (success) {
+            // every page starts out all zeros
+            pf->zero_map = malloc((pages + 63) / 64 * sizeof(uint64_t));
+            success = pf->zero_map != NULL;
+            if (success) {
+                memset(pf->zero_map, 0xff, (pages + 63) / 64 * sizeof(uint64_t));
+            }
+        }
+
+        if (success && pf->mode != PAGEFILE_STDIO) {
+            pf->fd = open(path, O_RDWR);
+            success = pf->fd != -1;
+        }
+        if (success && pf->mode == PAGEFILE_MMAP) {
+            // map the whole file; the OS page cache takes care of writing it back
+            struct stat st;
+            success = fstat(pf->fd, &st) == 0 && st.st_size > 0;
+            if (success) {
+                pf->size = st.st_size;
+                pf->map = mmap(NULL, pf->size, PROT_READ | PROT_WRITE, MAP_SHARED, pf->fd, 0);
+                success = pf->map != MAP_FAILED;
+                if (!success) {
+                    pf->map = NULL;
+                }
+            }
+        }
+        if (!success) {
+            pagefile_close(pf);
+            pf = NULL;
+        }
+    }
+    return pf;
+}
+
+bool pagefile_sync(pagefile_t* pf) {
+    bool success = true;
+    if (pf->map != NULL) {
+        success = msync(pf->map, pf->size, MS_SYNC) == 0;
+        pthread_mutex_lock(&pf->lock);
+        pf->writes = 0;
+        pthread_mutex_unlock(&pf->lock);
+    }
+    return success;
+}
+
+void pagefile_close(pagefile_t* pf) {
+    if (pf != NULL) {
+        if (pf->map != NULL) {
+            if (pf->msync == MSYNC_HALT) {
+                pagefile_sync(pf);
+            }
+            munmap(pf->map, pf->size);
+        }
+        if (pf->fd != -1) {
+            close(pf->fd);
+        }
+        pagemap_free(pf->slots);
+        free(pf->zero_map);
+        pthread_mutex_destroy(&pf->lock);
+        free(pf->path);
+        free(pf);
+    }
+}
+
+/**
+ * A helper function that reads exactly one page at the given offset, retrying short or
+ * interrupted reads.  Anything past the end of the file reads as zeros.
+ * @param fd the file descriptor
+ * @param buf the buffer to read into
+ * @param offset the byte offset of the page
+ * @return true if the page was read, else returns false
+ */
+static bool pread_page(int fd, uint8_t* buf, off_t offset) {
+    size_t done = 0;
+    bool success = true;
+    while (success && done < PAGE_SIZE) {
+        ssize_t n = pread(fd, buf + done, PAGE_SIZE - done, offset + done);
+        if (n > 0) {
+            done += n;
+        }
+        else if (n == 0) {
+            // past end of file; the rest of the page is zero
+            memset(buf + done, 0, PAGE_SIZE - done);
+            done = PAGE_SIZE;
+        }
+        else if (errno != EINTR) {
+            success = false;
+        }
+    }
+    return success;
+}
+
+/**
+ * A helper function that writes exactly one page at the given offset, retrying short or
+ * interrupted writes.
+ * @param fd the file descriptor
+ * @param buf the buffer to be written
+ * @param offset the byte offset of the page
+ * @return true if the page was written, else returns false on an error or a write of no bytes
+ */
+static bool pwrite_page(int fd, const uint8_t* buf, off_t offset) {
+    size_t done = 0;
+    bool success = true;
+    while (success && done < PAGE_SIZE) {
+        ssize_t n = pwrite(fd, buf + done, PAGE_SIZE - done, offset + done);
+        if (n > 0) {
+            done += n;
+        }
+        else if (n == 0 || errno != EINTR) {
+            // a write that makes no progress would never finish
+            success = false;
+        }
+    }
+    return success;
+}
+
+/**
+ * A helper function that finds the byte offset of a page in the page file.  In a slotted page
+ * file, a page is given the next unused slot the first time it is written.
+ * @param pf the page file
+ * @param pagenum the number of the page
+ * @param allocate true if a page without a slot should be given one
+ * @param offset the byte offset of the page, set if the page has one
+ * @return true if the page has an offset, else returns false
+ */
+bool pagefile_offset(pagefile_t* pf, pagenum_t pagenum, bool allocate, off_t* offset) {
+    bool found = true;
+    if (pf->slots == NULL) {
+        *offset = (off_t)PAGE_SIZE * pagenum;
+    }
+    else {
+        pthread_mutex_lock(&pf->lock);
+        uint64_t* slot = pagemap_find(pf->slots, pagenum);
+        if (slot == NULL && allocate) {
+            size_t size = pf->slots->size;
+            slot = pagemap_insert(pf->slots, pagenum);
+            if (slot != NULL && pf->slots->size > size) {
+                *slot = pf->next_slot++;
+            }
+        }
+        found = slot != NULL;
+        if (found && allocate) {
+            // the page is about to be written
+            *slot &= ~SLOT_ZERO;
+        }
+        if (found) {
+            *offset = (off_t)PAGE_SIZE * (*slot & ~SLOT_ZERO);
+        }
+        pthread_mutex_unlock(&pf->lock);
+    }
+    return found;
+}
+
+bool pagefile_zero(pagefile_t* pf, pagenum_t pagenum) {
+    bool zero;
+    if (pf->slots == NULL) {
+        // other threads change other bits of the same word
+        uint64_t word = __atomic_load_n(&pf->zero_map[pagenum / 64], __ATOMIC_RELAXED);
+        zero = (word >> (pagenum % 64)) & 1;
+    }
+    else {
+        pthread_mutex_lock(&pf->lock);
+        const uint64_t* slot = pagemap_find(pf->slots, pagenum);
+        zero = slot == NULL || (*slot & SLOT_ZERO);
+        pthread_mutex_unlock(&pf->lock);
+    }
+    return zero;
+}
+
+void pagefile_discard(pagefile_t* pf, pagenum_t pagenum) {
+    if (pf->slots == NULL) {
+        __atomic_fetch_or(&pf->zero_map[pagenum / 64], 1ULL << (pagenum % 64), __ATOMIC_RELAXED);
+    }
+    else {
+        // the slot is kept for the next time the page is written
+        pthread_mutex_lock(&pf->lock);
+        uint64_t* slot = pagemap_find(pf->slots, pagenum);
+        if (slot != NULL) {
+            *slot |= SLOT_ZERO;
+        }
+        pthread_mutex_unlock(&pf->lock);
+    }
+}
+
+/**
+ * A helper function that finds the pages of a range whose bits are clear in the zero map of a page
+ * file that is not slotted, skipping whole words of pages that were never written.
+ * @param pf the page file
+ * @param first the number of the first page of the range
+ * @param count the number of pages in the range
+ * @param pages where to store the pages' numbers, or NULL to only count them
+ * @return the number of pages found
+ */
+static size_t zero_map_scan(const pagefile_t* pf, pagenum_t first, size_t count,
+                            pagenum_t* pages) {
+    size_t found = 0;
+    pagenum_t pagenum = first;
+    while (pagenum < first + count) {
+        uint64_t word = pf->zero_map[pagenum / 64];
+        if (pagenum % 64 == 0 && pagenum + 64 <= first + count && word == ~0ULL) {
+            pagenum += 64;
+        }
+        else {
+            if (!((word >> (pagenum % 64)) & 1)) {
+                if (pages != NULL) {
+                    pages[found] = pagenum;
+                }
+                found++;
+            }
+            pagenum++;
+        }
+    }
+    return found;
+}
+
+bool pagefile_pages(pagefile_t* pf, pagenum_t first, size_t count, pagenum_t** pages,
+                    size_t* found) {
+    pthread_mutex_lock(&pf->lock);
+    // a slotted page file holds at most one page per slot
+    size_t most = pf->slots != NULL ? pf->slots->size : zero_map_scan(pf, first, count, NULL);
+    *pages = most > 0 ? malloc(most * sizeof(pagenum_t)) : NULL;
+    *found = 0;
+    bool success = *pages != NULL || most == 0;
+    if (success && pf->slots != NULL) {
+        for (size_t i = 0; i < pf->slots->capacity; i++) {
+            pagenum_t pagenum = pf->slots->keys[i];
+            if (pf->slots->used[i] && pagenum >= first && pagenum - first < count
+                && !(pf->slots->values[i] & SLOT_ZERO)) {
+                (*pages)[(*found)++] = pagenum;
+            }
+        }
+    }
+    else if (success) {
+        *found = zero_map_scan(pf, first, count, *pages);
+    }
+    pthread_mutex_unlock(&pf->lock);
+    return success;
+}
+
+bool pagefile_save(pagefile_t* pf, FILE* out) {
+    bool success = true;
+    pthread_mutex_lock(&pf->lock);
+    if (pf->slots != NULL) {
+        // the next slot, then each written page and its slot
+        uint64_t counts[2] = {pf->next_slot, pf->slots->size};
+        success = image_put(out, counts, sizeof(counts));
+        for (size_t i = 0; success && i < pf->slots->capacity; i++) {
+            if (pf->slots->used[i]) {
+                uint64_t pair[2] = {pf->slots->keys[i], pf->slots->values[i]};
+                success = image_put(out, pair, sizeof(pair));
+            }
+        }
+    }
+    else {
+        success = image_put(out, pf->zero_map, (pf->pages + 63) / 64 * sizeof(uint64_t));
+    }
+    pthread_mutex_unlock(&pf->lock);
+    return success;
+}
+
+bool pagefile_restore(pagefile_t* pf, image_t* image) {
+    bool success;
+    struct stat st;
+    if (pf->slots != NULL) {
+        uint64_t counts[2];
+        success = image_get(image, counts, sizeof(counts));
+        pf->next_slot = success ? counts[0] : 0;
+        for (uint64_t i = 0; success && i < counts[1]; i++) {
+            uint64_t pair[2];
+            success = image_get(image, pair, sizeof(pair));
+            uint64_t* slot = success ? pagemap_insert(pf->slots, pair[0]) : NULL;
+            success = slot != NULL && (pair[1] & ~SLOT_ZERO) < pf->next_slot;
+            if (success) {
+                *slot = pair[1];
+            }
+        }
+    }
+    else {
+        success = image_get(image, pf->zero_map, (pf->pages + 63) / 64 * sizeof(uint64_t));
+    }
+    // a page file that does not reach the last slot, or was recreated, is not the one imaged
+    success = success && stat(pf->path, &st) == 0;
+    if (success) {
+        size_t size = pf->slots != NULL ? pf->next_slot * PAGE_SIZE : pf->pages * PAGE_SIZE;
+        success = pf->slots != NULL ? (size_t)st.st_size >= size : (size_t)st.st_size == size;
+    }
+    return success;
+}
+
+bool pagefile_read(pagefile_t* pf, pagenum_t pagenum, frame_t* frame) {
+    bool success = false;
+    off_t offset;
+
+    if (pagefile_zero(pf, pagenum) || !pagefile_offset(pf, pagenum, false, &offset)) {
+        // never written, or discarded, so all zeros
+        memset(frame->bytes, 0, PAGE_SIZE);
+        success = true;
+    }
+    else if (pf->mode == PAGEFILE_MMAP) {
+        success = (size_t)offset + PAGE_SIZE <= pf->size;
+        if (success) {
+            memcpy(frame->bytes, pf->map + offset, PAGE_SIZE);
+        }
+    }
+    else if (pf->mode == PAGEFILE_PIO) {
+        success = pread_page(pf->fd, frame->bytes, offset);
+    }
+    else {
+        FILE* pg_file = fopen(pf->path, "rb");
+        if (pg_file != NULL) {
+            fseek(pg_file, offset, SEEK_SET);
+            success = fread(frame, 1, PAGE_SIZE, pg_file) == PAGE_SIZE;
+            fclose(pg_file);
+        }
+    }
+    return success;
+}
+
+bool pagefile_write(pagefile_t* pf, pagenum_t pagenum, const frame_t* frame) {
+    bool success = false;
+    off_t offset;
+    // a page without a slot is given one here
+    bool found = pagefile_offset(pf, pagenum, true, &offset);
+    if (pf->zero_map != NULL) {
+        __atomic_fetch_and(&pf->zero_map[pagenum / 64], ~(1ULL << (pagenum % 64)),
+                           __ATOMIC_RELAXED);
+    }
+
+    if (found && pf->mode == PAGEFILE_MMAP) {
+        success = (size_t)offset + PAGE_SIZE <= pf->size;
+        if (success) {
+            memcpy(pf->map + offset, frame->bytes, PAGE_SIZE);
+            pthread_mutex_lock(&pf->lock);
+            pf->writes++;
+            bool flush = pf->msync == MSYNC_EVERY && pf->writes >= pf->msync_every;
+            pthread_mutex_unlock(&pf->lock);
+            if (flush) {
+                success = pagefile_sync(pf);
+            }
+        }
+    }
+    else if (found && pf->mode == PAGEFILE_PIO) {
+        success = pwrite_page(pf->fd, frame->bytes, offset);
+    }
+    else if (found) {
+        FILE* pg_file = fopen(pf->path, "rb+");
+        if (pg_file != NULL) {
+            fseek(pg_file, offset, SEEK_SET);
+            success = fwrite(frame, 1, PAGE_SIZE, pg_file) == PAGE_SIZE;
+            fclose(pg_file);
+        }
+    }
+    return success;
+}
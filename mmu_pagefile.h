@@ -0,0 +1,161 @@
+/**
+ * @file mmu_pagefile.h
+ * @brief Declarations for the backing page file used by the MMU.
+ *
+ * The page file is opened once by mm_vmem_init() and held for the whole simulation, so that page
+ * loads and evictions only pay for the transfer itself rather than an open/seek/close per fault.
+ *
+ * A page file for an address space larger than PAGEFILE_DIRECT_MAX is slotted: rather than
+ * holding every page at its own offset, it starts empty and each page is appended to the next
+ * slot the first time it is written.  Pages never written read back as zeros.  A slotted page file
+ * cannot be memory-mapped.
+ *
+ * The page file remembers which pages it holds only zeros for: every page when it is created, and
+ * later any page discarded rather than written because its bytes were all zeros.  Such pages are
+ * read by zeroing the frame, without any I/O.
+ *
+ * What the page file remembers of its pages can be saved in a checkpoint image and restored over a
+ * page file reopened in place, so that a later run picks up the pages it holds.
+ *
+ * Pages may be read and written by several threads at once, as long as no two transfer the same
+ * page at the same time.
+ *
+ * @author ckurdelak20@georgefox.edu
+ */
+
+#ifndef MMU_PAGEFILE_H
+#define MMU_PAGEFILE_H
+
+#include <pthread.h>
+#include "mmu.h"
+#include "mmu_image.h"
+
+#define PAGEFILE_DIRECT_MAX  (1ULL << 40)    /* largest page file laid out page by page */
+#define SLOT_ZERO            (1ULL << 63)    /* set in the slot of a page discarded as all zeros */
+
+/**
+ * @struct pagefile_t
+ * @brief An open backing page file.
+ * @see pagefile_open(), pagefile_close().
+ */
+typedef struct {
+    pagefile_mode_t mode;    /**< how pages are transferred */
+    char* path;              /**< filename of the page file */
+    int fd;                  /**< open file descriptor (PAGEFILE_PIO and PAGEFILE_MMAP) */
+    uint8_t* map;            /**< the mapped page file (PAGEFILE_MMAP only) */
+    size_t size;             /**< size of the mapping in bytes */
+    msync_policy_t msync;    /**< flush policy for the mapping */
+    unsigned long msync_every;  /**< write-backs between flushes */
+    unsigned long writes;    /**< write-backs since the last flush */
+    pagemap_t* slots;        /**< slot of each written page, or NULL if not slotted */
+    size_t next_slot;        /**< next unused slot */
+    size_t pages;            /**< number of pages the page file holds */
+    uint64_t* zero_map;      /**< bit per page, set while it holds only zeros (not slotted) */
+    pthread_mutex_t lock;    /**< guards the slots and the write-back count across threads */
+} pagefile_t;
+
+/**
+ * Creates a page file of the given size, overwriting any existing file, with every byte reading
+ * back as zero.
+ * @param path the filename of the page file
+ * @param size the size of the page file in bytes
+ * @param create how the page file is zeroed
+ * @return true if the page file was created successfully, else returns false
+ */
+bool pagefile_create(const char* path, size_t size, pagefile_create_t create);
+
+/**
+ * Opens an existing page file with the given options.  Every page is taken to hold only zeros, as
+ * a page file just created by pagefile_create() does.
+ * @param path the filename of the page file
+ * @param opts the page file options
+ * @param pages the number of pages the page file holds
+ * @param slotted true if pages are stored in slots in the order they are first written
+ * @return a pointer to the open page file, or NULL if it could not be opened
+ */
+pagefile_t* pagefile_open(const char* path, const pagefile_opts_t* opts, size_t pages,
+                          bool slotted);
+
+/**
+ * @brief Flushes a memory-mapped page file to disk; does nothing in the other modes.
+ * @param pf the page file
+ * @return true if the page file was flushed, else returns false
+ */
+bool pagefile_sync(pagefile_t* pf);
+
+/**
+ * @brief Closes the given page file and frees it from memory.
+ *
+ * A memory-mapped page file is flushed first if its policy is MSYNC_HALT.
+ * @param pf the page file to be closed
+ */
+void pagefile_close(pagefile_t* pf);
+
+/**
+ * @brief Returns true if the page file holds only zeros for the specified page.
+ * @param pf the page file
+ * @param pagenum the number of the page
+ * @return true if the page is all zeros, so that reading it needs no I/O
+ */
+bool pagefile_zero(pagefile_t* pf, pagenum_t pagenum);
+
+/**
+ * Records that the specified page now holds only zeros, in place of writing it.  The page reads
+ * back as zeros until it is next written.
+ * @param pf the page file
+ * @param pagenum the number of the page
+ */
+void pagefile_discard(pagefile_t* pf, pagenum_t pagenum);
+
+/**
+ * Lists the pages of a range that the page file may hold other than zeros for: those written and
+ * not discarded since.
+ * @param pf the page file
+ * @param first the number of the first page of the range
+ * @param count the number of pages in the range
+ * @param pages where to store a dynamically allocated array of the pages' numbers, in no
+ * particular order, to be freed by the caller; NULL if there are none
+ * @param found where to store the number of pages listed
+ * @return true if the pages were listed, else returns false if memory could not be allocated
+ */
+bool pagefile_pages(pagefile_t* pf, pagenum_t first, size_t count, pagenum_t** pages,
+                    size_t* found);
+
+/**
+ * @brief Writes the page file's record of its pages, its slots or which pages are zeros, to an
+ * image.
+ * @param pf the page file
+ * @param out the image file to write to
+ * @return true if the record was written, else returns false
+ */
+bool pagefile_save(pagefile_t* pf, FILE* out);
+
+/**
+ * Reads the page file's record of its pages back from an image, over a page file just opened in
+ * place.  The page file must be the one the image was taken with, laid out the same way, and must
+ * not have changed since.
+ * @param pf the page file
+ * @param image the image, positioned at the record
+ * @return true if the record was read and fits the page file, else returns false
+ */
+bool pagefile_restore(pagefile_t* pf, image_t* image);
+
+/**
+ * @brief Reads the specified page from the page file into the given frame.
+ * @param pf the page file
+ * @param pagenum the number of the page to be read
+ * @param frame the frame to read the page into
+ * @return true if the whole page was read, else returns false
+ */
+bool pagefile_read(pagefile_t* pf, pagenum_t pagenum, frame_t* frame);
+
+/**
+ * @brief Writes the given frame to the specified page of the page file.
+ * @param pf the page file
+ * @param pagenum the number of the page to be written
+ * @param frame the frame holding the page
+ * @return true if the whole page was written, else returns false
+ */
+bool pagefile_write(pagefile_t* pf, pagenum_t pagenum, const frame_t* frame);
+
+#endif /* MMU_PAGEFILE_H */
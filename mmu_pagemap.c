@@ -0,0 +1,150 @@
+/**
+ * @file mmu_pagemap.c
+ * @brief Page map implementation.
+ *
+ * @author ckurdelak20@georgefox.edu
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "mmu_pagemap.h"
+
+#define PAGEMAP_MIN_CAPACITY    16
+
+/**
+ * A helper function that returns the home slot of a key.  Multiplying by 2^64 divided by the
+ * golden ratio spreads runs of consecutive page numbers across the whole table.
+ * @param map the page map
+ * @param key the key
+ * @return the slot at which probing for the key starts
+ */
+static size_t pagemap_home(const pagemap_t* map, uint64_t key) {
+    return (key * 0x9e3779b97f4a7c15ULL) >> map->shift;
+}
+
+/**
+ * A helper function that allocates the slots of a page map.
+ * @param map the page map
+ * @param capacity the number of slots, a power of two
+ * @return true if the slots could be allocated, else returns false
+ */
+static bool pagemap_slots(pagemap_t* map, size_t capacity) {
+    map->keys = malloc(capacity * sizeof(uint64_t));
+    map->values = malloc(capacity * sizeof(uint64_t));
+    map->used = calloc(capacity, sizeof(uint8_t));
+    map->capacity = capacity;
+    map->size = 0;
+    map->shift = 64 - __builtin_ctzll(capacity);
+    return map->keys != NULL && map->values != NULL && map->used != NULL;
+}
+
+pagemap_t* pagemap_alloc(size_t entries) {
+    pagemap_t* map = malloc(sizeof(pagemap_t));
+    if (map != NULL) {
+        // at most half full
+        size_t capacity = PAGEMAP_MIN_CAPACITY;
+        while (capacity < 2 * entries) {
+            capacity <<= 1;
+        }
+        if (!pagemap_slots(map, capacity)) {
+            pagemap_free(map);
+            map = NULL;
+        }
+    }
+    return map;
+}
+
+void pagemap_free(pagemap_t* map) {
+    if (map != NULL) {
+        free(map->keys);
+        free(map->values);
+        free(map->used);
+        free(map);
+    }
+}
+
+uint64_t* pagemap_find(const pagemap_t* map, uint64_t key) {
+    uint64_t* value = NULL;
+    size_t mask = map->capacity - 1;
+    for (size_t i = pagemap_home(map, key); value == NULL && map->used[i]; i = (i + 1) & mask) {
+        if (map->keys[i] == key) {
+            value = &map->values[i];
+        }
+    }
+    return value;
+}
+
+/**
+ * A helper function that doubles the number of slots of a page map and rehashes its entries.
+ * @param map the page map
+ * @return true if the map grew, else returns false and leaves the map as it was
+ */
+static bool pagemap_grow(pagemap_t* map) {
+    pagemap_t old = *map;
+    bool success = pagemap_slots(map, old.capacity * 2);
+    if (success) {
+        for (size_t i = 0; i < old.capacity; i++) {
+            if (old.used[i]) {
+                *pagemap_insert(map, old.keys[i]) = old.values[i];
+            }
+        }
+        free(old.keys);
+        free(old.values);
+        free(old.used);
+    }
+    else {
+        free(map->keys);
+        free(map->values);
+        free(map->used);
+        *map = old;
+    }
+    return success;
+}
+
+uint64_t* pagemap_insert(pagemap_t* map, uint64_t key) {
+    uint64_t* value = pagemap_find(map, key);
+    if (value == NULL && (2 * (map->size + 1) <= map->capacity || pagemap_grow(map))) {
+        size_t mask = map->capacity - 1;
+        size_t i = pagemap_home(map, key);
+        while (map->used[i]) {
+            i = (i + 1) & mask;
+        }
+        map->used[i] = 1;
+        map->keys[i] = key;
+        map->values[i] = 0;
+        map->size++;
+        value = &map->values[i];
+    }
+    return value;
+}
+
+bool pagemap_remove(pagemap_t* map, uint64_t key) {
+    uint64_t* value = pagemap_find(map, key);
+    if (value != NULL) {
+        size_t mask = map->capacity - 1;
+        size_t hole = value - map->values;
+        map->used[hole] = 0;
+        map->size--;
+        // shift back any later entry of the run that can no longer be reached past the hole
+        for (size_t i = (hole + 1) & mask; map->used[i]; i = (i + 1) & mask) {
+            size_t home = pagemap_home(map, map->keys[i]);
+            if (((i - home) & mask) >= ((i - hole) & mask)) {
+                map->keys[hole] = map->keys[i];
+                map->values[hole] = map->values[i];
+                map->used[hole] = 1;
+                map->used[i] = 0;
+                hole = i;
+            }
+        }
+    }
+    return value != NULL;
+}
+
+void pagemap_clear(pagemap_t* map) {
+    memset(map->used, 0, map->capacity);
+    map->size = 0;
+}
+
+size_t pagemap_bytes(const pagemap_t* map) {
+    return sizeof(pagemap_t) + map->capacity * (2 * sizeof(uint64_t) + sizeof(uint8_t));
+}
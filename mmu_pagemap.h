@@ -0,0 +1,87 @@
+/**
+ * @file mmu_pagemap.h
+ * @brief Function prototypes for the page map, a hash table keyed by page number.
+ *
+ * A page map holds a 64-bit value for each of a sparse set of 64-bit keys, so per-page state can
+ * be kept for only the pages that were touched, however large the virtual address space is.  It
+ * is an open-addressing table with linear probing, kept at most half full.
+ *
+ * @author ckurdelak20@georgefox.edu
+ */
+
+#ifndef MMU_PAGEMAP_H
+#define MMU_PAGEMAP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @struct pagemap_t
+ * @brief A hash table from page numbers to 64-bit values.
+ *
+ * To visit every entry, walk the slots from 0 to capacity and skip those that are not used.
+ * @see pagemap_alloc(), pagemap_free().
+ */
+typedef struct {
+    uint64_t* keys;       /**< key of each slot */
+    uint64_t* values;     /**< value of each slot */
+    uint8_t* used;        /**< true if the slot holds an entry */
+    size_t capacity;      /**< number of slots, a power of two */
+    size_t size;          /**< number of entries */
+    unsigned shift;       /**< right shift that turns a hash into a slot */
+} pagemap_t;
+
+/**
+ * @brief Dynamically allocates a new, empty page map.
+ * @param entries the number of entries expected; the map grows past it as needed
+ * @return a pointer to the new page map, or NULL if it could not be allocated
+ */
+pagemap_t* pagemap_alloc(size_t entries);
+
+/**
+ * @brief Frees the specified page map from memory.
+ * @param map the page map to be freed from memory
+ */
+void pagemap_free(pagemap_t* map);
+
+/**
+ * @brief Finds the value of a key.
+ * @param map the page map
+ * @param key the key
+ * @return a pointer to the value, valid until the next insertion or removal, or NULL if the key is
+ * not in the map
+ */
+uint64_t* pagemap_find(const pagemap_t* map, uint64_t key);
+
+/**
+ * @brief Finds the value of a key, adding the key with a value of zero if it is not in the map.
+ * @param map the page map
+ * @param key the key
+ * @return a pointer to the value, valid until the next insertion or removal, or NULL if the map
+ * had to grow and could not
+ */
+uint64_t* pagemap_insert(pagemap_t* map, uint64_t key);
+
+/**
+ * @brief Removes a key from the map.
+ * @param map the page map
+ * @param key the key
+ * @return true if the key was in the map, else returns false
+ */
+bool pagemap_remove(pagemap_t* map, uint64_t key);
+
+/**
+ * @brief Removes every entry from the map, keeping its capacity.
+ * @param map the page map
+ */
+void pagemap_clear(pagemap_t* map);
+
+/**
+ * @brief Returns the number of bytes of memory held by the map.
+ * @param map the page map
+ * @return the size of the map in bytes
+ */
+size_t pagemap_bytes(const pagemap_t* map);
+
+#endif /* MMU_PAGEMAP_H */
@@ -0,0 +1,660 @@
+/**
+ * @file mmu_policy.c
+ * @brief Page replacement policies: CLOCK, LRU, WSClock, ARC and 2Q.
+ *
+ * The list-based policies keep their pages on doubly linked lists of pooled links, found through
+ * a hash index by page key, so every hook is O(1) and the memory of a policy scales with the
+ * number of frames rather than the size of the address space.  A page is on at most one list of a
+ * policy at a time.  Pages are keyed by page_key() and victims found through the frames the
+ * policies remember, so one policy can serve every address space sharing the frames.
+ *
+ * @author ckurdelak20@georgefox.edu
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include "mmu_policy.h"
+
+#define NIL SIZE_MAX    /* end of a list */
+
+/**
+ * @struct plist_t
+ * @brief A list of pages, most recently inserted at the head.
+ */
+typedef struct {
+    size_t head;    /**< link of the most recent page, or NIL */
+    size_t tail;    /**< link of the least recent page, or NIL */
+    size_t size;    /**< number of pages on the list */
+} plist_t;
+
+/**
+ * @struct pnodes_t
+ * @brief A pool of links shared by all the lists of one policy, with an index from page to link.
+ *
+ * Only the pages a policy is tracking have a link, so the pool is sized to the policy's lists
+ * rather than to the virtual address space.
+ */
+typedef struct {
+    size_t* prev;         /**< previous (more recent) link, or NIL */
+    size_t* next;         /**< next (less recent) link, or NIL; chains the free links */
+    uint8_t* where;       /**< index of the list holding the link */
+    uint64_t* page;       /**< page key of each link */
+    framenum_t* frame;    /**< frame of each link's page when it was last pushed */
+    size_t free;          /**< first unused link, or NIL */
+    pagemap_t* index;     /**< link of each tracked page */
+} pnodes_t;
+
+/**
+ * A helper function that allocates a pool of links.
+ * @param nodes the links to be allocated
+ * @param count the most pages the policy's lists can hold at once
+ * @return true if the links could be allocated, else returns false
+ */
+bool pnodes_alloc(pnodes_t* nodes, size_t count) {
+    nodes->prev = malloc(count * sizeof(size_t));
+    nodes->next = malloc(count * sizeof(size_t));
+    nodes->where = calloc(count, sizeof(uint8_t));
+    nodes->page = malloc(count * sizeof(uint64_t));
+    nodes->frame = malloc(count * sizeof(framenum_t));
+    nodes->index = pagemap_alloc(count);
+    bool ok = nodes->prev != NULL && nodes->next != NULL && nodes->where != NULL
+              && nodes->page != NULL && nodes->frame != NULL && nodes->index != NULL;
+    if (ok) {
+        for (size_t i = 0; i < count; i++) {
+            nodes->next[i] = i + 1 < count ? i + 1 : NIL;
+        }
+        nodes->free = count > 0 ? 0 : NIL;
+    }
+    return ok;
+}
+
+/**
+ * A helper function that frees the links of a policy.
+ * @param nodes the links to be freed
+ */
+void pnodes_free(pnodes_t* nodes) {
+    free(nodes->prev);
+    free(nodes->next);
+    free(nodes->where);
+    free(nodes->page);
+    free(nodes->frame);
+    pagemap_free(nodes->index);
+}
+
+/**
+ * A helper function that finds the list holding a page.
+ * @param nodes the links
+ * @param page the page key
+ * @return the index of the list holding the page, or 0 if none
+ */
+uint8_t pnodes_where(const pnodes_t* nodes, uint64_t page) {
+    const uint64_t* node = pagemap_find(nodes->index, page);
+    return node != NULL ? nodes->where[*node] : 0;
+}
+
+/**
+ * A helper function that empties the specified list.
+ * @param list the list
+ */
+void plist_init(plist_t* list) {
+    list->head = NIL;
+    list->tail = NIL;
+    list->size = 0;
+}
+
+/**
+ * A helper function that finds the most recent page of a list.
+ * @param nodes the links
+ * @param list the list
+ * @return the page key, or NIL if the list is empty
+ */
+uint64_t plist_head(const pnodes_t* nodes, const plist_t* list) {
+    return list->head != NIL ? nodes->page[list->head] : NIL;
+}
+
+/**
+ * A helper function that finds the frame of the least recent page of a list.
+ * @param nodes the links
+ * @param list the list
+ * @param framenum where to store the frame
+ * @return true if the list has a page, else returns false
+ */
+bool plist_tail_frame(const pnodes_t* nodes, const plist_t* list, framenum_t* framenum) {
+    bool found = list->tail != NIL;
+    if (found) {
+        *framenum = nodes->frame[list->tail];
+    }
+    return found;
+}
+
+/**
+ * A helper function that inserts a page at the head of a list.  If the pool is exhausted the page
+ * is left untracked.
+ * @param nodes the links
+ * @param list the list
+ * @param id the index of the list, stored in the page's link
+ * @param page the page key, which must not be on any list
+ * @param framenum the frame holding the page, if it is resident
+ */
+void plist_push(pnodes_t* nodes, plist_t* list, uint8_t id, uint64_t page, framenum_t framenum) {
+    size_t node = nodes->free;
+    uint64_t* slot = node != NIL ? pagemap_insert(nodes->index, page) : NULL;
+    if (slot != NULL) {
+        *slot = node;
+        nodes->free = nodes->next[node];
+        nodes->page[node] = page;
+        nodes->frame[node] = framenum;
+        nodes->prev[node] = NIL;
+        nodes->next[node] = list->head;
+        if (list->head != NIL) {
+            nodes->prev[list->head] = node;
+        }
+        else {
+            list->tail = node;
+        }
+        list->head = node;
+        nodes->where[node] = id;
+        list->size++;
+    }
+}
+
+/**
+ * A helper function that unlinks a link from the list holding it and returns it to the pool.
+ * @param nodes the links
+ * @param list the list holding the link
+ * @param node the link
+ */
+void plist_unlink(pnodes_t* nodes, plist_t* list, size_t node) {
+    if (nodes->prev[node] != NIL) {
+        nodes->next[nodes->prev[node]] = nodes->next[node];
+    }
+    else {
+        list->head = nodes->next[node];
+    }
+    if (nodes->next[node] != NIL) {
+        nodes->prev[nodes->next[node]] = nodes->prev[node];
+    }
+    else {
+        list->tail = nodes->prev[node];
+    }
+    pagemap_remove(nodes->index, nodes->page[node]);
+    nodes->where[node] = 0;
+    nodes->next[node] = nodes->free;
+    nodes->free = node;
+    list->size--;
+}
+
+/**
+ * A helper function that unlinks a page from the list holding it.
+ * @param nodes the links
+ * @param list the list holding the page
+ * @param page the page key
+ */
+void plist_remove(pnodes_t* nodes, plist_t* list, uint64_t page) {
+    uint64_t* node = pagemap_find(nodes->index, page);
+    if (node != NULL) {
+        plist_unlink(nodes, list, *node);
+    }
+}
+
+/**
+ * A helper function that removes the least recent page of a list.
+ * @param nodes the links
+ * @param list the list
+ * @return the page key, or NIL if the list is empty
+ */
+uint64_t plist_pop(pnodes_t* nodes, plist_t* list) {
+    size_t node = list->tail;
+    uint64_t page = NIL;
+    if (node != NIL) {
+        page = nodes->page[node];
+        plist_unlink(nodes, list, node);
+    }
+    return page;
+}
+
+/*
+ * CLOCK: the frames form a circle; each has a reference bit set on access.  The hand clears set
+ * bits as it passes and stops at the first frame whose bit is already clear.
+ */
+
+/**
+ * @struct clock_state_t
+ * @brief The state of the CLOCK and WSClock policies.
+ */
+typedef struct {
+    uint8_t* ref;         /**< reference bit of each frame */
+    uint8_t* occupied;    /**< true if the frame holds a page */
+    pagenum_t* page;      /**< page held by each frame */
+    pagetable_t** owner;  /**< page table of the page held by each frame */
+    size_t* last_use;     /**< tick of each frame's last use (WSClock only) */
+    size_t frames;        /**< number of frames */
+    size_t hand;          /**< next frame to be inspected */
+    size_t now;           /**< current tick (WSClock only) */
+} clock_state_t;
+
+void* clock_create(size_t frames, size_t pages) {
+    clock_state_t* clock = calloc(1, sizeof(clock_state_t));
+    if (clock != NULL) {
+        clock->ref = calloc(frames, sizeof(uint8_t));
+        clock->occupied = calloc(frames, sizeof(uint8_t));
+        clock->page = calloc(frames, sizeof(pagenum_t));
+        clock->owner = calloc(frames, sizeof(pagetable_t*));
+        clock->last_use = calloc(frames, sizeof(size_t));
+        clock->frames = frames;
+        if (clock->ref == NULL || clock->occupied == NULL || clock->page == NULL
+            || clock->owner == NULL || clock->last_use == NULL) {
+            free(clock->ref);
+            free(clock->occupied);
+            free(clock->page);
+            free(clock->owner);
+            free(clock->last_use);
+            free(clock);
+            clock = NULL;
+        }
+    }
+    return clock;
+}
+
+void clock_destroy(void* state) {
+    clock_state_t* clock = state;
+    if (clock != NULL) {
+        free(clock->ref);
+        free(clock->occupied);
+        free(clock->page);
+        free(clock->owner);
+        free(clock->last_use);
+        free(clock);
+    }
+}
+
+void clock_access(void* state, pagetable_t* tbl, pagenum_t pagenum, framenum_t framenum) {
+    clock_state_t* clock = state;
+    clock->ref[framenum] = 1;
+    clock->occupied[framenum] = 1;
+    clock->page[framenum] = pagenum;
+    clock->owner[framenum] = tbl;
+    clock->last_use[framenum] = clock->now;
+}
+
+void clock_evict(void* state, pagetable_t* tbl, pagenum_t pagenum, framenum_t framenum) {
+    clock_state_t* clock = state;
+    clock->ref[framenum] = 0;
+    clock->occupied[framenum] = 0;
+}
+
+bool clock_victim(void* state, pagetable_t* tbl, pagenum_t pagenum, framenum_t* framenum) {
+    clock_state_t* clock = state;
+    bool found = false;
+    // two turns are enough: the first clears every reference bit
+    for (size_t i = 0; i < 2 * clock->frames && !found; i++) {
+        size_t frame = clock->hand;
+        clock->hand = (clock->hand + 1) % clock->frames;
+        if (clock->occupied[frame]) {
+            if (clock->ref[frame]) {
+                clock->ref[frame] = 0;
+            }
+            else {
+                *framenum = frame;
+                found = true;
+            }
+        }
+    }
+    return found;
+}
+
+
+/*
+ * WSClock: CLOCK over the same circle, but a page whose reference bit is clear is only evicted
+ * once it has gone unused for WSCLOCK_TAU ticks, and clean pages go before dirty ones, which
+ * would cost a write-back.
+ */
+
+void wsclock_tick(void* state, pagetable_t* tbl) {
+    clock_state_t* clock = state;
+    clock->now++;
+}
+
+bool wsclock_victim(void* state, pagetable_t* tbl, pagenum_t pagenum, framenum_t* framenum) {
+    clock_state_t* clock = state;
+    size_t oldest = NIL;
+    size_t old_dirty = NIL;
+    bool found = false;
+    for (size_t i = 0; i < 2 * clock->frames && !found; i++) {
+        size_t frame = clock->hand;
+        clock->hand = (clock->hand + 1) % clock->frames;
+        if (clock->occupied[frame]) {
+            if (clock->ref[frame]) {
+                // still in the working set
+                clock->ref[frame] = 0;
+                clock->last_use[frame] = clock->now;
+            }
+            else {
+                if (clock->now - clock->last_use[frame] > WSCLOCK_TAU) {
+                    if (!pte_dirty(clock->owner[frame], clock->page[frame])) {
+                        *framenum = frame;
+                        found = true;
+                    }
+                    else if (old_dirty == NIL) {
+                        old_dirty = frame;
+                    }
+                }
+                if (oldest == NIL || clock->last_use[frame] < clock->last_use[oldest]) {
+                    oldest = frame;
+                }
+            }
+        }
+    }
+    // no clean page outside the working set; settle for a dirty one, then the oldest
+    if (!found && (old_dirty != NIL || oldest != NIL)) {
+        *framenum = old_dirty != NIL ? old_dirty : oldest;
+        clock->hand = (*framenum + 1) % clock->frames;
+        found = true;
+    }
+    return found;
+}
+
+
+/*
+ * LRU: resident pages on one list, moved to the head on every access.
+ */
+
+/**
+ * @struct lru_state_t
+ * @brief The state of the LRU policy.
+ */
+typedef struct {
+    pnodes_t nodes;      /**< links of the resident pages */
+    plist_t resident;    /**< resident pages, most recently used first */
+} lru_state_t;
+
+void* lru_create(size_t frames, size_t pages) {
+    lru_state_t* lru = calloc(1, sizeof(lru_state_t));
+    if (lru != NULL) {
+        plist_init(&lru->resident);
+        if (!pnodes_alloc(&lru->nodes, frames)) {
+            pnodes_free(&lru->nodes);
+            free(lru);
+            lru = NULL;
+        }
+    }
+    return lru;
+}
+
+void lru_destroy(void* state) {
+    lru_state_t* lru = state;
+    if (lru != NULL) {
+        pnodes_free(&lru->nodes);
+        free(lru);
+    }
+}
+
+void lru_access(void* state, pagetable_t* tbl, pagenum_t pagenum, framenum_t framenum) {
+    lru_state_t* lru = state;
+    uint64_t key = page_key(tbl, pagenum);
+    if (plist_head(&lru->nodes, &lru->resident) != key) {
+        if (pnodes_where(&lru->nodes, key)) {
+            plist_remove(&lru->nodes, &lru->resident, key);
+        }
+        plist_push(&lru->nodes, &lru->resident, 1, key, framenum);
+    }
+}
+
+void lru_evict(void* state, pagetable_t* tbl, pagenum_t pagenum, framenum_t framenum) {
+    lru_state_t* lru = state;
+    uint64_t key = page_key(tbl, pagenum);
+    if (pnodes_where(&lru->nodes, key)) {
+        plist_remove(&lru->nodes, &lru->resident, key);
+    }
+}
+
+bool lru_victim(void* state, pagetable_t* tbl, pagenum_t pagenum, framenum_t* framenum) {
+    lru_state_t* lru = state;
+    return plist_tail_frame(&lru->nodes, &lru->resident, framenum);
+}
+
+
+/*
+ * ARC (Megiddo and Modha): T1 holds pages seen once recently and T2 pages seen at least twice.
+ * B1 and B2 remember pages recently evicted from each.  A fault on a page remembered in B1 grows
+ * the target size p of T1; one remembered in B2 shrinks it.
+ */
+
+enum { ARC_T1 = 1, ARC_T2, ARC_B1, ARC_B2, ARC_LISTS };
+
+/**
+ * @struct arc_state_t
+ * @brief The state of the ARC policy.
+ */
+typedef struct {
+    pnodes_t nodes;             /**< links of the pages on the lists */
+    plist_t lists[ARC_LISTS];   /**< T1, T2, B1 and B2, indexed by the enum above */
+    size_t c;                   /**< cache size, in frames */
+    size_t p;                   /**< target size of T1 */
+    bool from_b2;               /**< true if the faulting page is remembered in B2 */
+    bool drop;                  /**< true if the next page evicted from T1 is not remembered */
+} arc_state_t;
+
+void* arc_create(size_t frames, size_t pages) {
+    arc_state_t* arc = calloc(1, sizeof(arc_state_t));
+    if (arc != NULL) {
+        for (size_t i = 0; i < ARC_LISTS; i++) {
+            plist_init(&arc->lists[i]);
+        }
+        arc->c = frames;
+        // T1 and T2 hold at most c pages, and B1 and B2 at most c each
+        if (!pnodes_alloc(&arc->nodes, 3 * frames + 1)) {
+            pnodes_free(&arc->nodes);
+            free(arc);
+            arc = NULL;
+        }
+    }
+    return arc;
+}
+
+void arc_destroy(void* state) {
+    arc_state_t* arc = state;
+    if (arc != NULL) {
+        pnodes_free(&arc->nodes);
+        free(arc);
+    }
+}
+
+/**
+ * A helper function that moves a page from whatever ARC list holds it to the head of another.
+ * @param arc the ARC state
+ * @param page the page key
+ * @param id the list to move the page to
+ * @param framenum the frame holding the page, if it is resident
+ */
+void arc_move(arc_state_t* arc, uint64_t page, uint8_t id, framenum_t framenum) {
+    uint8_t from = pnodes_where(&arc->nodes, page);
+    if (from) {
+        plist_remove(&arc->nodes, &arc->lists[from], page);
+    }
+    plist_push(&arc->nodes, &arc->lists[id], id, page, framenum);
+}
+
+void arc_fault(void* state, pagetable_t* tbl, pagenum_t pagenum) {
+    arc_state_t* arc = state;
+    size_t t1 = arc->lists[ARC_T1].size;
+    size_t b1 = arc->lists[ARC_B1].size;
+    size_t b2 = arc->lists[ARC_B2].size;
+    size_t delta;
+    uint8_t from = pnodes_where(&arc->nodes, page_key(tbl, pagenum));
+
+    arc->from_b2 = from == ARC_B2;
+    arc->drop = false;
+    if (from == ARC_B1) {
+        // recency is paying off; favor T1
+        delta = b2 > b1 ? b2 / b1 : 1;
+        arc->p = arc->p + delta < arc->c ? arc->p + delta : arc->c;
+    }
+    else if (arc->from_b2) {
+        // frequency is paying off; favor T2
+        delta = b1 > b2 ? b1 / b2 : 1;
+        arc->p = arc->p > delta ? arc->p - delta : 0;
+    }
+    else if (t1 + b1 >= arc->c) {
+        // the recency side of the directory is full
+        if (t1 < arc->c) {
+            plist_pop(&arc->nodes, &arc->lists[ARC_B1]);
+        }
+        else {
+            arc->drop = true;
+        }
+    }
+    else if (t1 + b1 + arc->lists[ARC_T2].size + b2 >= 2 * arc->c) {
+        plist_pop(&arc->nodes, &arc->lists[ARC_B2]);
+    }
+}
+
+bool arc_victim(void* state, pagetable_t* tbl, pagenum_t pagenum, framenum_t* framenum) {
+    arc_state_t* arc = state;
+    size_t t1 = arc->lists[ARC_T1].size;
+    uint8_t id = ARC_T2;
+    if (t1 > 0 && (t1 > arc->p || (arc->from_b2 && t1 == arc->p)
+                   || arc->lists[ARC_T2].size == 0)) {
+        id = ARC_T1;
+    }
+    return plist_tail_frame(&arc->nodes, &arc->lists[id], framenum);
+}
+
+void arc_evict(void* state, pagetable_t* tbl, pagenum_t pagenum, framenum_t framenum) {
+    arc_state_t* arc = state;
+    uint64_t key = page_key(tbl, pagenum);
+    uint8_t from = pnodes_where(&arc->nodes, key);
+    if (from == ARC_T1 && arc->drop) {
+        plist_remove(&arc->nodes, &arc->lists[ARC_T1], key);
+        arc->drop = false;
+    }
+    else if (from == ARC_T1 || from == ARC_T2) {
+        // remember the page, keeping each ghost list within the cache size
+        uint8_t ghost = from == ARC_T1 ? ARC_B1 : ARC_B2;
+        if (arc->lists[ghost].size >= arc->c) {
+            plist_pop(&arc->nodes, &arc->lists[ghost]);
+        }
+        arc_move(arc, key, ghost, framenum);
+    }
+}
+
+void arc_access(void* state, pagetable_t* tbl, pagenum_t pagenum, framenum_t framenum) {
+    arc_state_t* arc = state;
+    uint64_t key = page_key(tbl, pagenum);
+    uint8_t from = pnodes_where(&arc->nodes, key);
+    // a page just loaded that was not remembered has been seen once; anything else twice
+    if (from == 0) {
+        plist_push(&arc->nodes, &arc->lists[ARC_T1], ARC_T1, key, framenum);
+    }
+    else if (plist_head(&arc->nodes, &arc->lists[ARC_T2]) != key) {
+        arc_move(arc, key, ARC_T2, framenum);
+    }
+}
+
+
+/*
+ * 2Q (Johnson and Shasha): new pages enter the FIFO A1in.  Pages pushed out of A1in are
+ * remembered in A1out, and a fault on one of them promotes it to the LRU list Am.  Pages touched
+ * only once in a burst therefore never displace the pages in Am.
+ */
+
+enum { Q_A1IN = 1, Q_A1OUT, Q_AM, Q_LISTS };
+
+/**
+ * @struct twoq_state_t
+ * @brief The state of the 2Q policy.
+ */
+typedef struct {
+    pnodes_t nodes;           /**< links of the pages on the lists */
+    plist_t lists[Q_LISTS];   /**< A1in, A1out and Am, indexed by the enum above */
+    size_t kin;               /**< size A1in may grow to before it supplies victims */
+    size_t kout;              /**< size of A1out */
+} twoq_state_t;
+
+void* twoq_create(size_t frames, size_t pages) {
+    twoq_state_t* q = calloc(1, sizeof(twoq_state_t));
+    if (q != NULL) {
+        for (size_t i = 0; i < Q_LISTS; i++) {
+            plist_init(&q->lists[i]);
+        }
+        // the sizes recommended by the paper: a quarter and a half of the cache
+        q->kin = frames / 4 > 0 ? frames / 4 : 1;
+        q->kout = frames / 2 > 0 ? frames / 2 : 1;
+        if (!pnodes_alloc(&q->nodes, frames + q->kout + 1)) {
+            pnodes_free(&q->nodes);
+            free(q);
+            q = NULL;
+        }
+    }
+    return q;
+}
+
+void twoq_destroy(void* state) {
+    twoq_state_t* q = state;
+    if (q != NULL) {
+        pnodes_free(&q->nodes);
+        free(q);
+    }
+}
+
+void twoq_access(void* state, pagetable_t* tbl, pagenum_t pagenum, framenum_t framenum) {
+    twoq_state_t* q = state;
+    uint64_t key = page_key(tbl, pagenum);
+    uint8_t from = pnodes_where(&q->nodes, key);
+    if (from == 0) {
+        plist_push(&q->nodes, &q->lists[Q_A1IN], Q_A1IN, key, framenum);
+    }
+    else if (from == Q_A1OUT || (from == Q_AM && plist_head(&q->nodes, &q->lists[Q_AM]) != key)) {
+        plist_remove(&q->nodes, &q->lists[from], key);
+        plist_push(&q->nodes, &q->lists[Q_AM], Q_AM, key, framenum);
+    }
+    // a hit in A1in leaves it in place
+}
+
+bool twoq_victim(void* state, pagetable_t* tbl, pagenum_t pagenum, framenum_t* framenum) {
+    twoq_state_t* q = state;
+    uint8_t id = Q_AM;
+    if (q->lists[Q_A1IN].size > q->kin || q->lists[Q_AM].size == 0) {
+        id = Q_A1IN;
+    }
+    return plist_tail_frame(&q->nodes, &q->lists[id], framenum);
+}
+
+void twoq_evict(void* state, pagetable_t* tbl, pagenum_t pagenum, framenum_t framenum) {
+    twoq_state_t* q = state;
+    uint64_t key = page_key(tbl, pagenum);
+    uint8_t from = pnodes_where(&q->nodes, key);
+    if (from == Q_A1IN) {
+        plist_remove(&q->nodes, &q->lists[Q_A1IN], key);
+        if (q->lists[Q_A1OUT].size >= q->kout) {
+            plist_pop(&q->nodes, &q->lists[Q_A1OUT]);
+        }
+        plist_push(&q->nodes, &q->lists[Q_A1OUT], Q_A1OUT, key, framenum);
+    }
+    else if (from == Q_AM) {
+        plist_remove(&q->nodes, &q->lists[Q_AM], key);
+    }
+}
+
+
+/* the policies, indexed by policy_kind_t */
+static const policy_ops_t policies[POLICY_COUNT] = {
+    [POLICY_CLOCK] = {"clock", clock_create, clock_destroy, clock_access, NULL, clock_victim,
+                      clock_evict, NULL},
+    [POLICY_LRU] = {"lru", lru_create, lru_destroy, lru_access, NULL, lru_victim, lru_evict,
+                    NULL},
+    [POLICY_WSCLOCK] = {"wsclock", clock_create, clock_destroy, clock_access, NULL,
+                        wsclock_victim, clock_evict, wsclock_tick},
+    [POLICY_ARC] = {"arc", arc_create, arc_destroy, arc_access, arc_fault, arc_victim,
+                    arc_evict, NULL},
+    [POLICY_2Q] = {"2q", twoq_create, twoq_destroy, twoq_access, NULL, twoq_victim, twoq_evict,
+                   NULL},
+};
+
+const policy_ops_t* policy_ops(policy_kind_t kind) {
+    const policy_ops_t* ops = NULL;
+    if (kind > POLICY_AGING && kind < POLICY_COUNT) {
+        ops = &policies[kind];
+    }
+    return ops;
+}
@@ -0,0 +1,94 @@
+/**
+ * @file mmu_policy.h
+ * @brief Declarations for the pluggable page replacement policies.
+ *
+ * A policy sees every page access and fault through a small set of hooks and is asked for a
+ * victim frame whenever a page faults with no frame free.  The MMU calls the hooks in this order
+ * for a fault: on_fault(), then victim() and on_evict() if no frame is free, then on_access() once
+ * the page is loaded.  A hit calls on_access() only.  Any hook may be NULL.
+ *
+ * @author ckurdelak20@georgefox.edu
+ */
+
+#ifndef MMU_POLICY_H
+#define MMU_POLICY_H
+
+#include "mmu.h"
+
+#define WSCLOCK_TAU     32    /* ticks after which an unreferenced page leaves the working set */
+
+/**
+ * @struct policy_ops_t
+ * @brief A page replacement policy: its name, the constructor and destructor of its state, and
+ * its hooks.
+ */
+typedef struct {
+    const char* name;    /**< name used to select the policy */
+
+    /**
+     * Allocates the policy's state.
+     * @param frames the number of page frames
+     * @param pages the number of virtual pages
+     * @return the state, or NULL if it could not be allocated
+     */
+    void* (*create)(size_t frames, size_t pages);
+
+    /**
+     * Frees the policy's state.
+     * @param state the state
+     */
+    void (*destroy)(void* state);
+
+    /**
+     * Called on every access to a present page, including the access that faulted it in.
+     * @param state the state
+     * @param tbl the page table
+     * @param pagenum the virtual page number
+     * @param framenum the frame holding the page
+     */
+    void (*on_access)(void* state, pagetable_t* tbl, pagenum_t pagenum, framenum_t framenum);
+
+    /**
+     * Called when a page faults, before any frame is chosen for it.
+     * @param state the state
+     * @param tbl the page table
+     * @param pagenum the virtual page number
+     */
+    void (*on_fault)(void* state, pagetable_t* tbl, pagenum_t pagenum);
+
+    /**
+     * Chooses the frame to be freed for the faulting page when no frame is free.
+     * @param state the state
+     * @param tbl the page table
+     * @param pagenum the virtual page number of the faulting page
+     * @param framenum where to store the victim frame
+     * @return true if a victim was chosen, else returns false
+     */
+    bool (*victim)(void* state, pagetable_t* tbl, pagenum_t pagenum, framenum_t* framenum);
+
+    /**
+     * Called when a page leaves its frame, whether as a victim or not.
+     * @param state the state
+     * @param tbl the page table
+     * @param pagenum the virtual page number
+     * @param framenum the frame the page held
+     */
+    void (*on_evict)(void* state, pagetable_t* tbl, pagenum_t pagenum, framenum_t framenum);
+
+    /**
+     * Called once per aging tick, after the page table's aging counters are shifted.
+     * @param state the state
+     * @param tbl the page table
+     */
+    void (*tick)(void* state, pagetable_t* tbl);
+} policy_ops_t;
+
+/**
+ * Returns the operations of the given policy.  POLICY_AGING is implemented by the MMU itself,
+ * on top of the frame heap, and is not returned here.
+ * @param kind the policy
+ * @return the policy's operations, or NULL for POLICY_AGING
+ */
+const policy_ops_t* policy_ops(policy_kind_t kind);
+
+#endif /* MMU_POLICY_H */
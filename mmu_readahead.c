@@ -0,0 +1,63 @@
+/**
+ * @file mmu_readahead.c
+ * @brief Readahead detector implementation.
+ *
+ * @author ckurdelak20@georgefox.edu
+ */
+
+#include "mmu_readahead.h"
+
+void readahead_reset(readahead_t* ra) {
+    ra->last = 0;
+    ra->stride = 0;
+    ra->run = 0;
+    ra->ahead = 0;
+    ra->window = RA_WINDOW_MIN;
+    ra->seen = false;
+}
+
+size_t readahead_observe(readahead_t* ra, pagenum_t pagenum, size_t max_window, pagenum_t* start,
+                         int64_t* stride) {
+    size_t count = 0;
+    int64_t delta = (int64_t)pagenum - (int64_t)ra->last;
+    bool followed = delta != 0 && delta >= -RA_STRIDE_MAX && delta <= RA_STRIDE_MAX;
+    if (ra->seen && followed && delta == ra->stride) {
+        ra->run++;
+    }
+    else {
+        // a new stream, or none; start over with a small window
+        ra->stride = delta;
+        ra->run = ra->seen && followed;
+        ra->ahead = pagenum;
+        ra->window = RA_WINDOW_MIN;
+        ra->seen = true;
+    }
+    ra->last = pagenum;
+
+    if (ra->run >= RA_TRIGGER && max_window > 0) {
+        size_t window = ra->window < max_window ? ra->window : max_window;
+        // how far along the stride the pages already asked for reach
+        int64_t steps = ((int64_t)ra->ahead - (int64_t)pagenum) / ra->stride;
+        if (steps < 0) {
+            ra->ahead = pagenum;
+            steps = 0;
+        }
+        // stop at either end of the virtual address space
+        pagenum_t room = ra->stride > 0 ? (PAGETABLE_SIZE - 1 - ra->ahead) / ra->stride
+                                        : ra->ahead / -ra->stride;
+        if ((size_t)steps < window) {
+            count = window - steps;
+        }
+        if (count > room) {
+            count = room;
+        }
+        if (count > 0) {
+            *start = ra->ahead + ra->stride;
+            *stride = ra->stride;
+            ra->ahead += ra->stride * (int64_t)count;
+            // the stream kept going, so keep further ahead of it next time
+            ra->window = 2 * window < max_window ? 2 * window : max_window;
+        }
+    }
+    return count;
+}
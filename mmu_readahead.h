@@ -0,0 +1,58 @@
+/**
+ * @file mmu_readahead.h
+ * @brief Function prototypes for the readahead detector that drives page prefetching.
+ *
+ * A detector follows the pages one address space faults on, and on the first use of pages it had
+ * prefetched.  Once the same stride between pages has been seen RA_TRIGGER times in a row it asks
+ * for the next pages along the stride, keeping up to a window of pages ahead of the stream.  The
+ * window starts at RA_WINDOW_MIN pages and doubles each time the stream keeps going, up to the
+ * window set by mm_readahead_init().  The detector only decides which pages to prefetch; the MMU
+ * brings them in.
+ *
+ * @author ckurdelak20@georgefox.edu
+ */
+
+#ifndef MMU_READAHEAD_H
+#define MMU_READAHEAD_H
+
+#include "mmu.h"
+
+#define RA_TRIGGER      2     /* equal strides in a row that make a stream */
+#define RA_STRIDE_MAX   64    /* widest stride in pages that is followed */
+#define RA_WINDOW_MIN   2     /* pages prefetched when a stream is first seen */
+
+/**
+ * @struct readahead_t
+ * @brief The state of the readahead detector of one address space.
+ * @see readahead_reset().
+ */
+typedef struct {
+    pagenum_t last;      /**< last page seen */
+    int64_t stride;      /**< pages between the last two pages seen */
+    unsigned run;        /**< times in a row the stride was seen */
+    pagenum_t ahead;     /**< furthest page asked for along the stride */
+    size_t window;       /**< pages to keep ahead of the stream */
+    bool seen;           /**< true once any page has been seen */
+} readahead_t;
+
+/**
+ * @brief Forgets any stream the detector was following.
+ * @param ra the detector
+ */
+void readahead_reset(readahead_t* ra);
+
+/**
+ * Tells the detector about a page fault or the first use of a prefetched page, and returns the
+ * pages to prefetch next.  Pages already asked for are not asked for again, nor are pages outside
+ * the virtual address space.
+ * @param ra the detector
+ * @param pagenum the virtual page number
+ * @param max_window the most pages to keep ahead of the stream
+ * @param start where to store the first page to prefetch
+ * @param stride where to store the pages between pages to prefetch
+ * @return the number of pages to prefetch, or 0 if none
+ */
+size_t readahead_observe(readahead_t* ra, pagenum_t pagenum, size_t max_window, pagenum_t* start,
+                         int64_t* stride);
+
+#endif /* MMU_READAHEAD_H */
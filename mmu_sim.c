@@ -8,124 +8,625 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 #include "mmu.h"
 #include "mmu_sim.h"
 #include "mmu_sim_cmd.h"
+#include "mmu_sim_parse.h"
+#include "mmu_tlb.h"
+#include "mmu_trace.h"
 
-int main() {
-    // Initialize 64KB pseudo-physical memory buffer
-    mm_mem_init();
+/**
+ * A command handler, executing one parsed command.
+ * @param pagefile the page file
+ * @param tbl the page table
+ * @param cmd the parsed command
+ */
+typedef void (*cmd_handler_t)(char* pagefile, pagetable_t* tbl, const cmd_t* cmd);
 
-    char* pagefile = "pagefile.sys";
-    mm_vmem_init(pagefile);
+static void exec_read(char* pagefile, pagetable_t* tbl, const cmd_t* cmd) {
+    vaddr_t vaddr = mk_vaddr(cmd->args[0]);
+    mmu_sim_read(pagefile, tbl, vaddr);
+}
 
-    // Allocate page table
-    pagetable_t* pagetable = pagetable_alloc();
+static void exec_readn(char* pagefile, pagetable_t* tbl, const cmd_t* cmd) {
+    vaddr_t vaddr = mk_vaddr(cmd->args[0]);
+    mmu_sim_readn(pagefile, tbl, vaddr, cmd->args[1]);
+}
+
+static void exec_write(char* pagefile, pagetable_t* tbl, const cmd_t* cmd) {
+    vaddr_t vaddr = mk_vaddr(cmd->args[0]);
+    mmu_sim_write(pagefile, tbl, vaddr, cmd->args[1]);
+}
+
+static void exec_writew(char* pagefile, pagetable_t* tbl, const cmd_t* cmd) {
+    vaddr_t vaddr = mk_vaddr(cmd->args[0]);
+    mmu_sim_writew(pagefile, tbl, vaddr, cmd->args[1], cmd->args[2]);
+}
+
+static void exec_writedw(char* pagefile, pagetable_t* tbl, const cmd_t* cmd) {
+    vaddr_t vaddr = mk_vaddr(cmd->args[0]);
+    mmu_sim_writedw(pagefile, tbl, vaddr, cmd->args[1], cmd->args[2], cmd->args[3],
+                    cmd->args[4]);
+}
+
+static void exec_writez(char* pagefile, pagetable_t* tbl, const cmd_t* cmd) {
+    vaddr_t vaddr = mk_vaddr(cmd->args[0]);
+    mmu_sim_writez(pagefile, tbl, vaddr, cmd->args[1]);
+}
+
+static void exec_stats(char* pagefile, pagetable_t* tbl, const cmd_t* cmd) {
+    (void)pagefile;
+    (void)cmd;
+    mmu_sim_stats(tbl, stdout);
+}
+
+/* the command handlers, indexed by opcode; HALT, SWITCH and FORK are handled by the REPL itself */
+static const cmd_handler_t cmd_handlers[CMD_COUNT] = {
+    [CMD_READ]    = exec_read,
+    [CMD_READN]   = exec_readn,
+    [CMD_WRITE]   = exec_write,
+    [CMD_WRITEW]  = exec_writew,
+    [CMD_WRITEDW] = exec_writedw,
+    [CMD_WRITEZ]  = exec_writez,
+    [CMD_STATS]   = exec_stats,
+};
+
+int main(int argc, char* argv[]) {
+    // Choose how the page file is accessed and how big the TLB is
+    sim_opts_t opts = {
+        .pagefile = {.mode = PAGEFILE_PIO, .msync = MSYNC_HALT},
+        .tlb_policy = TLB_LRU,
+        .vaddr_bits = mmu_geom.vaddr_bits,
+        .page_shift = mmu_geom.page_shift,
+        .frames = mmu_geom.frames,
+        .spaces = 1
+    };
+    if (!get_opts(argc, argv, &opts)) {
+        fprintf(stderr, "usage: %s [-m stdio|pio|mmap] [-s never|halt|<evictions>] "
+                "[-c sparse|fallocate|fill] [-t <tlb entries>] [-w <tlb ways>] "
+                "[-r lru|fifo|random] [-a all|resident] "
+                "[-e aging|clock|lru|wsclock|arc|2q] [-b <trace> | -o <trace>] "
+                "[-p <commands per stats dump>] [-v <vaddr bits>] [-k <page KB>] "
+                "[-f <frames>] [-l flat|radix|hashed] [-n <processes>] [-g global|local] "
+                "[-A <readahead pages>] [-W <dirty pct>[:<limit pct>[:<age>]]] [-I sync|async] "
+                "[-Z <compressed cache KB>] [-H <superpage order>] [-C <image to save>] "
+                "[-R <image to resume>]\n",
+                argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    // Convert text commands on stdin to a binary trace, without running them
+    if (opts.trace_out != NULL) {
+        if (!convert_trace(STDIN_FILENO, opts.trace_out)) {
+            fprintf(stderr, "could not write %s\n", opts.trace_out);
+            exit(EXIT_FAILURE);
+        }
+        exit(EXIT_SUCCESS);
+    }
+
+    // Shape the machine, then initialize its pseudo-physical memory buffer
+    if (!mm_geometry_init(opts.vaddr_bits, opts.page_shift, opts.frames)) {
+        fprintf(stderr, "unsupported geometry: %u-bit addresses, %zu KB pages, %zu frames\n",
+                opts.vaddr_bits, ((size_t)1 << opts.page_shift) / 1024, opts.frames);
+        exit(EXIT_FAILURE);
+    }
+    if (!mm_spaces_init(opts.spaces, opts.scope)) {
+        fprintf(stderr, "unsupported number of processes: %zu\n", opts.spaces);
+        exit(EXIT_FAILURE);
+    }
+    // reading ahead and writing back in the background take more threads into the MMU
+    opts.writeback_opts.async = opts.async_io;
+    if ((opts.async_io && !mm_threads_init())
+        || !mm_readahead_init(opts.readahead, opts.async_io)
+        || !mm_writeback_init(opts.writeback ? &opts.writeback_opts : NULL)) {
+        fprintf(stderr, "could not start readahead or write-back\n");
+        exit(EXIT_FAILURE);
+    }
+    mm_zcache_init(opts.zcache_kb * 1024);
+    if (!mm_superpages_init(opts.superpage_order)) {
+        fprintf(stderr, "unsupported superpage order: %u\n", opts.superpage_order);
+        exit(EXIT_FAILURE);
+    }
+    if (mm_mem_init() == NULL) {
+        fprintf(stderr, "could not allocate %zu frames for %zu pages\n", PAGE_FRAMES,
+                PAGETABLE_SIZE);
+        exit(EXIT_FAILURE);
+    }
+    if (!mm_policy_init(opts.policy)) {
+        fprintf(stderr, "could not start the %s policy\n", mm_policy_name(opts.policy));
+        exit(EXIT_FAILURE);
+    }
+
+    char* pagefile = "pagefile.sys";
+    if (opts.restore != NULL && !mm_vmem_restore(pagefile, &opts.pagefile, opts.restore)) {
+        fprintf(stderr, "could not resume from %s with %s\n", opts.restore, pagefile);
+        exit(EXIT_FAILURE);
+    }
+    if (opts.restore == NULL && !mm_vmem_init_opts(pagefile, &opts.pagefile)) {
+        fprintf(stderr, "could not initialize %s\n", pagefile);
+        exit(EXIT_FAILURE);
+    }
 
-    int last_exit_status = 0;
+    // Allocate the first process's page table, unless it was resumed, laid out as asked or as
+    // suits the size of the address space; the others are allocated as they are switched to
+    pagetable_t* pagetable = mm_space(0);
+    if (pagetable == NULL) {
+        pagetable = opts.table_set ? pagetable_alloc_kind(opts.table) : pagetable_alloc();
+    }
+    if (pagetable == NULL) {
+        fprintf(stderr, "could not allocate a page table of %zu entries\n", PAGETABLE_SIZE);
+        exit(EXIT_FAILURE);
+    }
+    if (opts.tlb_entries > 0) {
+        pagetable->tlb = tlb_alloc(opts.tlb_entries, opts.tlb_ways, opts.tlb_policy);
+        if (pagetable->tlb == NULL) {
+            fprintf(stderr, "TLB ways must evenly divide its entries\n");
+            exit(EXIT_FAILURE);
+        }
+    }
 
-    // input buffer
-    char cmd[255];
-    // buffer for current working directory
-    char current_dir[255];
     bool quit = false;
 
+    // Replay a binary trace instead of reading commands
+    if (opts.trace_in != NULL) {
+        quit = true;
+        if (!replay_trace(opts.trace_in, pagefile, pagetable, opts.age_resident)) {
+            fprintf(stderr, "could not replay %s\n", opts.trace_in);
+        }
+    }
+
+    // commands are read from stdin in large blocks
+    cmd_reader_t* reader = cmd_reader_alloc(STDIN_FILENO);
+    unsigned long commands = 0;
+
     // while not exit:
     while (!quit) {
         // shift aging counters for all pgs
-        for (int i = 0; i < PAGETABLE_SIZE; i++) {
-            pte_mkold(pagetable, i);
+        pagetable_age(pagetable, opts.age_resident);
+
+        // read and parse the next user command from stdin
+        const char* line;
+        size_t len;
+        cmd_t cmd;
+        parse_status_t status = cmd_reader_next(reader, &line, &len);
+        if (status == PARSE_OK) {
+            status = cmd_parse(line, len, &cmd);
         }
 
-        // clear out input buffer
-        memset(cmd, '\0', 255);
+        // end of input acts as HALT
+        if (status == PARSE_EOF || (status == PARSE_OK && cmd.op == CMD_HALT)) {
+            quit = true;
+        }
+        // later commands run in the address space of another process
+        else if (status == PARSE_OK && cmd.op == CMD_SWITCH) {
+            pagetable_t* next = sim_switch(pagetable, cmd.args[0]);
+            if (next != NULL) {
+                pagetable = next;
+            }
+            else {
+                fprintf(stderr, "line %lu: no process %lu\n", reader->lineno,
+                        (unsigned long)cmd.args[0]);
+            }
+        }
+        // the running process carries on as the parent of another
+        else if (status == PARSE_OK && cmd.op == CMD_FORK) {
+            if (!sim_fork(pagetable, cmd.args[0])) {
+                fprintf(stderr, "line %lu: cannot fork into process %lu\n", reader->lineno,
+                        (unsigned long)cmd.args[0]);
+            }
+        }
+        // dispatch through the opcode table
+        else if (status == PARSE_OK) {
+            cmd_handlers[cmd.op](pagefile, pagetable, &cmd);
+        }
+        else if (status != PARSE_EMPTY) {
+            fprintf(stderr, "line %lu: %s\n", reader->lineno, parse_strerror(status));
+        }
 
-        // read user command from stdin
-        fgets(cmd, 255, stdin);
+        // periodic stats dump
+        commands++;
+        if (opts.stats_every > 0 && commands % opts.stats_every == 0) {
+            fprintf(stderr, "stats after %lu commands\n", commands);
+            mmu_sim_stats(pagetable, stderr);
+        }
+    }
+    cmd_reader_free(reader);
 
-        // the args from the user's command
-        char* args[255];
-        memset(args, '\0', 255);
-        get_args(cmd, args);
+    // Save the machine to resume from; the pages written back below are all in the image, so the
+    // page file still fits it
+    if (opts.checkpoint != NULL && !mm_checkpoint(opts.checkpoint)) {
+        fprintf(stderr, "could not write %s\n", opts.checkpoint);
+    }
 
-        // branching logic to handle specific, well-defined commands
-        // if the command is empty
-        if (strcmp(cmd, "\n") == 0) {
-            // this does not print a newline
+    // for each frame of each process, evict
+    for (asid_t asid = 0; asid < mm_space_count(); asid++) {
+        if (mm_space(asid) != NULL) {
+            mm_page_evict_all(pagefile, mm_space(asid));
         }
-            // if command is "HALT", exit = true
-        else if (strcmp(args[0], "HALT") == 0) {
-            quit = true;
+    }
+    // Report TLB use
+    tlb_t* tlb = pagetable->tlb;
+    if (tlb != NULL) {
+        fprintf(stderr, "tlb: %lu hits, %lu misses, %lu superpage hits\n", tlb->hits,
+                tlb->misses, tlb->huge_hits);
+    }
+    // Close page file
+    mm_vmem_destroy();
+    // Free page tables, and the TLB they share
+    for (asid_t asid = 0; asid < mm_space_count(); asid++) {
+        pagetable_t* tbl = mm_space(asid);
+        if (tbl != NULL) {
+            tbl->tlb = NULL;
+            pagetable_free(tbl);
         }
-        // else if READ
-        else if (strcmp(args[0], "READ") == 0) {
-            vaddr_t vaddr = {.value = strtoul(args[1], NULL, 2)};
-            mmu_sim_read(pagefile, pagetable, vaddr);
-        }
-        // else if READN
-        else if (strcmp(args[0], "READN") == 0) {
-            vaddr_t vaddr = {.value = strtoul(args[1], NULL, 2)};
-            int nbytes = strtol(args[2], NULL, 10);
-            // call fn
-            mmu_sim_readn(pagefile, pagetable, vaddr, nbytes);
-        }
-        // else if WRITE
-        else if (strcmp(args[0], "WRITE") == 0) {
-            vaddr_t vaddr = {.value = strtoul(args[1], NULL, 2)};
-            uint8_t val = strtoul(args[2], NULL, 2);
-            // call fn
-            mmu_sim_write(pagefile, pagetable, vaddr, val);
-        }
-        // else if WRITEW
-        else if (strcmp(args[0], "WRITEW") == 0) {
-            vaddr_t vaddr = {.value = strtoul(args[1], NULL, 2)};
-            uint8_t val1 = strtoul(args[2], NULL, 2);
-            uint8_t val2 = strtoul(args[3], NULL, 2);
-            // call fn
-            mmu_sim_writew(pagefile, pagetable, vaddr, val1, val2);
-        }
-        // else if WRITEDW
-        else if (strcmp(args[0], "WRITEDW") == 0) {
-            vaddr_t vaddr = {.value = strtoul(args[1], NULL, 2)};
-            uint8_t val1 = strtoul(args[2], NULL, 2);
-            uint8_t val2 = strtoul(args[3], NULL, 2);
-            uint8_t val3 = strtoul(args[4], NULL, 2);
-            uint8_t val4 = strtoul(args[5], NULL, 2);
-            // call fn
-            mmu_sim_writedw(pagefile, pagetable, vaddr, val1, val2, val3, val4);
-        }
-        // else if WRITEZ
-        else if (strcmp(args[0], "WRITEZ") == 0) {
-            vaddr_t vaddr = {.value = strtoul(args[1], NULL, 2)};
-            int nbytes = strtol(args[2], NULL, 2);
-            // call fn
-            mmu_sim_writez(pagefile, pagetable, vaddr, nbytes);
-        }
-    }
-
-    // for each frame, evict
-    for (int i = 0; i < PAGETABLE_SIZE; i++) {
-        mm_page_evict(pagefile, pagetable, (pagenum_t)i);
     }
-    // Free page table
-    pagetable_free(pagetable);
+    tlb_free(tlb);
     // Destroy pseudo-physical memory frames
     mm_mem_destroy();
     exit(0);
 }
 
 
-void get_args(char* cmd, char* args_array[]) {
-    char *current_token = strtok(cmd, " \n");
-    int i = 0;
-    while (current_token) {
-        // put current token in array
-        args_array[i] = current_token;
-        i++;
-        // get new token
-        current_token = strtok(NULL, " \n\t");
+bool get_opts(int argc, char* argv[], sim_opts_t* opts) {
+    bool success = true;
+    int opt;
+    char* end;
+    const char* optstring = "m:s:c:t:w:r:a:e:b:o:p:v:k:f:l:n:g:A:W:I:Z:H:C:R:";
+    while (success && (opt = getopt(argc, argv, optstring)) != -1) {
+        if (opt == 'm') {
+            if (strcmp(optarg, "stdio") == 0) {
+                opts->pagefile.mode = PAGEFILE_STDIO;
+            }
+            else if (strcmp(optarg, "pio") == 0) {
+                opts->pagefile.mode = PAGEFILE_PIO;
+            }
+            else if (strcmp(optarg, "mmap") == 0) {
+                opts->pagefile.mode = PAGEFILE_MMAP;
+            }
+            else {
+                success = false;
+            }
+        }
+        else if (opt == 's') {
+            if (strcmp(optarg, "never") == 0) {
+                opts->pagefile.msync = MSYNC_NEVER;
+            }
+            else if (strcmp(optarg, "halt") == 0) {
+                opts->pagefile.msync = MSYNC_HALT;
+            }
+            else {
+                // flush after every N write-backs
+                opts->pagefile.msync = MSYNC_EVERY;
+                opts->pagefile.msync_every = strtoul(optarg, &end, 10);
+                success = *end == '\0' && opts->pagefile.msync_every > 0;
+            }
+        }
+        else if (opt == 'c') {
+            if (strcmp(optarg, "sparse") == 0) {
+                opts->pagefile.create = PAGEFILE_SPARSE;
+            }
+            else if (strcmp(optarg, "fallocate") == 0) {
+                opts->pagefile.create = PAGEFILE_FALLOCATE;
+            }
+            else if (strcmp(optarg, "fill") == 0) {
+                opts->pagefile.create = PAGEFILE_ZERO_FILL;
+            }
+            else {
+                success = false;
+            }
+        }
+        else if (opt == 't') {
+            opts->tlb_entries = strtoul(optarg, &end, 10);
+            success = *end == '\0';
+        }
+        else if (opt == 'w') {
+            opts->tlb_ways = strtoul(optarg, &end, 10);
+            success = *end == '\0';
+        }
+        else if (opt == 'r') {
+            if (strcmp(optarg, "lru") == 0) {
+                opts->tlb_policy = TLB_LRU;
+            }
+            else if (strcmp(optarg, "fifo") == 0) {
+                opts->tlb_policy = TLB_FIFO;
+            }
+            else if (strcmp(optarg, "random") == 0) {
+                opts->tlb_policy = TLB_RANDOM;
+            }
+            else {
+                success = false;
+            }
+        }
+        else if (opt == 'e') {
+            // policies are named as mm_policy_name() names them
+            policy_kind_t kind = POLICY_AGING;
+            while (kind < POLICY_COUNT && strcmp(optarg, mm_policy_name(kind)) != 0) {
+                kind++;
+            }
+            opts->policy = kind;
+            success = kind < POLICY_COUNT;
+        }
+        else if (opt == 'v') {
+            opts->vaddr_bits = strtoul(optarg, &end, 10);
+            success = *end == '\0';
+        }
+        else if (opt == 'k') {
+            // a power of two number of kilobytes
+            unsigned long kb = strtoul(optarg, &end, 10);
+            success = *end == '\0' && kb > 0 && (kb & (kb - 1)) == 0;
+            if (success) {
+                opts->page_shift = 10 + __builtin_ctzl(kb);
+            }
+        }
+        else if (opt == 'f') {
+            opts->frames = strtoul(optarg, &end, 10);
+            success = *end == '\0';
+        }
+        else if (opt == 'l') {
+            opts->table_set = true;
+            if (strcmp(optarg, "flat") == 0) {
+                opts->table = PAGETABLE_FLAT;
+            }
+            else if (strcmp(optarg, "radix") == 0) {
+                opts->table = PAGETABLE_RADIX;
+            }
+            else if (strcmp(optarg, "hashed") == 0) {
+                opts->table = PAGETABLE_HASHED;
+            }
+            else {
+                success = false;
+            }
+        }
+        else if (opt == 'n') {
+            opts->spaces = strtoul(optarg, &end, 10);
+            success = *end == '\0';
+        }
+        else if (opt == 'g') {
+            if (strcmp(optarg, "global") == 0) {
+                opts->scope = SCOPE_GLOBAL;
+            }
+            else if (strcmp(optarg, "local") == 0) {
+                opts->scope = SCOPE_LOCAL;
+            }
+            else {
+                success = false;
+            }
+        }
+        else if (opt == 'A') {
+            opts->readahead = strtoul(optarg, &end, 10);
+            success = *end == '\0';
+        }
+        else if (opt == 'W') {
+            // dirty percentages and age cutoff, separated by colons; later ones may be left out
+            opts->writeback = true;
+            opts->writeback_opts.background_ratio = strtoul(optarg, &end, 10);
+            success = end != optarg;
+            if (success && *end == ':') {
+                opts->writeback_opts.ratio = strtoul(end + 1, &end, 10);
+            }
+            if (success && *end == ':') {
+                unsigned long age = strtoul(end + 1, &end, 10);
+                opts->writeback_opts.age_cutoff = age;
+                success = age <= UINT8_MAX;
+            }
+            success = success && *end == '\0';
+        }
+        else if (opt == 'I') {
+            if (strcmp(optarg, "sync") == 0) {
+                opts->async_io = false;
+            }
+            else if (strcmp(optarg, "async") == 0) {
+                opts->async_io = true;
+            }
+            else {
+                success = false;
+            }
+        }
+        else if (opt == 'Z') {
+            opts->zcache_kb = strtoul(optarg, &end, 10);
+            success = *end == '\0';
+        }
+        else if (opt == 'C') {
+            opts->checkpoint = optarg;
+        }
+        else if (opt == 'R') {
+            opts->restore = optarg;
+        }
+        else if (opt == 'H') {
+            unsigned long order = strtoul(optarg, &end, 10);
+            opts->superpage_order = order;
+            success = *end == '\0' && order <= SUPERPAGE_ORDER_MAX;
+        }
+        else if (opt == 'p') {
+            opts->stats_every = strtoul(optarg, &end, 10);
+            success = *end == '\0';
+        }
+        else if (opt == 'b') {
+            opts->trace_in = optarg;
+        }
+        else if (opt == 'o') {
+            opts->trace_out = optarg;
+        }
+        else if (opt == 'a') {
+            if (strcmp(optarg, "all") == 0) {
+                opts->age_resident = false;
+            }
+            else if (strcmp(optarg, "resident") == 0) {
+                opts->age_resident = true;
+            }
+            else {
+                success = false;
+            }
+        }
+        else {
+            success = false;
+        }
+    }
+    return success && optind == argc && (opts->trace_in == NULL || opts->trace_out == NULL);
+}
+
+
+pagetable_t* sim_switch(pagetable_t* current, uint64_t pid) {
+    pagetable_t* tbl = NULL;
+    if (pid < mm_space_count()) {
+        tbl = mm_space(pid);
+        if (tbl == NULL) {
+            tbl = pagetable_alloc_space(current->kind, pid);
+        }
+        if (tbl != NULL) {
+            // the TLB is tagged by ASID, so it is shared rather than flushed
+            tbl->tlb = current->tlb;
+        }
+    }
+    return tbl;
+}
+
+bool sim_fork(pagetable_t* current, uint64_t pid) {
+    pagetable_t* tbl = pid < mm_space_count() ? pagetable_fork_space(current, pid) : NULL;
+    if (tbl != NULL) {
+        tbl->tlb = current->tlb;
+    }
+    return tbl != NULL;
+}
+
+
+bool convert_trace(int in, const char* path) {
+    FILE* out = fopen(path, "wb");
+    cmd_reader_t* reader = cmd_reader_alloc(in);
+    bool success = out != NULL && reader != NULL && trace_write_header(out);
+    bool quit = false;
+    while (success && !quit) {
+        const char* line;
+        size_t len;
+        cmd_t cmd;
+        parse_status_t status = cmd_reader_next(reader, &line, &len);
+        if (status == PARSE_OK) {
+            status = cmd_parse(line, len, &cmd);
+        }
+        if (status == PARSE_EOF || (status == PARSE_OK && cmd.op == CMD_HALT)) {
+            quit = true;
+        }
+        else if (status == PARSE_OK) {
+            uint8_t payload[4];
+            trace_rec_t rec = {.vaddr = cmd.args[0], .payload = payload};
+            if (cmd.op == CMD_STATS) {
+                // nothing to record
+            }
+            else if (cmd.op == CMD_SWITCH) {
+                rec.op = TRACE_SWITCH;
+            }
+            else if (cmd.op == CMD_FORK) {
+                rec.op = TRACE_FORK;
+            }
+            else if (cmd.op == CMD_READ || cmd.op == CMD_READN) {
+                rec.op = TRACE_READ;
+                rec.length = cmd.op == CMD_READ ? 1 : cmd.args[1];
+            }
+            else if (cmd.op == CMD_WRITEZ && cmd.args[1] > UINT32_MAX) {
+                // the REPL would zero more than a record can hold
+                fprintf(stderr, "line %lu: count too large for a trace\n", reader->lineno);
+                success = false;
+            }
+            else if (cmd.op == CMD_WRITEZ) {
+                rec.op = TRACE_FILL;
+                rec.length = cmd.args[1];
+            }
+            else {
+                // one payload byte per value given
+                rec.op = TRACE_WRITE;
+                rec.length = cmd.op == CMD_WRITE ? 1 : cmd.op == CMD_WRITEW ? 2 : 4;
+                for (uint32_t i = 0; i < rec.length; i++) {
+                    payload[i] = cmd.args[i + 1];
+                }
+            }
+            if (rec.op != 0) {
+                success = trace_write(out, &rec);
+            }
+        }
+        else if (status != PARSE_EMPTY) {
+            fprintf(stderr, "line %lu: %s\n", reader->lineno, parse_strerror(status));
+        }
+    }
+    cmd_reader_free(reader);
+    if (out != NULL) {
+        success = fclose(out) == 0 && success;
+    }
+    return success;
+}
+
+
+bool replay_trace(const char* path, char* pagefile, pagetable_t* tbl, bool age_resident) {
+    trace_t* trace = trace_open(path);
+    bool success = trace != NULL;
+    if (success) {
+        unsigned long ops = 0;
+        unsigned long bytes = 0;
+        // grown to the longest read; a read never goes past the end of the address space
+        uint8_t* buf = NULL;
+        size_t buf_size = 0;
+        size_t space = PAGETABLE_SIZE * PAGE_SIZE;
+        struct timespec start, end;
+        trace_rec_t rec;
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        while (trace_next(trace, &rec)) {
+            // one aging tick per command, as in the REPL
+            pagetable_age(tbl, age_resident);
+            vaddr_t vaddr = mk_vaddr(rec.vaddr);
+            size_t length = rec.length;
+            if (length > space - vaddr_value(vaddr)) {
+                length = space - vaddr_value(vaddr);
+            }
+            if (rec.op == TRACE_SWITCH) {
+                pagetable_t* next = sim_switch(tbl, rec.vaddr);
+                if (next != NULL) {
+                    tbl = next;
+                }
+                else {
+                    fprintf(stderr, "replay: no process %lu\n", (unsigned long)rec.vaddr);
+                }
+            }
+            else if (rec.op == TRACE_FORK) {
+                if (!sim_fork(tbl, rec.vaddr)) {
+                    fprintf(stderr, "replay: cannot fork into process %lu\n",
+                            (unsigned long)rec.vaddr);
+                }
+            }
+            else if (rec.op == TRACE_READ) {
+                if (length > buf_size) {
+                    uint8_t* grown = realloc(buf, length);
+                    if (grown != NULL) {
+                        buf = grown;
+                        buf_size = length;
+                    }
+                    else {
+                        length = buf_size;
+                    }
+                }
+                bytes += mmu_read_span(pagefile, tbl, vaddr, buf, length);
+            }
+            else if (rec.op == TRACE_WRITE) {
+                bytes += mmu_write_span(pagefile, tbl, vaddr, rec.payload, length);
+            }
+            else {
+                bytes += mmu_fill_span(pagefile, tbl, vaddr, rec.fill, length);
+            }
+            ops++;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+
+        // a trace that stops short of its end is truncated or corrupt
+        success = trace->pos == trace->size;
+        double elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+        fprintf(stderr, "replay: %lu ops, %lu bytes in %.3f s (%.0f ops/sec, %.1f MB/s)\n",
+                ops, bytes, elapsed, elapsed > 0 ? ops / elapsed : 0.0,
+                elapsed > 0 ? bytes / elapsed / 1e6 : 0.0);
+        free(buf);
+        trace_close(trace);
     }
+    return success;
 }
 
 
@@ -8,11 +8,90 @@
 #ifndef MMU_NEW_MMU_SIM_H
 #define MMU_NEW_MMU_SIM_H
 
+#include "mmu.h"
+
+/**
+ * @struct sim_opts_t
+ * @brief Startup options for mmu_sim.
+ */
+typedef struct {
+    pagefile_opts_t pagefile;    /**< page file options */
+    size_t tlb_entries;          /**< number of TLB entries; 0 for no TLB */
+    size_t tlb_ways;             /**< TLB entries per set; 0 for fully associative */
+    tlb_policy_t tlb_policy;     /**< TLB replacement policy */
+    bool age_resident;           /**< true to age only resident pages each tick */
+    policy_kind_t policy;        /**< page replacement policy */
+    char* trace_in;              /**< binary trace to replay instead of reading stdin, or NULL */
+    char* trace_out;             /**< binary trace to convert stdin into, or NULL */
+    unsigned long stats_every;   /**< commands between stats dumps on stderr; 0 for none */
+    unsigned vaddr_bits;         /**< bits in a virtual address */
+    unsigned page_shift;         /**< log2 of the page size */
+    size_t frames;               /**< number of page frames */
+    bool table_set;              /**< true if the page table layout was chosen with -l */
+    pagetable_kind_t table;      /**< page table layout, if table_set */
+    size_t spaces;               /**< number of processes, each with its own address space */
+    replace_scope_t scope;       /**< which pages a faulting process may replace */
+    size_t readahead;            /**< most pages read ahead of a stream; 0 for no readahead */
+    bool writeback;              /**< true to write dirty pages back ahead of eviction */
+    writeback_opts_t writeback_opts;  /**< write-back thresholds, if writeback */
+    bool async_io;               /**< true to read ahead and write back on background threads */
+    size_t zcache_kb;            /**< budget of the compressed page cache in KB; 0 for none */
+    unsigned superpage_order;    /**< log2 of the pages in a superpage; 0 for no superpages */
+    char* checkpoint;            /**< image to save the machine to when it halts, or NULL */
+    char* restore;               /**< image to resume the machine from, or NULL */
+} sim_opts_t;
+
+/**
+ * Reads the startup options from the command line.
+ * @param argc the number of command line arguments
+ * @param argv the command line arguments
+ * @param opts the options to be filled in; fields not given on the command line are left as is
+ * @return true if the command line was valid, else returns false
+ */
+bool get_opts(int argc, char* argv[], sim_opts_t* opts);
+
+/**
+ * Switches to the address space of the given process, allocating its page table on first use with
+ * the layout of the running one and sharing its TLB.
+ * @param current the page table of the running process
+ * @param pid the process to switch to
+ * @return the page table of the process, or NULL if the process number is not below the number of
+ * address spaces or its page table could not be allocated
+ */
+pagetable_t* sim_switch(pagetable_t* current, uint64_t pid);
+
+/**
+ * Forks the running process into the given process, whose address space shares the running one's
+ * pages copy-on-write and its TLB.  The running process carries on as the parent.
+ * @param current the page table of the running process
+ * @param pid the process to fork into
+ * @return true if the process was forked, else returns false if the process number is not below
+ * the number of address spaces, the process already has an address space or its page table could
+ * not be allocated
+ */
+bool sim_fork(pagetable_t* current, uint64_t pid);
+
+/**
+ * Converts text commands to a binary trace, up to the end of input or a HALT command.  Commands
+ * that do not parse are reported on stderr and skipped, as the REPL skips them.  Counts are
+ * recorded as given and cut short at the end of the address space when replayed, as the REPL cuts
+ * them; a WRITEZ count too large for a record is reported and stops the conversion.
+ * @param in the file descriptor to read text commands from
+ * @param path the filename of the binary trace to be written
+ * @return true if the trace was written, else returns false
+ */
+bool convert_trace(int in, const char* path);
+
 /**
- * Extracts an array of args from the given command string.
- * @param cmd the command entered by the user
- * @param args_array the array in which to store the args
+ * Replays a binary trace against the MMU, with one aging tick per record, and reports its
+ * throughput on stderr.  Switch and fork records change the running process as SWITCH does and
+ * fork it as FORK does.
+ * @param path the filename of the binary trace
+ * @param pagefile the page file
+ * @param tbl the page table of the first running process
+ * @param age_resident true to age only resident pages each tick
+ * @return true if the whole trace was replayed, else returns false
  */
-void get_args(char* cmd, char* args_array[]);
+bool replay_trace(const char* path, char* pagefile, pagetable_t* tbl, bool age_resident);
 
 #endif //MMU_NEW_MMU_SIM_H
\ No newline at end of file
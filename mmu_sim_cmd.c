@@ -7,58 +7,122 @@
 
 #include "mmu_sim_cmd.h"
 
+/**
+ * A helper function that shortens a run of bytes to end at the end of the virtual address space,
+ * as replay_trace() does.
+ * @param vaddr the virtual address of the first byte
+ * @param nbytes the number of bytes asked for
+ * @return the number of bytes of the run inside the address space
+ */
+static size_t span_length(vaddr_t vaddr, size_t nbytes) {
+    size_t space = PAGETABLE_SIZE * PAGE_SIZE;
+    return nbytes > space - vaddr_value(vaddr) ? space - vaddr_value(vaddr) : nbytes;
+}
+
 uint8_t mmu_sim_read(char *pagefile, pagetable_t *tbl, vaddr_t vaddr) {
-    // translate to physical address
-    addr_t paddr = pagetable_translate(tbl, vaddr);
-    pte_t current_entry = tbl->entries[paddr.framenum];
-    // get frame number
-    pagenum_t current_pgnum = current_entry.framenum;
-    // load page
-    frame_t* current_frame = pte_page(pagefile, tbl, current_pgnum);
+    // load page (the TLB is consulted first)
+    frame_t* current_frame = pte_page(pagefile, tbl, vaddr.pagenum);
     // go to pg offset to get correct bytes, and put them into a variable
-    int byte_read = current_frame->bytes[paddr.offset];
+    int byte_read = current_frame->bytes[vaddr.offset];
 
     return byte_read;
 }
 
-void mmu_sim_readn(char *pagefile, pagetable_t *tbl, vaddr_t vaddr, int nbytes) {
-    uint8_t bytes_read[] = {};
-    for (int i = 0b0; i < nbytes; i++) {
-        vaddr.value ++;
-        bytes_read[i] = mmu_sim_read(pagefile, tbl, vaddr);
+void mmu_sim_readn(char *pagefile, pagetable_t *tbl, vaddr_t vaddr, size_t nbytes) {
+    uint64_t start = vaddr_value(vaddr);
+    size_t length = span_length(vaddr, nbytes);
+    // the bytes are not kept, so one page of buffer takes the run of each page in turn
+    uint8_t* bytes_read = length > 0 ? malloc(PAGE_SIZE) : NULL;
+    size_t done = 0;
+    while (bytes_read != NULL && done < length) {
+        size_t chunk = PAGE_SIZE - (start + done) % PAGE_SIZE;
+        if (chunk > length - done) {
+            chunk = length - done;
+        }
+        done += mmu_read_span(pagefile, tbl, mk_vaddr(start + done), bytes_read, chunk);
     }
+    free(bytes_read);
 }
 
 void mmu_sim_write(char *pagefile, pagetable_t *tbl, vaddr_t vaddr, uint8_t val) {
-    pagenum_t pagenum = vaddr.pagenum;
-    frame_t* frame = pte_page(pagefile, tbl, pagenum);
-    frame->bytes[vaddr.offset] = val;
-    pte_mkdirty(tbl, pagenum);
+    mmu_write_span(pagefile, tbl, vaddr, &val, 1);
 }
 
 void mmu_sim_writew(char *pagefile, pagetable_t *tbl, vaddr_t vaddr, uint8_t val1, uint8_t val2) {
     // write 2 bytes
-    mmu_sim_write(pagefile, tbl, vaddr, val1);
-    vaddr.value ++;
-    mmu_sim_write(pagefile, tbl, vaddr, val2);
+    uint8_t bytes[] = {val1, val2};
+    mmu_write_span(pagefile, tbl, vaddr, bytes, sizeof(bytes));
 }
 
 void mmu_sim_writedw(char *pagefile, pagetable_t *tbl, vaddr_t vaddr, uint8_t val1, uint8_t val2,
                      uint8_t val3, uint8_t val4) {
     // write 4 bytes
-    mmu_sim_write(pagefile, tbl, vaddr, val1);
-    vaddr.value ++;
-    mmu_sim_write(pagefile, tbl, vaddr, val2);
-    vaddr.value ++;
-    mmu_sim_write(pagefile, tbl, vaddr, val3);
-    vaddr.value ++;
-    mmu_sim_write(pagefile, tbl, vaddr, val4);
+    uint8_t bytes[] = {val1, val2, val3, val4};
+    mmu_write_span(pagefile, tbl, vaddr, bytes, sizeof(bytes));
 }
 
-void mmu_sim_writez(char *pagefile, pagetable_t *tbl, vaddr_t vaddr, int nbytes) {
-    // write nbytes zeros
-    for (int i = 0; i < nbytes; i++) {
-        mmu_sim_write(pagefile, tbl, vaddr, 0);
-        vaddr.value ++;
+void mmu_sim_writez(char *pagefile, pagetable_t *tbl, vaddr_t vaddr, size_t nbytes) {
+    // write nbytes zeros, up to the end of the address space
+    size_t length = span_length(vaddr, nbytes);
+    if (length > 0) {
+        mmu_fill_span(pagefile, tbl, vaddr, 0, length);
+    }
+}
+
+void mmu_sim_stats(pagetable_t *tbl, FILE *out) {
+    mmu_stats_t stats;
+    mm_stats(&stats);
+    fprintf(out, "accesses %lu\n", stats.accesses);
+    fprintf(out, "hits %lu\n", stats.hits);
+    fprintf(out, "faults %lu\n", stats.faults);
+    fprintf(out, "cold_faults %lu\n", stats.cold_faults);
+    fprintf(out, "capacity_faults %lu\n", stats.capacity_faults);
+    fprintf(out, "evictions %lu\n", stats.evictions);
+    fprintf(out, "writebacks %lu\n", stats.writebacks);
+    fprintf(out, "zero_fills %lu\n", stats.zero_fills);
+    fprintf(out, "zero_discards %lu\n", stats.zero_discards);
+    fprintf(out, "bytes_read %lu\n", stats.bytes_read);
+    fprintf(out, "bytes_written %lu\n", stats.bytes_written);
+    fprintf(out, "prefetches %lu\n", stats.prefetches);
+    fprintf(out, "prefetch_hits %lu\n", stats.prefetch_hits);
+    fprintf(out, "prefetch_wasted %lu\n", stats.prefetch_wasted);
+    fprintf(out, "flushes %lu\n", stats.flushes);
+    fprintf(out, "zcache_hits %lu\n", stats.zcache_hits);
+    fprintf(out, "zcache_stores %lu\n", stats.zcache_stores);
+    fprintf(out, "zcache_spills %lu\n", stats.zcache_spills);
+    fprintf(out, "zcache_pages %zu\n", stats.zcache_pages);
+    // uncompressed bytes held per byte of memory they take
+    fprintf(out, "zcache_ratio %.2f\n",
+            stats.zcache_bytes > 0 ? (double)stats.zcache_pages * PAGE_SIZE / stats.zcache_bytes
+                                   : 0.0);
+    fprintf(out, "superpage_faults %lu\n", stats.superpage_faults);
+    fprintf(out, "promotions %lu\n", stats.promotions);
+    fprintf(out, "demotions %lu\n", stats.demotions);
+    fprintf(out, "cow_shares %lu\n", stats.cow_shares);
+    fprintf(out, "cow_copies %lu\n", stats.cow_copies);
+    if (tbl->tlb != NULL) {
+        fprintf(out, "tlb_hits %lu\n", tbl->tlb->hits);
+        fprintf(out, "tlb_misses %lu\n", tbl->tlb->misses);
+        fprintf(out, "tlb_huge_hits %lu\n", tbl->tlb->huge_hits);
+    }
+    // with several address spaces, how each fared and which pages faulted in which
+    bool multi = mm_space_count() > 1;
+    for (asid_t asid = 0; multi && asid < mm_space_count(); asid++) {
+        mm_space_stats(asid, &stats);
+        fprintf(out, "space %u accesses %lu faults %lu evictions %lu writebacks %lu\n", asid,
+                stats.accesses, stats.faults, stats.evictions, stats.writebacks);
+    }
+    size_t count;
+    page_faults_t* pages = mm_page_faults(&count);
+    for (size_t i = 0; i < count; i++) {
+        if (multi) {
+            fprintf(out, "page_faults %u %lu %lu\n", pages[i].asid,
+                    (unsigned long)pages[i].pagenum, pages[i].faults);
+        }
+        else {
+            fprintf(out, "page_faults %lu %lu\n", (unsigned long)pages[i].pagenum,
+                    pages[i].faults);
+        }
     }
+    free(pages);
 }
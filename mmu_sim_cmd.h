@@ -7,6 +7,7 @@
 
 #ifndef MMU_NEW_MMU_SIM_CMD_H
 #define MMU_NEW_MMU_SIM_CMD_H
+#include <stdio.h>
 #include "mmu.h"
 
 /**
@@ -19,14 +20,14 @@
 uint8_t mmu_sim_read(char *pagefile, pagetable_t *tbl, vaddr_t vaddr);
 
 /**
- * Reads the specified number of bytes starting at the specified virtual address.
+ * Reads the specified number of bytes starting at the specified virtual address, stopping at the
+ * end of the virtual address space as a replayed trace does.
  * @param pagefile the filename of the pagefile
  * @param tbl a pointer to the page table
  * @param vaddr the virtual address of the first byte to be read
  * @param nbytes the number of bytes to be read
- * @return the bytes stored starting at the specified starting address
  */
-void mmu_sim_readn(char *pagefile, pagetable_t *tbl, vaddr_t vaddr, int nbytes);
+void mmu_sim_readn(char *pagefile, pagetable_t *tbl, vaddr_t vaddr, size_t nbytes);
 
 /**
  * Writes the specified byte value at the specified virtual address.
@@ -57,10 +58,20 @@ void mmu_sim_writedw(char *pagefile, pagetable_t *tbl, vaddr_t vaddr, uint8_t va
                      uint8_t val3, uint8_t val4);
 
 /**
- * Writes a zero value for the specified number of bytes starting at the specified virtual address.
+ * Writes a zero value for the specified number of bytes starting at the specified virtual address,
+ * stopping at the end of the virtual address space as a replayed trace does.
  * @param vaddr the virtual address to write to
  * @param nbytes the number of bytes of zeros to be written
  */
-void mmu_sim_writez(char *pagefile, pagetable_t *tbl, vaddr_t vaddr, int nbytes);
+void mmu_sim_writez(char *pagefile, pagetable_t *tbl, vaddr_t vaddr, size_t nbytes);
+
+/**
+ * Prints the MMU activity counters, the page table's TLB counters if it has a TLB, and the fault
+ * count of every page that has faulted.  With more than one address space, also prints the
+ * counters of each address space and tags each page's fault count with its ASID.
+ * @param tbl a pointer to the page table
+ * @param out the file to print to
+ */
+void mmu_sim_stats(pagetable_t *tbl, FILE *out);
 
 #endif //MMU_NEW_MMU_SIM_CMD_H
\ No newline at end of file
@@ -0,0 +1,226 @@
+/**
+ * @file mmu_sim_parse.c
+ * @brief Implementation of the mmu_sim command reader and parser.
+ *
+ * @author ckurdelak20@georgefox.edu
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "mmu_sim_parse.h"
+
+/**
+ * @struct cmd_spec_t
+ * @brief An opcode table entry.
+ */
+typedef struct {
+    const char* name;    /**< the command name */
+    size_t len;          /**< length of the command name */
+    const char* radix;   /**< one character per argument: 'b' binary, 'd' decimal */
+} cmd_spec_t;
+
+/* the opcode table, indexed by opcode */
+static const cmd_spec_t cmd_table[CMD_COUNT] = {
+    [CMD_HALT]    = {"HALT", 4, ""},
+    [CMD_READ]    = {"READ", 4, "b"},
+    [CMD_READN]   = {"READN", 5, "bd"},
+    [CMD_WRITE]   = {"WRITE", 5, "bb"},
+    [CMD_WRITEW]  = {"WRITEW", 6, "bbb"},
+    [CMD_WRITEDW] = {"WRITEDW", 7, "bbbbb"},
+    [CMD_WRITEZ]  = {"WRITEZ", 6, "bb"},
+    [CMD_STATS]   = {"STATS", 5, ""},
+    [CMD_SWITCH]  = {"SWITCH", 6, "d"},
+    [CMD_FORK]    = {"FORK", 4, "d"},
+};
+
+cmd_reader_t* cmd_reader_alloc(int fd) {
+    cmd_reader_t* reader = malloc(sizeof(cmd_reader_t));
+    if (reader != NULL) {
+        reader->buf = malloc(CMD_BLOCK_SIZE);
+        if (reader->buf != NULL) {
+            reader->fd = fd;
+            reader->start = 0;
+            reader->end = 0;
+            reader->eof = false;
+            reader->skipping = false;
+            reader->lineno = 0;
+        }
+        else {
+            free(reader);
+            reader = NULL;
+        }
+    }
+    return reader;
+}
+
+void cmd_reader_free(cmd_reader_t* reader) {
+    if (reader != NULL) {
+        free(reader->buf);
+        free(reader);
+    }
+}
+
+/**
+ * A helper function that moves the unread bytes to the front of the buffer and reads another
+ * block after them.
+ * @param reader the reader
+ */
+static void cmd_reader_fill(cmd_reader_t* reader) {
+    size_t pending = reader->end - reader->start;
+    memmove(reader->buf, reader->buf + reader->start, pending);
+    reader->start = 0;
+    reader->end = pending;
+    ssize_t n;
+    do {
+        n = read(reader->fd, reader->buf + reader->end, CMD_BLOCK_SIZE - reader->end);
+    } while (n == -1 && errno == EINTR);
+    if (n > 0) {
+        reader->end += n;
+    }
+    else {
+        reader->eof = true;
+    }
+}
+
+parse_status_t cmd_reader_next(cmd_reader_t* reader, const char** line, size_t* len) {
+    parse_status_t status = PARSE_EOF;
+    bool done = false;
+    while (!done) {
+        char* first = reader->buf + reader->start;
+        size_t pending = reader->end - reader->start;
+        char* newline = memchr(first, '\n', pending);
+        if (newline != NULL || (reader->eof && pending > 0)) {
+            // a whole line, or the last line without a newline
+            size_t n = newline != NULL ? (size_t)(newline - first) : pending;
+            reader->start += newline != NULL ? n + 1 : n;
+            reader->lineno++;
+            if (n > 0 && first[n - 1] == '\r') {
+                n--;
+            }
+            status = reader->skipping || n > CMD_MAX_LINE ? PARSE_TOO_LONG : PARSE_OK;
+            reader->skipping = false;
+            *line = first;
+            *len = n;
+            done = true;
+        }
+        else if (reader->eof) {
+            done = true;
+        }
+        else {
+            if (pending > CMD_MAX_LINE) {
+                // no newline yet and already too long; drop what we have of it
+                reader->skipping = true;
+                reader->start = reader->end;
+            }
+            cmd_reader_fill(reader);
+        }
+    }
+    return status;
+}
+
+bool parse_bin(const char* s, size_t len, uint64_t* value) {
+    uint64_t result = 0;
+    bool success = len > 0 && len <= 64;
+    for (size_t i = 0; success && i < len; i++) {
+        // '0' and '1' differ from each other only in the low bit
+        uint64_t digit = (uint64_t)(unsigned char)s[i] - '0';
+        success = digit <= 1;
+        result = result << 1 | digit;
+    }
+    *value = result;
+    return success;
+}
+
+bool parse_dec(const char* s, size_t len, uint64_t* value) {
+    uint64_t result = 0;
+    bool success = len > 0 && len <= 10;
+    for (size_t i = 0; success && i < len; i++) {
+        uint32_t digit = (uint32_t)(unsigned char)s[i] - '0';
+        success = digit <= 9;
+        result = result * 10 + digit;
+    }
+    success = success && result <= UINT32_MAX;
+    *value = result;
+    return success;
+}
+
+/**
+ * A helper function that returns true for the characters that separate tokens.
+ * @param c the character
+ * @return true if c is a space or a tab
+ */
+static bool is_blank(char c) {
+    return c == ' ' || c == '\t';
+}
+
+parse_status_t cmd_parse(const char* line, size_t len, cmd_t* cmd) {
+    const char* tokens[CMD_MAX_ARGS + 2];
+    size_t lens[CMD_MAX_ARGS + 2];
+    size_t ntokens = 0;
+    parse_status_t status = PARSE_OK;
+    memset(cmd->args, 0, sizeof(cmd->args));
+
+    // split on blanks, pointing into the line
+    size_t i = 0;
+    while (status == PARSE_OK && i < len) {
+        while (i < len && is_blank(line[i])) {
+            i++;
+        }
+        if (i < len) {
+            if (ntokens == CMD_MAX_ARGS + 2) {
+                status = PARSE_ARGS;
+            }
+            else {
+                tokens[ntokens] = &line[i];
+                while (i < len && !is_blank(line[i])) {
+                    i++;
+                }
+                lens[ntokens] = &line[i] - tokens[ntokens];
+                ntokens++;
+            }
+        }
+    }
+    if (status == PARSE_OK && ntokens == 0) {
+        status = PARSE_EMPTY;
+    }
+
+    // look up the command
+    const cmd_spec_t* spec = NULL;
+    for (int op = 0; status == PARSE_OK && spec == NULL && op < CMD_COUNT; op++) {
+        if (cmd_table[op].len == lens[0] && memcmp(cmd_table[op].name, tokens[0], lens[0]) == 0) {
+            spec = &cmd_table[op];
+            cmd->op = op;
+        }
+    }
+    if (status == PARSE_OK && spec == NULL) {
+        status = PARSE_UNKNOWN;
+    }
+    if (status == PARSE_OK && strlen(spec->radix) != ntokens - 1) {
+        status = PARSE_ARGS;
+    }
+
+    // convert the arguments
+    for (size_t a = 0; status == PARSE_OK && a + 1 < ntokens; a++) {
+        bool valid = spec->radix[a] == 'b' ? parse_bin(tokens[a + 1], lens[a + 1], &cmd->args[a])
+                                           : parse_dec(tokens[a + 1], lens[a + 1], &cmd->args[a]);
+        if (!valid) {
+            status = PARSE_NUMBER;
+        }
+    }
+    return status;
+}
+
+const char* parse_strerror(parse_status_t status) {
+    const char* messages[] = {
+        [PARSE_OK] = "ok",
+        [PARSE_EMPTY] = "empty command",
+        [PARSE_EOF] = "end of input",
+        [PARSE_TOO_LONG] = "command line too long",
+        [PARSE_UNKNOWN] = "unknown command",
+        [PARSE_ARGS] = "wrong number of arguments",
+        [PARSE_NUMBER] = "invalid number",
+    };
+    return messages[status];
+}
@@ -0,0 +1,136 @@
+/**
+ * @file mmu_sim_parse.h
+ * @brief Declarations for the mmu_sim command reader and parser.
+ *
+ * Input is read in large blocks and split into lines in place; each line is tokenized without
+ * copying or modifying it, and its command is looked up in an opcode table that gives the number
+ * of arguments and the radix of each.
+ *
+ * @author ckurdelak20@georgefox.edu
+ */
+
+#ifndef MMU_SIM_PARSE_H
+#define MMU_SIM_PARSE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define CMD_MAX_LINE    255           /* longest accepted command line, without the newline */
+#define CMD_MAX_ARGS    5             /* most arguments any command takes */
+#define CMD_BLOCK_SIZE  (1UL << 16)   /* bytes read from the input at a time */
+
+/**
+ * @enum cmd_op_t
+ * @brief A command opcode.
+ */
+typedef enum {
+    CMD_HALT,
+    CMD_READ,
+    CMD_READN,
+    CMD_WRITE,
+    CMD_WRITEW,
+    CMD_WRITEDW,
+    CMD_WRITEZ,
+    CMD_STATS,
+    CMD_SWITCH,
+    CMD_FORK,
+    CMD_COUNT     /* number of opcodes */
+} cmd_op_t;
+
+/**
+ * @enum parse_status_t
+ * @brief The result of reading or parsing one command line.
+ */
+typedef enum {
+    PARSE_OK,          /**< a command was parsed */
+    PARSE_EMPTY,       /**< the line was blank */
+    PARSE_EOF,         /**< there are no more lines */
+    PARSE_TOO_LONG,    /**< the line was longer than CMD_MAX_LINE and was skipped */
+    PARSE_UNKNOWN,     /**< the command name is not in the opcode table */
+    PARSE_ARGS,        /**< the command has the wrong number of arguments */
+    PARSE_NUMBER       /**< an argument is not a valid number */
+} parse_status_t;
+
+/**
+ * @struct cmd_t
+ * @brief A parsed command.
+ */
+typedef struct {
+    cmd_op_t op;                       /**< the opcode */
+    uint64_t args[CMD_MAX_ARGS];       /**< the numeric arguments */
+} cmd_t;
+
+/**
+ * @struct cmd_reader_t
+ * @brief A line reader over a file descriptor, reading CMD_BLOCK_SIZE bytes at a time.
+ * @see cmd_reader_alloc(), cmd_reader_free().
+ */
+typedef struct {
+    int fd;                  /**< the input file descriptor */
+    char* buf;               /**< the input buffer */
+    size_t start;            /**< offset of the first unread byte */
+    size_t end;              /**< offset one past the last buffered byte */
+    bool eof;                /**< true once the input is exhausted */
+    bool skipping;           /**< true while discarding an overlong line */
+    unsigned long lineno;    /**< number of the last line returned */
+} cmd_reader_t;
+
+/**
+ * @brief Dynamically allocates a new reader over the given file descriptor.
+ * @param fd the input file descriptor
+ * @return a pointer to the new reader
+ */
+cmd_reader_t* cmd_reader_alloc(int fd);
+
+/**
+ * @brief Frees the specified reader from memory; the file descriptor is not closed.
+ * @param reader the reader to be freed from memory
+ */
+void cmd_reader_free(cmd_reader_t* reader);
+
+/**
+ * Returns the next line of input, without its line ending.  The line points into the reader's
+ * buffer and is only valid until the next call.
+ * @param reader the reader
+ * @param line where to store a pointer to the first character of the line
+ * @param len where to store the length of the line
+ * @return PARSE_OK for a line, PARSE_TOO_LONG for a line that was skipped, or PARSE_EOF
+ */
+parse_status_t cmd_reader_next(cmd_reader_t* reader, const char** line, size_t* len);
+
+/**
+ * @brief Parses one command line.
+ * @param line the first character of the line
+ * @param len the length of the line
+ * @param cmd where to store the parsed command
+ * @return PARSE_OK, PARSE_EMPTY for a blank line, or the reason the line is not a valid command
+ */
+parse_status_t cmd_parse(const char* line, size_t len, cmd_t* cmd);
+
+/**
+ * Parses a binary literal of up to 64 digits, wide enough for any virtual address.
+ * @param s the first digit
+ * @param len the number of digits
+ * @param value where to store the value
+ * @return true if every character is a binary digit, else returns false
+ */
+bool parse_bin(const char* s, size_t len, uint64_t* value);
+
+/**
+ * Parses a decimal literal that fits in 32 bits.
+ * @param s the first digit
+ * @param len the number of digits
+ * @param value where to store the value
+ * @return true if every character is a decimal digit, else returns false
+ */
+bool parse_dec(const char* s, size_t len, uint64_t* value);
+
+/**
+ * @brief Returns a description of the given status, for error messages.
+ * @param status the status
+ * @return the description
+ */
+const char* parse_strerror(parse_status_t status);
+
+#endif /* MMU_SIM_PARSE_H */
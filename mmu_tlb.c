@@ -0,0 +1,193 @@
+/**
+ * @file mmu_tlb.c
+ * @brief Software TLB implementation.
+ *
+ * @author ckurdelak20@georgefox.edu
+ */
+
+#include <string.h>
+#include "mmu_tlb.h"
+
+tlb_t* tlb_alloc(size_t entries, size_t ways, tlb_policy_t policy) {
+    tlb_t* tlb = NULL;
+    if (ways == 0) {
+        ways = entries;
+    }
+    if (entries > 0 && entries % ways == 0) {
+        tlb = malloc(sizeof(tlb_t));
+    }
+    if (tlb != NULL) {
+        tlb->entries = calloc(entries, sizeof(tlbe_t));
+        if (tlb->entries != NULL) {
+            tlb->sets = entries / ways;
+            tlb->ways = ways;
+            tlb->policy = policy;
+            tlb->clock = 0;
+            tlb->seed = 2463534242u;
+            tlb->hits = 0;
+            tlb->misses = 0;
+            tlb->huge_hits = 0;
+            tlb->order = 0;
+        }
+        else {
+            free(tlb);
+            tlb = NULL;
+        }
+    }
+    return tlb;
+}
+
+void tlb_free(tlb_t* tlb) {
+    if (tlb != NULL) {
+        free(tlb->entries);
+        free(tlb);
+    }
+}
+
+/**
+ * A helper function that returns the first entry of the set the given page maps to.
+ * @param tlb the TLB
+ * @param pagenum the virtual page number
+ * @return a pointer to the first entry of the page's set
+ */
+static tlbe_t* tlb_set(tlb_t* tlb, pagenum_t pagenum) {
+    return &tlb->entries[(pagenum % tlb->sets) * tlb->ways];
+}
+
+/**
+ * A helper function that returns the first entry of the set the superpage holding the given page
+ * maps to.  Consecutive superpages map to consecutive sets.
+ * @param tlb the TLB
+ * @param pagenum the virtual page number
+ * @return a pointer to the first entry of the superpage's set
+ */
+static tlbe_t* tlb_huge_set(tlb_t* tlb, pagenum_t pagenum) {
+    return tlb_set(tlb, pagenum >> tlb->order);
+}
+
+/**
+ * A helper function that finds the valid entry of a set that maps the given page.
+ * @param tlb the TLB
+ * @param set the first entry of the set
+ * @param pagenum the page number the entry holds, the first of a superpage if order is not 0
+ * @param order the order of the entry
+ * @return a pointer to the entry, or NULL if the set has none
+ */
+static tlbe_t* tlb_find(tlb_t* tlb, tlbe_t* set, pagenum_t pagenum, unsigned order) {
+    tlbe_t* entry = NULL;
+    for (size_t i = 0; entry == NULL && i < tlb->ways; i++) {
+        if (set[i].valid && set[i].pagenum == pagenum && set[i].order == order) {
+            entry = &set[i];
+        }
+    }
+    return entry;
+}
+
+bool tlb_lookup(tlb_t* tlb, pagenum_t pagenum, framenum_t* framenum) {
+    bool hit = false;
+    if (tlb != NULL) {
+        tlbe_t* entry = tlb_find(tlb, tlb_set(tlb, pagenum), pagenum, 0);
+        if (entry == NULL && tlb->order > 0) {
+            pagenum_t first = pagenum >> tlb->order << tlb->order;
+            entry = tlb_find(tlb, tlb_huge_set(tlb, pagenum), first, tlb->order);
+            tlb->huge_hits += entry != NULL;
+        }
+        hit = entry != NULL;
+        if (hit) {
+            // a superpage's frames are in the same order as its pages
+            *framenum = entry->framenum + (framenum_t)(pagenum - entry->pagenum);
+            if (tlb->policy == TLB_LRU) {
+                entry->stamp = ++tlb->clock;
+            }
+        }
+        if (hit) {
+            tlb->hits++;
+        }
+        else {
+            tlb->misses++;
+        }
+    }
+    return hit;
+}
+
+/**
+ * A helper function that caches a mapping in an entry of the given set, replacing an entry per the
+ * TLB's policy if the set is full.
+ * @param tlb the TLB
+ * @param set the first entry of the set
+ * @param pagenum the virtual page number, the first of a superpage if order is not 0
+ * @param framenum the physical page frame number, the first of a superpage if order is not 0
+ * @param order log2 of the number of pages mapped
+ */
+static void tlb_fill(tlb_t* tlb, tlbe_t* set, pagenum_t pagenum, framenum_t framenum,
+                     unsigned order) {
+    // reuse the mapping's own entry, else a free one
+    tlbe_t* victim = tlb_find(tlb, set, pagenum, order);
+    for (size_t i = 0; victim == NULL && i < tlb->ways; i++) {
+        if (!set[i].valid) {
+            victim = &set[i];
+        }
+    }
+    // set is full; replace per the policy
+    if (victim == NULL) {
+        if (tlb->policy == TLB_RANDOM) {
+            // xorshift32
+            tlb->seed ^= tlb->seed << 13;
+            tlb->seed ^= tlb->seed >> 17;
+            tlb->seed ^= tlb->seed << 5;
+            victim = &set[tlb->seed % tlb->ways];
+        }
+        else {
+            victim = &set[0];
+            for (size_t i = 1; i < tlb->ways; i++) {
+                if (set[i].stamp < victim->stamp) {
+                    victim = &set[i];
+                }
+            }
+        }
+    }
+    victim->pagenum = pagenum;
+    victim->framenum = framenum;
+    victim->order = order;
+    victim->valid = true;
+    victim->stamp = ++tlb->clock;
+}
+
+void tlb_insert(tlb_t* tlb, pagenum_t pagenum, framenum_t framenum) {
+    if (tlb != NULL) {
+        tlb_fill(tlb, tlb_set(tlb, pagenum), pagenum, framenum, 0);
+    }
+}
+
+void tlb_insert_huge(tlb_t* tlb, pagenum_t pagenum, framenum_t framenum, unsigned order) {
+    if (tlb != NULL && order > 0) {
+        if (order != tlb->order) {
+            // lookups only look for superpages of one order
+            tlb_flush(tlb);
+            tlb->order = order;
+        }
+        tlb_fill(tlb, tlb_huge_set(tlb, pagenum), pagenum, framenum, order);
+    }
+}
+
+void tlb_invalidate(tlb_t* tlb, pagenum_t pagenum) {
+    if (tlb != NULL) {
+        tlbe_t* entry = tlb_find(tlb, tlb_set(tlb, pagenum), pagenum, 0);
+        if (entry != NULL) {
+            entry->valid = false;
+        }
+        if (tlb->order > 0) {
+            pagenum_t first = pagenum >> tlb->order << tlb->order;
+            entry = tlb_find(tlb, tlb_huge_set(tlb, pagenum), first, tlb->order);
+            if (entry != NULL) {
+                entry->valid = false;
+            }
+        }
+    }
+}
+
+void tlb_flush(tlb_t* tlb) {
+    if (tlb != NULL) {
+        memset(tlb->entries, 0, tlb->sets * tlb->ways * sizeof(tlbe_t));
+    }
+}
@@ -0,0 +1,78 @@
+/**
+ * @file mmu_tlb.h
+ * @brief Function prototypes for the software TLB.
+ *
+ * A TLB caches virtual page to page frame mappings for pages that are present, so that a hit
+ * skips the page table entry entirely.  It is attached to a page table through its tlb field, and
+ * every function here accepts a NULL TLB and behaves as if the TLB were always empty.
+ *
+ * An entry can also map a whole superpage: a naturally aligned run of pages held in a naturally
+ * aligned run of frames.  Such an entry sits in the set of its superpage rather than of any one
+ * page, and a lookup that misses the page's own set looks there next.
+ *
+ * @author ckurdelak20@georgefox.edu
+ */
+
+#ifndef MMU_TLB_H
+#define MMU_TLB_H
+
+#include "mmu.h"
+
+/**
+ * Dynamically allocates a new, empty TLB.
+ * @param entries the total number of TLB entries
+ * @param ways the number of entries per set; 0 makes the TLB fully associative
+ * @param policy the replacement policy within a set
+ * @return a pointer to the new TLB, or NULL if ways does not evenly divide entries
+ */
+tlb_t* tlb_alloc(size_t entries, size_t ways, tlb_policy_t policy);
+
+/**
+ * @brief Frees the specified TLB from memory.
+ * @param tlb the TLB to be freed from memory
+ */
+void tlb_free(tlb_t* tlb);
+
+/**
+ * Looks up the mapping for the given virtual page number, counting a hit or a miss.
+ * @param tlb the TLB
+ * @param pagenum the virtual page number
+ * @param framenum where to store the page frame number on a hit
+ * @return true on a hit, else returns false
+ */
+bool tlb_lookup(tlb_t* tlb, pagenum_t pagenum, framenum_t* framenum);
+
+/**
+ * Caches the mapping for the given virtual page number, replacing an entry of its set per the
+ * TLB's policy if the set is full.
+ * @param tlb the TLB
+ * @param pagenum the virtual page number
+ * @param framenum the physical page frame number
+ */
+void tlb_insert(tlb_t* tlb, pagenum_t pagenum, framenum_t framenum);
+
+/**
+ * Caches the mapping for a whole superpage in one entry, like tlb_insert().  Every superpage
+ * entry of a TLB has the same order; inserting one of another order flushes the TLB.
+ * @param tlb the TLB
+ * @param pagenum the first virtual page number of the superpage, a multiple of 2^order
+ * @param framenum the first physical page frame number of the superpage
+ * @param order log2 of the number of pages in the superpage
+ */
+void tlb_insert_huge(tlb_t* tlb, pagenum_t pagenum, framenum_t framenum, unsigned order);
+
+/**
+ * @brief Invalidates the mapping for the given virtual page number, if it is cached, along with
+ * that of any superpage holding it.
+ * @param tlb the TLB
+ * @param pagenum the virtual page number
+ */
+void tlb_invalidate(tlb_t* tlb, pagenum_t pagenum);
+
+/**
+ * @brief Invalidates every mapping in the TLB.
+ * @param tlb the TLB
+ */
+void tlb_flush(tlb_t* tlb);
+
+#endif /* MMU_TLB_H */
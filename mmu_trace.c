@@ -0,0 +1,140 @@
+/**
+ * @file mmu_trace.c
+ * @brief Binary access trace implementation.
+ *
+ * @author ckurdelak20@georgefox.edu
+ */
+
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "mmu_trace.h"
+
+/**
+ * A helper function that decodes a little-endian 32-bit value.
+ * @param p the first byte
+ * @return the decoded value
+ */
+static uint32_t get_le32(const uint8_t* p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+/**
+ * A helper function that decodes a little-endian 64-bit value.
+ * @param p the first byte
+ * @return the decoded value
+ */
+static uint64_t get_le64(const uint8_t* p) {
+    return (uint64_t)get_le32(p) | (uint64_t)get_le32(p + 4) << 32;
+}
+
+/**
+ * A helper function that encodes a little-endian 32-bit value.
+ * @param p the first byte
+ * @param value the value to be encoded
+ */
+static void put_le32(uint8_t* p, uint32_t value) {
+    p[0] = value;
+    p[1] = value >> 8;
+    p[2] = value >> 16;
+    p[3] = value >> 24;
+}
+
+/**
+ * A helper function that encodes a little-endian 64-bit value.
+ * @param p the first byte
+ * @param value the value to be encoded
+ */
+static void put_le64(uint8_t* p, uint64_t value) {
+    put_le32(p, value);
+    put_le32(p + 4, value >> 32);
+}
+
+trace_t* trace_open(const char* path) {
+    trace_t* trace = NULL;
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd != -1 && fstat(fd, &st) == 0 && st.st_size >= TRACE_HEADER_SIZE) {
+        void* data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED) {
+            const uint8_t* bytes = data;
+            unsigned version = bytes[4] | bytes[5] << 8;
+            // the trace is read front to back exactly once
+            madvise(data, st.st_size, MADV_SEQUENTIAL);
+            if (memcmp(bytes, TRACE_MAGIC, 4) == 0 && version >= 1 && version <= TRACE_VERSION) {
+                trace = malloc(sizeof(trace_t));
+            }
+            if (trace != NULL) {
+                trace->data = bytes;
+                trace->size = st.st_size;
+                trace->pos = TRACE_HEADER_SIZE;
+                trace->version = version;
+            }
+            else {
+                munmap(data, st.st_size);
+            }
+        }
+    }
+    if (fd != -1) {
+        close(fd);
+    }
+    return trace;
+}
+
+void trace_close(trace_t* trace) {
+    if (trace != NULL) {
+        munmap((void*)trace->data, trace->size);
+        free(trace);
+    }
+}
+
+bool trace_next(trace_t* trace, trace_rec_t* rec) {
+    size_t rec_size = trace->version == 1 ? TRACE_RECORD_SIZE_1 : TRACE_RECORD_SIZE;
+    bool success = trace->size - trace->pos >= rec_size;
+    if (success) {
+        const uint8_t* p = trace->data + trace->pos;
+        rec->op = p[0];
+        rec->fill = p[1];
+        if (trace->version == 1) {
+            rec->vaddr = get_le32(p + 4);
+            rec->length = get_le32(p + 8);
+        }
+        else {
+            rec->length = get_le32(p + 4);
+            rec->vaddr = get_le64(p + 8);
+        }
+        rec->payload = NULL;
+        size_t next = trace->pos + rec_size;
+        if (rec->op == TRACE_WRITE) {
+            rec->payload = p + rec_size;
+            success = trace->size - next >= rec->length;
+            next += rec->length;
+        }
+        else {
+            success = rec->op == TRACE_READ || rec->op == TRACE_FILL || rec->op == TRACE_SWITCH
+                      || rec->op == TRACE_FORK;
+        }
+        if (success) {
+            trace->pos = next;
+        }
+    }
+    return success;
+}
+
+bool trace_write_header(FILE* out) {
+    uint8_t header[TRACE_HEADER_SIZE] = {'M', 'M', 'U', 'T', TRACE_VERSION, 0, 0, 0};
+    return fwrite(header, 1, sizeof(header), out) == sizeof(header);
+}
+
+bool trace_write(FILE* out, const trace_rec_t* rec) {
+    uint8_t header[TRACE_RECORD_SIZE] = {rec->op, rec->fill, 0, 0};
+    put_le32(header + 4, rec->length);
+    put_le64(header + 8, rec->vaddr);
+    bool success = fwrite(header, 1, sizeof(header), out) == sizeof(header);
+    if (success && rec->op == TRACE_WRITE) {
+        success = fwrite(rec->payload, 1, rec->length, out) == rec->length;
+    }
+    return success;
+}
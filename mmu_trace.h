@@ -0,0 +1,103 @@
+/**
+ * @file mmu_trace.h
+ * @brief Declarations for binary access traces.
+ *
+ * A trace is an 8-byte header ("MMUT", a 16-bit version, 16 reserved bits) followed by records.
+ * Each record is a 16-byte header (op, fill byte, 16 reserved bits, 32-bit length, 64-bit virtual
+ * address) followed, for TRACE_WRITE only, by length payload bytes.  A TRACE_SWITCH or TRACE_FORK
+ * record holds the address space to switch to or fork into in its address field and has a length
+ * of 0.  Addresses are stored whole, so a trace can be replayed under any geometry.  Version 1
+ * traces, whose 12-byte record headers hold a 32-bit address before the length, are still read.
+ * Multi-byte fields are little-endian.  Records are not padded, so a reader must not assume any
+ * alignment.
+ *
+ * @author ckurdelak20@georgefox.edu
+ */
+
+#ifndef MMU_TRACE_H
+#define MMU_TRACE_H
+
+#include <stdio.h>
+#include "mmu.h"
+
+#define TRACE_MAGIC         "MMUT"
+#define TRACE_VERSION       2
+#define TRACE_HEADER_SIZE   8
+#define TRACE_RECORD_SIZE   16
+#define TRACE_RECORD_SIZE_1 12    /* record header size of a version 1 trace */
+
+/**
+ * @enum trace_op_t
+ * @brief The operation of a trace record.
+ */
+typedef enum {
+    TRACE_READ = 1,     /**< read length bytes */
+    TRACE_WRITE = 2,    /**< write the length payload bytes */
+    TRACE_FILL = 3,     /**< set length bytes to the fill byte */
+    TRACE_SWITCH = 4,   /**< switch to the address space in vaddr */
+    TRACE_FORK = 5      /**< fork the running address space into the one in vaddr */
+} trace_op_t;
+
+/**
+ * @struct trace_rec_t
+ * @brief One decoded trace record.
+ */
+typedef struct {
+    trace_op_t op;             /**< the operation */
+    uint8_t fill;              /**< the fill byte (TRACE_FILL only) */
+    uint64_t vaddr;            /**< virtual address of the first byte */
+    uint32_t length;           /**< number of bytes */
+    const uint8_t* payload;    /**< bytes to be written (TRACE_WRITE only) */
+} trace_rec_t;
+
+/**
+ * @struct trace_t
+ * @brief A trace opened for reading; the whole file is memory-mapped.
+ * @see trace_open(), trace_close().
+ */
+typedef struct {
+    const uint8_t* data;    /**< the mapped trace file */
+    size_t size;            /**< size of the trace file in bytes */
+    size_t pos;             /**< offset of the next record */
+    unsigned version;       /**< format version of the trace */
+} trace_t;
+
+/**
+ * @brief Opens a trace for reading and checks its header.
+ * @param path the filename of the trace
+ * @return a pointer to the open trace, or NULL if it could not be opened or is not a trace
+ */
+trace_t* trace_open(const char* path);
+
+/**
+ * @brief Closes the given trace and frees it from memory.
+ * @param trace the trace to be closed
+ */
+void trace_close(trace_t* trace);
+
+/**
+ * Decodes the next record of the trace.  A write record's payload points into the mapping, so it
+ * is only valid until the trace is closed.
+ * @param trace the trace
+ * @param rec where to store the record
+ * @return true if a whole record was decoded, else returns false at the end of the trace or on a
+ * truncated or unknown record
+ */
+bool trace_next(trace_t* trace, trace_rec_t* rec);
+
+/**
+ * @brief Writes the trace header.
+ * @param out the file to write to
+ * @return true if the header was written, else returns false
+ */
+bool trace_write_header(FILE* out);
+
+/**
+ * @brief Writes one trace record, including its payload for TRACE_WRITE.
+ * @param out the file to write to
+ * @param rec the record to be written
+ * @return true if the record was written, else returns false
+ */
+bool trace_write(FILE* out, const trace_rec_t* rec);
+
+#endif /* MMU_TRACE_H */
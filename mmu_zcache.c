@@ -0,0 +1,346 @@
+/**
+ * @file mmu_zcache.c
+ * @brief Compressed page cache implementation.
+ *
+ * @author ckurdelak20@georgefox.edu
+ */
+
+#include <string.h>
+#include "mmu_zcache.h"
+
+#define TAG_ZERO     0    /* the word is zero */
+#define TAG_REPEAT   1    /* the word is the same as the one before it */
+#define TAG_STORED   2    /* the word is stored as is */
+
+zcache_t* zcache_alloc(size_t budget, pagefile_t* backing) {
+    zcache_t* zc = malloc(sizeof(zcache_t));
+    if (zc != NULL) {
+        zc->entries = pagemap_alloc(64);
+        zc->newest = NULL;
+        zc->oldest = NULL;
+        zc->budget = budget;
+        zc->bytes = 0;
+        zc->pages = 0;
+        zc->backing = backing;
+        zc->spill = malloc(PAGE_SIZE);
+        pthread_mutex_init(&zc->lock, NULL);
+        if (zc->entries == NULL || zc->spill == NULL) {
+            pagemap_free(zc->entries);
+            free(zc->spill);
+            pthread_mutex_destroy(&zc->lock);
+            free(zc);
+            zc = NULL;
+        }
+    }
+    return zc;
+}
+
+void zcache_free(zcache_t* zc) {
+    if (zc != NULL) {
+        zentry_t* entry = zc->newest;
+        while (entry != NULL) {
+            zentry_t* older = entry->older;
+            free(entry);
+            entry = older;
+        }
+        pagemap_free(zc->entries);
+        free(zc->spill);
+        pthread_mutex_destroy(&zc->lock);
+        free(zc);
+    }
+}
+
+/**
+ * A helper function that compresses a page into an entry.  The entry must have room for a tag per
+ * word and every word of the page.
+ * @param frame the frame holding the page
+ * @param entry the entry to fill in
+ */
+static void compress(const frame_t* frame, zentry_t* entry) {
+    const uint64_t* words = (const uint64_t*)frame->bytes;
+    size_t count = PAGE_SIZE / sizeof(uint64_t);
+    bool same = true;
+    for (size_t i = 1; i < count && same; i++) {
+        same = words[i] == words[0];
+    }
+    entry->fill = words[0];
+    entry->size = 0;
+
+    if (!same) {
+        // four 2-bit tags to a byte, then the stored words
+        uint8_t* tags = entry->data;
+        uint8_t* stored = entry->data + count / 4;
+        uint64_t prev = 0;
+        for (size_t i = 0; i < count; i += 4) {
+            uint8_t group = 0;
+            for (size_t j = 0; j < 4; j++) {
+                uint64_t word = words[i + j];
+                uint8_t tag = TAG_STORED;
+                if (word == 0) {
+                    tag = TAG_ZERO;
+                }
+                else if (word == prev) {
+                    tag = TAG_REPEAT;
+                }
+                else {
+                    memcpy(stored, &word, sizeof(uint64_t));
+                    stored += sizeof(uint64_t);
+                }
+                group |= tag << (j * 2);
+                prev = word;
+            }
+            tags[i / 4] = group;
+        }
+        entry->size = stored - entry->data;
+    }
+}
+
+/**
+ * A helper function that decompresses an entry into a frame.
+ * @param entry the entry
+ * @param frame the frame to fill
+ */
+static void decompress(const zentry_t* entry, frame_t* frame) {
+    uint64_t* words = (uint64_t*)frame->bytes;
+    size_t count = PAGE_SIZE / sizeof(uint64_t);
+    if (entry->size == 0) {
+        for (size_t i = 0; i < count; i++) {
+            words[i] = entry->fill;
+        }
+    }
+    else {
+        const uint8_t* tags = entry->data;
+        const uint8_t* stored = entry->data + count / 4;
+        uint64_t prev = 0;
+        for (size_t i = 0; i < count; i += 4) {
+            uint8_t group = tags[i / 4];
+            if (group == 0) {
+                // four zero words, as most are in a sparse page
+                prev = 0;
+                memset(&words[i], 0, 4 * sizeof(uint64_t));
+            }
+            for (size_t j = 0; j < 4 && group != 0; j++) {
+                uint8_t tag = (group >> (j * 2)) & 3;
+                if (tag == TAG_ZERO) {
+                    prev = 0;
+                }
+                else if (tag == TAG_STORED) {
+                    memcpy(&prev, stored, sizeof(uint64_t));
+                    stored += sizeof(uint64_t);
+                }
+                words[i + j] = prev;
+            }
+        }
+    }
+}
+
+/**
+ * A helper function that returns the bytes an entry counts against the budget.
+ * @param entry the entry
+ * @return the size of the entry in bytes
+ */
+static size_t entry_bytes(const zentry_t* entry) {
+    return sizeof(zentry_t) + entry->size;
+}
+
+/**
+ * A helper function that unlinks an entry from the cache without freeing it.  The cache's lock
+ * must be held.
+ * @param zc the cache
+ * @param entry the entry
+ */
+static void entry_unlink(zcache_t* zc, zentry_t* entry) {
+    if (entry->newer != NULL) {
+        entry->newer->older = entry->older;
+    }
+    else {
+        zc->newest = entry->older;
+    }
+    if (entry->older != NULL) {
+        entry->older->newer = entry->newer;
+    }
+    else {
+        zc->oldest = entry->newer;
+    }
+}
+
+/**
+ * A helper function that links an entry into the cache as its newest.  The cache's lock must be
+ * held.
+ * @param zc the cache
+ * @param entry the entry
+ */
+static void entry_link(zcache_t* zc, zentry_t* entry) {
+    entry->newer = NULL;
+    entry->older = zc->newest;
+    if (zc->newest != NULL) {
+        zc->newest->newer = entry;
+    }
+    else {
+        zc->oldest = entry;
+    }
+    zc->newest = entry;
+}
+
+/**
+ * A helper function that removes an entry from the cache and frees it.  The cache's lock must be
+ * held.
+ * @param zc the cache
+ * @param entry the entry
+ */
+static void entry_remove(zcache_t* zc, zentry_t* entry) {
+    entry_unlink(zc, entry);
+    pagemap_remove(zc->entries, entry->pagenum);
+    zc->bytes -= entry_bytes(entry);
+    zc->pages--;
+    free(entry);
+}
+
+/**
+ * A helper function that spills the oldest entries until the cache is within its budget.  The
+ * cache's lock must be held.
+ * @param zc the cache
+ * @return the number of pages spilled to the page file
+ */
+static size_t zcache_spill(zcache_t* zc) {
+    size_t spilled = 0;
+    while (zc->bytes > zc->budget) {
+        zentry_t* oldest = zc->oldest;
+        decompress(oldest, zc->spill);
+        pagefile_write(zc->backing, oldest->pagenum, zc->spill);
+        entry_remove(zc, oldest);
+        spilled++;
+    }
+    return spilled;
+}
+
+bool zcache_store(zcache_t* zc, pagenum_t pagenum, const frame_t* frame, size_t* spilled) {
+    *spilled = 0;
+    // compressed before taking the lock, into room for the worst case
+    size_t count = PAGE_SIZE / sizeof(uint64_t);
+    zentry_t* entry = malloc(sizeof(zentry_t) + count / 4 + PAGE_SIZE);
+    bool stored = entry != NULL;
+    if (stored) {
+        entry->pagenum = pagenum;
+        compress(frame, entry);
+        stored = entry->size <= ZCACHE_STORE_MAX && entry_bytes(entry) <= zc->budget;
+        zentry_t* smaller = stored ? realloc(entry, entry_bytes(entry)) : NULL;
+        if (smaller != NULL) {
+            entry = smaller;
+        }
+    }
+
+    pthread_mutex_lock(&zc->lock);
+    uint64_t* slot = pagemap_find(zc->entries, pagenum);
+    if (slot != NULL) {
+        // the copy held is out of date either way
+        entry_remove(zc, (zentry_t*)(uintptr_t)*slot);
+    }
+    slot = stored ? pagemap_insert(zc->entries, pagenum) : NULL;
+    stored = slot != NULL;
+    if (stored) {
+        *slot = (uintptr_t)entry;
+        entry_link(zc, entry);
+        zc->bytes += entry_bytes(entry);
+        zc->pages++;
+    }
+    // the new entry fits the budget on its own, so it is never the one spilled
+    *spilled = zcache_spill(zc);
+    pthread_mutex_unlock(&zc->lock);
+
+    if (!stored) {
+        free(entry);
+    }
+    return stored;
+}
+
+bool zcache_load(zcache_t* zc, pagenum_t pagenum, frame_t* frame) {
+    pthread_mutex_lock(&zc->lock);
+    const uint64_t* slot = pagemap_find(zc->entries, pagenum);
+    bool found = slot != NULL;
+    if (found) {
+        zentry_t* entry = (zentry_t*)(uintptr_t)*slot;
+        decompress(entry, frame);
+        // a page in use is the last to spill
+        entry_unlink(zc, entry);
+        entry_link(zc, entry);
+    }
+    pthread_mutex_unlock(&zc->lock);
+    return found;
+}
+
+void zcache_drop(zcache_t* zc, pagenum_t pagenum) {
+    pthread_mutex_lock(&zc->lock);
+    const uint64_t* slot = pagemap_find(zc->entries, pagenum);
+    if (slot != NULL) {
+        entry_remove(zc, (zentry_t*)(uintptr_t)*slot);
+    }
+    pthread_mutex_unlock(&zc->lock);
+}
+
+void zcache_usage(zcache_t* zc, size_t* pages, size_t* bytes) {
+    pthread_mutex_lock(&zc->lock);
+    *pages = zc->pages;
+    *bytes = zc->bytes;
+    pthread_mutex_unlock(&zc->lock);
+}
+
+bool zcache_pages(zcache_t* zc, pagenum_t first, size_t count, pagenum_t** pages, size_t* found) {
+    pthread_mutex_lock(&zc->lock);
+    *pages = zc->pages > 0 ? malloc(zc->pages * sizeof(pagenum_t)) : NULL;
+    *found = 0;
+    bool success = *pages != NULL || zc->pages == 0;
+    for (const zentry_t* entry = zc->oldest; success && entry != NULL; entry = entry->newer) {
+        if (entry->pagenum >= first && entry->pagenum - first < count) {
+            (*pages)[(*found)++] = entry->pagenum;
+        }
+    }
+    pthread_mutex_unlock(&zc->lock);
+    return success;
+}
+
+bool zcache_save(zcache_t* zc, FILE* out) {
+    pthread_mutex_lock(&zc->lock);
+    uint64_t count = zc->pages;
+    bool success = image_put(out, &count, sizeof(count));
+    // oldest first, so that a restore links them back in the same order
+    for (zentry_t* entry = zc->oldest; success && entry != NULL; entry = entry->newer) {
+        uint64_t fields[3] = {entry->pagenum, entry->fill, entry->size};
+        success = image_put(out, fields, sizeof(fields))
+                  && image_put(out, entry->data, entry->size);
+    }
+    pthread_mutex_unlock(&zc->lock);
+    return success;
+}
+
+bool zcache_restore(zcache_t* zc, image_t* image, size_t* spilled) {
+    uint64_t count;
+    bool success = image_get(image, &count, sizeof(count));
+    *spilled = 0;
+    pthread_mutex_lock(&zc->lock);
+    for (uint64_t i = 0; success && i < count; i++) {
+        uint64_t fields[3];
+        success = image_get(image, fields, sizeof(fields)) && fields[2] <= ZCACHE_STORE_MAX;
+        const uint8_t* data = success ? image_next(image, fields[2]) : NULL;
+        zentry_t* entry = data != NULL ? malloc(sizeof(zentry_t) + fields[2]) : NULL;
+        uint64_t* slot = entry != NULL ? pagemap_insert(zc->entries, fields[0]) : NULL;
+        success = slot != NULL && zc->entries->size == zc->pages + 1;
+        if (success) {
+            entry->pagenum = fields[0];
+            entry->fill = fields[1];
+            entry->size = fields[2];
+            memcpy(entry->data, data, entry->size);
+            *slot = (uintptr_t)entry;
+            entry_link(zc, entry);
+            zc->bytes += entry_bytes(entry);
+            zc->pages++;
+            // a smaller budget than the image was taken with keeps the newest pages
+            *spilled += zcache_spill(zc);
+        }
+        else {
+            free(entry);
+        }
+    }
+    pthread_mutex_unlock(&zc->lock);
+    return success;
+}
@@ -0,0 +1,147 @@
+/**
+ * @file mmu_zcache.h
+ * @brief Function prototypes for the compressed page cache, a tier of memory in front of the page
+ * file.
+ *
+ * Dirty pages written back by the MMU are compressed into the cache rather than written to the
+ * page file, and loads look in the cache before reading the page file.  A page whose 64-bit words
+ * are all the same is kept as that one word.  Any other page is compressed a word at a time: each
+ * word is zero, a repeat of the word before it, or stored as is, which takes a 2-bit tag per word
+ * and the stored words.  A page that does not compress to ZCACHE_STORE_MAX bytes or less goes to
+ * the page file instead.
+ *
+ * The cache holds up to a budget of bytes, counting each page's compressed bytes and the record
+ * that tracks it.  To make room, the pages least recently stored or loaded are spilled: written to
+ * the page file and dropped from the cache.  A page loaded from the cache stays in it, so that its
+ * frame can later be dropped clean, until it is stored again, dropped or spilled.
+ *
+ * The pages a cache holds can be saved in a checkpoint image, oldest first, and restored into a
+ * new cache, spilling the oldest of them if the new cache's budget is smaller.
+ *
+ * Pages may be stored and loaded by several threads at once, as long as no two transfer the same
+ * page at the same time; a lock guards the cache, and is held across spills.
+ *
+ * @author ckurdelak20@georgefox.edu
+ */
+
+#ifndef MMU_ZCACHE_H
+#define MMU_ZCACHE_H
+
+#include <pthread.h>
+#include "mmu.h"
+#include "mmu_image.h"
+#include "mmu_pagefile.h"
+
+#define ZCACHE_STORE_MAX  (PAGE_SIZE / 4 * 3)    /* most compressed bytes worth keeping a page in */
+
+/**
+ * @struct zentry_t
+ * @brief A page held in the compressed cache.
+ */
+typedef struct zentry {
+    pagenum_t pagenum;        /**< the page's number in the page file */
+    struct zentry* newer;     /**< the entry stored or loaded next, or NULL if this is the newest */
+    struct zentry* older;     /**< the entry stored or loaded before, or NULL if the oldest */
+    uint64_t fill;            /**< the word repeated over the whole page, if size is 0 */
+    size_t size;              /**< bytes of compressed data, or 0 for a page of one word */
+    uint8_t data[];           /**< the tags of the page's words, then the words stored as is */
+} zentry_t;
+
+/**
+ * @struct zcache_t
+ * @brief A compressed page cache.
+ * @see zcache_alloc(), zcache_free().
+ */
+typedef struct {
+    pagemap_t* entries;       /**< the entry of each cached page, by page number in the page file */
+    zentry_t* newest;         /**< the entry stored or loaded last */
+    zentry_t* oldest;         /**< the next entry to spill */
+    size_t budget;            /**< most bytes held */
+    size_t bytes;             /**< bytes held, counting each entry's record */
+    size_t pages;             /**< pages held */
+    pagefile_t* backing;      /**< the page file pages are spilled to */
+    frame_t* spill;           /**< room to decompress a page being spilled into */
+    pthread_mutex_t lock;     /**< guards everything above across threads */
+} zcache_t;
+
+/**
+ * @brief Dynamically allocates a new, empty compressed page cache.
+ * @param budget the most bytes the cache may hold
+ * @param backing the page file to spill pages to
+ * @return a pointer to the new cache, or NULL if it could not be allocated
+ */
+zcache_t* zcache_alloc(size_t budget, pagefile_t* backing);
+
+/**
+ * @brief Frees the specified cache from memory, dropping the pages it holds without spilling them.
+ * @param zc the cache to be freed from memory
+ */
+void zcache_free(zcache_t* zc);
+
+/**
+ * Compresses a page into the cache, replacing any copy it already holds, and spills the oldest
+ * pages if that leaves the cache over budget.  A page that does not compress well enough, or that
+ * would not fit in the budget on its own, is not stored, and any copy the cache held is dropped.
+ * @param zc the cache
+ * @param pagenum the page's number in the page file
+ * @param frame the frame holding the page
+ * @param spilled where to store the number of pages spilled to the page file
+ * @return true if the page was stored, else returns false if it must be written to the page file
+ */
+bool zcache_store(zcache_t* zc, pagenum_t pagenum, const frame_t* frame, size_t* spilled);
+
+/**
+ * @brief Decompresses a page held in the cache into a frame.
+ * @param zc the cache
+ * @param pagenum the page's number in the page file
+ * @param frame the frame to fill
+ * @return true if the cache held the page, else returns false
+ */
+bool zcache_load(zcache_t* zc, pagenum_t pagenum, frame_t* frame);
+
+/**
+ * @brief Drops any copy of a page the cache holds, as when the page file gets a newer one.
+ * @param zc the cache
+ * @param pagenum the page's number in the page file
+ */
+void zcache_drop(zcache_t* zc, pagenum_t pagenum);
+
+/**
+ * @brief Reports how full the cache is.
+ * @param zc the cache
+ * @param pages where to store the number of pages held
+ * @param bytes where to store the number of bytes held
+ */
+void zcache_usage(zcache_t* zc, size_t* pages, size_t* bytes);
+
+/**
+ * @brief Lists the pages of a range that the cache holds.
+ * @param zc the cache
+ * @param first the number of the first page of the range in the page file
+ * @param count the number of pages in the range
+ * @param pages where to store a dynamically allocated array of the pages' numbers, oldest first,
+ * to be freed by the caller; NULL if there are none
+ * @param found where to store the number of pages listed
+ * @return true if the pages were listed, else returns false if memory could not be allocated
+ */
+bool zcache_pages(zcache_t* zc, pagenum_t first, size_t count, pagenum_t** pages, size_t* found);
+
+/**
+ * @brief Writes every page the cache holds, still compressed and oldest first, to an image.
+ * @param zc the cache
+ * @param out the image file to write to
+ * @return true if the pages were written, else returns false
+ */
+bool zcache_save(zcache_t* zc, FILE* out);
+
+/**
+ * Reads the pages saved in an image into an empty cache, as the newest in the order they were
+ * saved, and spills the oldest ones while the cache is over budget.
+ * @param zc the cache
+ * @param image the image, positioned at the saved pages
+ * @param spilled where to store the number of pages spilled to the page file
+ * @return true if every page was read, else returns false on a truncated or damaged image
+ */
+bool zcache_restore(zcache_t* zc, image_t* image, size_t* spilled);
+
+#endif /* MMU_ZCACHE_H */